@@ -0,0 +1,158 @@
+#include <Benchmarks/Benchmark.h>
+#include <UI/CodeTextEdit/Arena.h>
+#include <UI/CodeTextEdit/LineBreaks.h>
+#include <UI/CodeTextEdit/Lexers/CPPLexer.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// A full recalculation of a 50 MB file (TestData/BasicBlock.cpp repeated): lexing it, building the
+// break offsets of every line and wrapping them. Counts the heap allocations of each step: every
+// operator new of the program goes through the counter below
+
+namespace {
+
+  std::atomic<size_t> heapAllocations(0);
+
+  // The break offsets as they were stored before the arena: a vector per line
+  struct VectorBreaks {
+    std::vector<uint16_t> breaks;
+
+    void build(const char *text, size_t length) {
+      breaks.clear();
+      for (size_t i = 0; i < length; ++i) {
+        const char c = text[i];
+        if ((c == ' ' && i > 0) || ((c == ',' || c == ';') && i + 1 < length))
+          breaks.push_back(static_cast<uint16_t>(c == ' ' ? i : i + 1));
+      }
+      breaks.shrink_to_fit();
+    }
+  };
+
+  std::string readTestFile(const char *name) {
+    std::ifstream file(std::string(VECTIS_TESTDATA) + "/" + name, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+
+  void printRow(const char *name, double ms, size_t allocations) {
+    std::printf("%-32s %10.2f ms %12zu allocations\n", name, ms, allocations);
+  }
+}
+
+void *operator new(size_t size) {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size > 0 ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  std::free(p);
+}
+
+void runArenaBenchmark(size_t maxBytes) {
+  const size_t MB = 1024u * 1024u;
+
+  std::string source = readTestFile("BasicBlock.cpp");
+  if (source.empty()) {
+    std::printf("could not read %s/BasicBlock.cpp\n", VECTIS_TESTDATA);
+    return;
+  }
+  const size_t size = std::min<size_t>(maxBytes, 50 * MB);
+  std::string text;
+  text.reserve(size + source.size());
+  while (text.size() < size)
+    text += source;
+
+  std::vector<size_t> lineStarts(1, 0);
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '\n')
+      lineStarts.push_back(i + 1);
+  }
+  if (lineStarts.back() != text.size())
+    lineStarts.push_back(text.size());
+  const size_t lineCount = lineStarts.size() - 1;
+  auto lineLength = [&lineStarts](size_t line) { return static_cast<int>(lineStarts[line + 1] - lineStarts[line]); };
+
+  // Each pass drops the previous results, as loading a file does
+  volatile size_t sink = 0;
+  size_t allocations = heapAllocations.load();
+  double vectorPass = bestOfMs(3, [&]() {
+    std::vector<VectorBreaks> breaks(lineCount);
+    for (size_t i = 0; i < lineCount; ++i) {
+      breaks[i].build(text.data() + lineStarts[i], lineLength(i));
+      sink = sink + breaks[i].breaks.size();
+    }
+  });
+  const size_t vectorAllocations = (heapAllocations.load() - allocations) / 3;
+
+  Arena arena;
+  allocations = heapAllocations.load();
+  double arenaPass = bestOfMs(3, [&]() {
+    arena.reset();
+    std::vector<LineBreaks> breaks(lineCount);
+    for (size_t i = 0; i < lineCount; ++i) {
+      breaks[i].build(text.data() + lineStarts[i], lineLength(i), LineEncoding::Ascii, arena);
+      sink = sink + breaks[i].size();
+    }
+  });
+  const size_t arenaAllocations = (heapAllocations.load() - allocations) / 3;
+  const Arena::Statistics lineStatistics = arena.statistics();
+
+  // Lines are wrapped in parallel: every thread takes a quarter of them, allocating from a region
+  // of the arena of its own
+  const int THREADS = 4;
+  allocations = heapAllocations.load();
+  double parallelPass = bestOfMs(3, [&]() {
+    arena.reset();
+    std::vector<LineBreaks> breaks(lineCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+      threads.emplace_back([&, t]() {
+        for (size_t i = t * lineCount / THREADS; i < (t + 1) * lineCount / THREADS; ++i)
+          breaks[i].build(text.data() + lineStarts[i], lineLength(i), LineEncoding::Ascii, arena);
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    sink = sink + breaks.size();
+  });
+  const size_t parallelAllocations = (heapAllocations.load() - allocations) / 3;
+
+  // The first lexing guesses how many segments it will find, the next ones know it from the
+  // previous one
+  CPPLexer lexer;
+  StyleDatabase sdb;
+  allocations = heapAllocations.load();
+  double firstLexing = bestOfMs(1, [&]() { lexer.lexInput(LexerInput(text.data(), text.size()), sdb); });
+  const size_t firstLexingAllocations = heapAllocations.load() - allocations;
+  allocations = heapAllocations.load();
+  double nextLexing = bestOfMs(3, [&]() { lexer.lexInput(LexerInput(text.data(), text.size()), sdb); });
+  const size_t nextLexingAllocations = (heapAllocations.load() - allocations) / 3;
+  const StyleDatabase::Statistics styleStatistics = sdb.statistics();
+
+  std::printf("%zu lines, %.1f MB\n", lineCount, text.size() / static_cast<double>(MB));
+  printRow("breaks, vector per line", vectorPass, vectorAllocations);
+  printRow("breaks, arena", arenaPass, arenaAllocations);
+  printRow("breaks, arena, 4 threads", parallelPass, parallelAllocations);
+  printRow("lexing, first", firstLexing, firstLexingAllocations);
+  printRow("lexing, room reserved", nextLexing, nextLexingAllocations);
+  std::printf("line arena:  %zu allocations, %.1f MB used, %.1f MB in %zu blocks\n", lineStatistics.allocations,
+              lineStatistics.bytesUsed / static_cast<double>(MB), lineStatistics.bytesReserved / static_cast<double>(MB),
+              lineStatistics.blocks);
+  std::printf("styles:      %zu runs, %.1f MB used, %.1f MB in %zu blocks\n", styleStatistics.runs,
+              styleStatistics.bytesUsed / static_cast<double>(MB), styleStatistics.bytesReserved / static_cast<double>(MB),
+              styleStatistics.blocks);
+}
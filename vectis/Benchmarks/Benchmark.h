@@ -0,0 +1,40 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <cstddef>
+
+// Runs a callable a few times and returns the best wall-clock time in milliseconds
+template <typename Fn>
+double bestOfMs(int runs, Fn&& fn) {
+  double best = -1.0;
+  for (int i = 0; i < runs; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    if (best < 0.0 || ms < best)
+      best = ms;
+  }
+  return best;
+}
+
+inline double throughputMBs(size_t bytes, double ms) {
+  return (ms > 0.0) ? (bytes / (1024.0 * 1024.0)) / (ms / 1000.0) : 0.0;
+}
+
+// Generates size bytes of source-like text (lines of varying length, some indentation)
+std::string generateSourceText(size_t size);
+
+// Every benchmark receives the maximum amount of data (in bytes) it is allowed to process
+void runLineScanBenchmark(size_t maxBytes);
+void runLexerBenchmark(size_t maxBytes);
+void runNumericLiteralBenchmark(size_t maxBytes);
+void runKeywordsBenchmark(size_t maxBytes);
+void runHighlightBenchmark(size_t maxBytes);
+void runMiniMapBenchmark(size_t maxBytes);
+void runWrapBenchmark(size_t maxBytes);
+void runArenaBenchmark(size_t maxBytes);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# Micro-benchmarks for the performance-sensitive parts of the editor.
+# Not part of the application build:
+#   qmake Benchmarks.pro && make && ./benchmarks [name...]
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+CONFIG   += console c++14
+CONFIG   -= app_bundle
+
+TARGET = benchmarks
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/..
+DEFINES += VECTIS_TESTDATA=\\\"$$PWD/../TestData\\\"
+
+SOURCES += main.cpp \
+        LineScanBenchmark.cpp \
+        LexerBenchmark.cpp \
+        NumericLiteralBenchmark.cpp \
+        KeywordsBenchmark.cpp \
+        HighlightBenchmark.cpp \
+        MiniMapBenchmark.cpp \
+        WrapBenchmark.cpp \
+        ArenaBenchmark.cpp \
+        ../UI/CodeTextEdit/Buffer/LineScanner.cpp \
+        ../UI/CodeTextEdit/Buffer/LineIndex.cpp \
+        ../UI/CodeTextEdit/Buffer/PieceTable.cpp \
+        ../UI/CodeTextEdit/Arena.cpp \
+        ../UI/CodeTextEdit/LineBreaks.cpp \
+        ../UI/CodeTextEdit/Lexers/Lexer.cpp \
+        ../UI/CodeTextEdit/Lexers/LexerInput.cpp \
+        ../UI/CodeTextEdit/Lexers/CPPLexer.cpp \
+        ../UI/MiniMap/MiniMapSilhouette.cpp
+
+HEADERS  += Benchmark.h
@@ -0,0 +1,127 @@
+#include <Benchmarks/Benchmark.h>
+#include <UI/CodeTextEdit/Lexers/CPPLexer.h>
+#include <QRegExp>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// Highlights 10k lines of TestData/BasicBlock.cpp (as when opening a file) with the lexer the editor
+// uses and with the regular expression rules CPPHighlighter used to apply to every block.
+// Formats are written to a per-character array instead of a QSyntaxHighlighter so that the
+// benchmark doesn't need a GUI
+
+namespace {
+
+  struct LegacyRules {
+    QVector<QPair<QRegExp, int>> rules;
+    QRegExp commentStart{"/\\*"};
+    QRegExp commentEnd{"\\*/"};
+    QRegExp includeAngleBrackets{"#include\\s*(<.*>)"};
+
+    LegacyRules() {
+      const char *keywords[] = { "alignas", "alignof", "asm", "auto", "bitand", "bitor", "bool", "char", "char16_t",
+        "char32_t", "class", "compl", "concept", "decltype", "default", "delete", "double", "dynamic_cast", "enum",
+        "explicit", "export", "extern", "false", "float", "friend", "goto", "inline", "int", "long", "mutable",
+        "namespace", "new", "noexcept", "nullptr", "operator", "register", "reinterpret_cast", "requires", "return",
+        "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct", "template", "this",
+        "thread_local", "throw", "true", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual",
+        "void", "volatile", "wchar_t", "nullptr" };
+      for (auto keyword : keywords)
+        rules.append(qMakePair(QRegExp(QString("\\b%1\\b").arg(keyword)), 1));
+      const char *statements[] = { "if", "for", "switch", "do", "while", "else", "and", "and_eq", "xor", "xor_eq",
+        "or", "or_eq", "not", "not_eq", "break", "case", "catch", "try", "const", "constexpr", "const_cast",
+        "continue", "private", "protected", "public" };
+      for (auto statement : statements)
+        rules.append(qMakePair(QRegExp(QString("\\b%1\\b").arg(statement)), 2));
+      rules.append(qMakePair(QRegExp("#include\\b"), 2));
+      rules.append(qMakePair(QRegExp("\\bQ[A-Za-z]+\\b"), 3));
+      rules.append(qMakePair(QRegExp("//[^\n]*"), 4));
+      rules.append(qMakePair(QRegExp("\".*\""), 5));
+      rules.append(qMakePair(QRegExp("\\b[A-Za-z0-9_]+(?=\\()"), 6));
+    }
+
+    // A copy of the former CPPHighlighter::highlightBlock
+    int highlightBlock(const QString& text, int previousState, std::vector<uint8_t>& styles) {
+      styles.assign(static_cast<size_t>(text.length()), 0);
+      auto setFormat = [&styles](int start, int length, int style) {
+        std::fill(styles.begin() + start, styles.begin() + start + length, static_cast<uint8_t>(style));
+      };
+
+      for (const auto& rule : rules) {
+        QRegExp expression(rule.first);
+        int index = expression.indexIn(text);
+        while (index >= 0) {
+          int length = expression.matchedLength();
+          setFormat(index, length, rule.second);
+          index = expression.indexIn(text, index + length);
+        }
+      }
+      int index = includeAngleBrackets.indexIn(text);
+      while (index >= 0 && includeAngleBrackets.captureCount() > 0) {
+        int length = includeAngleBrackets.matchedLength();
+        setFormat(index + includeAngleBrackets.pos(1), includeAngleBrackets.cap(1).length(), 5);
+        index = includeAngleBrackets.indexIn(text, index + length);
+      }
+
+      int state = 0;
+      int startIndex = 0;
+      if (previousState != 1)
+        startIndex = commentStart.indexIn(text);
+      while (startIndex >= 0) {
+        int endIndex = commentEnd.indexIn(text, startIndex);
+        int commentLength;
+        if (endIndex == -1) {
+          state = 1;
+          commentLength = text.length() - startIndex;
+        } else {
+          commentLength = endIndex - startIndex + commentEnd.matchedLength();
+        }
+        setFormat(startIndex, commentLength, 7);
+        startIndex = commentStart.indexIn(text, startIndex + commentLength);
+      }
+      return state;
+    }
+  };
+}
+
+void runHighlightBenchmark(size_t maxBytes) {
+  (void)maxBytes; // Always 10k lines
+
+  std::ifstream file(std::string(VECTIS_TESTDATA) + "/BasicBlock.cpp", std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  QStringList sourceLines = QString::fromStdString(contents.str()).split('\n');
+  if (sourceLines.size() < 2) {
+    std::printf("could not read %s/BasicBlock.cpp\n", VECTIS_TESTDATA);
+    return;
+  }
+  QStringList lines;
+  while (lines.size() < 10000)
+    lines.append(sourceLines.at(lines.size() % sourceLines.size()));
+
+  LegacyRules legacy;
+  std::vector<uint8_t> styles;
+  const std::string text = lines.join('\n').toStdString(); // As the document stores them
+  CPPLexer lexer;
+  StyleDatabase sdb;
+  volatile int sink = 0;
+
+  double legacyMs = bestOfMs(2, [&]() {
+    int state = -1;
+    for (const QString& line : lines)
+      state = legacy.highlightBlock(line, state, styles);
+    sink = state;
+  });
+  double lexerMs = bestOfMs(5, [&]() {
+    lexer.lexInput(LexerInput(text.data(), text.size()), sdb);
+  });
+  (void)sink;
+
+  std::printf("%d lines\n", lines.size());
+  std::printf("%-24s %10.2f ms\n", "regular expressions", legacyMs);
+  std::printf("%-24s %10.2f ms\n", "lexer", lexerMs);
+}
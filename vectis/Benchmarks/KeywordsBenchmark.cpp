@@ -0,0 +1,66 @@
+#include <Benchmarks/Benchmark.h>
+#include <UI/CodeTextEdit/Lexers/CPPKeywords.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+// Compares the keywords perfect hash with the std::unordered_set<std::string> CPPLexer used,
+// classifying every word of generated source text
+
+namespace {
+
+  struct Word {
+    size_t offset;
+    size_t length;
+  };
+
+  std::vector<Word> splitWords(const std::string& text) {
+    std::vector<Word> words;
+    size_t i = 0;
+    while (i < text.size()) {
+      char c = text[i];
+      bool wordCharacter = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+      if (!wordCharacter) {
+        ++i;
+        continue;
+      }
+      size_t start = i;
+      while (i < text.size() && ((text[i] >= '0' && text[i] <= '9') || (text[i] >= 'A' && text[i] <= 'Z') ||
+                                 (text[i] >= 'a' && text[i] <= 'z') || text[i] == '_'))
+        ++i;
+      words.push_back(Word{start, i - start});
+    }
+    return words;
+  }
+}
+
+void runKeywordsBenchmark(size_t maxBytes) {
+  std::string text = generateSourceText(std::min<size_t>(maxBytes, 16u * 1024u * 1024u));
+  std::vector<Word> words = splitWords(text);
+
+  std::unordered_set<std::string> set;
+  for (auto& keyword : CPPKeywords::keywords)
+    set.emplace(keyword.text);
+
+  volatile size_t sink = 0;
+  double hashSet = bestOfMs(3, [&]() {
+    size_t keywords = 0;
+    for (auto& word : words)
+      keywords += set.find(text.substr(word.offset, word.length)) != set.end();
+    sink = keywords;
+  });
+  double perfectHash = bestOfMs(3, [&]() {
+    size_t keywords = 0;
+    for (auto& word : words)
+      keywords += classifyCPPKeyword(text.data() + word.offset, word.length) != CPPKeywordClass::None;
+    sink = keywords;
+  });
+  (void)sink;
+
+  auto nsPerWord = [&words](double ms) { return ms * 1e6 / static_cast<double>(words.size()); };
+  std::printf("%zu words\n", words.size());
+  std::printf("%-28s %10.1f ns/word\n", "unordered_set + substr", nsPerWord(hashSet));
+  std::printf("%-28s %10.1f ns/word\n", "perfect hash", nsPerWord(perfectHash));
+}
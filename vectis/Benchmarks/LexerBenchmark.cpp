@@ -0,0 +1,71 @@
+#include <Benchmarks/Benchmark.h>
+#include <UI/CodeTextEdit/Lexers/CPPLexer.h>
+#include <UI/CodeTextEdit/Buffer/PieceTable.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// Measures CPPLexer throughput on TestData/BasicBlock.cpp repeated up to the requested size,
+// both on a contiguous buffer and on a piece table fragmented by many small edits, and how long
+// relexing takes after typing a character in the middle of it (it shouldn't depend on the size)
+
+namespace {
+
+  std::string readTestFile(const char *name) {
+    std::ifstream file(std::string(VECTIS_TESTDATA) + "/" + name, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+
+  // A piece table holding text, with a one-character comment inserted every ~4KB so that the
+  // lexer has to walk many pieces as it would after an editing session
+  void fragmentedCopy(const std::string& text, PieceTable& table) {
+    table.reset(text.data(), text.size());
+    size_t inserted = 0;
+    for (size_t offset = 4096; offset < text.size(); offset += 4096) {
+      size_t lineEnd = text.find('\n', offset);
+      if (lineEnd == std::string::npos)
+        break;
+      table.insert(lineEnd + inserted, "\n", 1);
+      ++inserted;
+    }
+  }
+}
+
+void runLexerBenchmark(size_t maxBytes) {
+  const size_t MB = 1024u * 1024u;
+
+  std::string source = readTestFile("BasicBlock.cpp");
+  if (source.empty()) {
+    std::printf("could not read %s/BasicBlock.cpp\n", VECTIS_TESTDATA);
+    return;
+  }
+
+  std::printf("%10s %18s %18s %12s %12s\n", "size", "contiguous", "piece table", "pieces", "relex");
+  for (size_t size = MB; size <= maxBytes && size <= 64 * MB; size *= 4) {
+    std::string text;
+    text.reserve(size + source.size());
+    while (text.size() < size)
+      text += source;
+
+    PieceTable table;
+    fragmentedCopy(text, table);
+
+    CPPLexer lexer;
+    StyleDatabase sdb;
+    int runs = size <= 4 * MB ? 5 : 2;
+    double contiguous = bestOfMs(runs, [&]() { lexer.lexInput(LexerInput(text.data(), text.size()), sdb); });
+    double pieces = bestOfMs(runs, [&]() { lexer.lexInput(LexerInput(table), sdb); });
+    const size_t middle = table.lineStart(table.lineCount() / 2) + 1;
+    double relex = bestOfMs(runs, [&]() {
+      table.insert(middle, "x", 1);
+      lexer.relexInput(LexerInput(table), sdb, middle, 0, 1);
+      table.remove(middle, 1);
+      lexer.relexInput(LexerInput(table), sdb, middle, 1, 0);
+    }) / 2;
+
+    std::printf("%7zu MB %13.0f MB/s %13.0f MB/s %12zu %9.3f ms\n", text.size() / MB,
+                throughputMBs(text.size(), contiguous), throughputMBs(table.size(), pieces), table.pieceCount(), relex);
+  }
+}
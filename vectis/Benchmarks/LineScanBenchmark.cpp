@@ -0,0 +1,67 @@
+#include <Benchmarks/Benchmark.h>
+#include <UI/CodeTextEdit/Buffer/LineScanner.h>
+#include <cstdio>
+#include <vector>
+
+// Compares the vectorized newline scanner with the character-by-character loop that
+// Document::loadFromFile used to split lines (that loop appended every character to a
+// QString; a std::string stands in for it here so the benchmark doesn't need Qt)
+
+namespace {
+
+  size_t legacyLineSplit(const std::string& text) {
+    std::vector<std::string> lines;
+    std::string line;
+    for (auto ch : text) {
+      line += ch;
+      if (ch == '\n') {
+        lines.push_back(std::move(line));
+        line.clear();
+      }
+    }
+    return lines.size();
+  }
+
+  size_t kernelScan(ScanKernel kernel, const std::string& text) {
+    std::vector<uint32_t> starts;
+    starts.reserve(text.size() / 32 + 1);
+    starts.push_back(0);
+    scanLineStarts(kernel, text.data(), text.size(), 0, starts);
+    return starts.size();
+  }
+}
+
+void runLineScanBenchmark(size_t maxBytes) {
+  const size_t MB = 1024u * 1024u;
+  const size_t LEGACY_LIMIT = 256 * MB; // The legacy loop allocates a string per line
+
+  std::printf("best kernel on this CPU: %s\n", scanKernelName(bestScanKernel()));
+  std::printf("%10s %16s %16s %16s %16s\n", "size", "legacy loop", "scalar", "SSE2", "AVX2");
+
+  for (size_t size = MB; size <= maxBytes && size <= 1024 * MB; size *= 4) {
+    std::string text = generateSourceText(size);
+    int runs = size <= 64 * MB ? 5 : 2;
+    volatile size_t sink = 0;
+
+    double legacy = -1.0;
+    if (size <= LEGACY_LIMIT)
+      legacy = bestOfMs(runs, [&]() { sink = legacyLineSplit(text); });
+    // Unsupported kernels would silently run the scalar loop: don't report them
+    char kernelCells[3][32];
+    const ScanKernel kernels[3] = { ScanKernel::Scalar, ScanKernel::SSE2, ScanKernel::AVX2 };
+    for (int k = 0; k < 3; ++k) {
+      std::snprintf(kernelCells[k], sizeof(kernelCells[k]), "n/a");
+      if (scanKernelSupported(kernels[k])) {
+        double ms = bestOfMs(runs, [&]() { sink = kernelScan(kernels[k], text); });
+        std::snprintf(kernelCells[k], sizeof(kernelCells[k]), "%.0f MB/s", throughputMBs(size, ms));
+      }
+    }
+    (void)sink;
+
+    char legacyCell[32] = "skipped";
+    if (legacy >= 0.0)
+      std::snprintf(legacyCell, sizeof(legacyCell), "%.0f MB/s", throughputMBs(size, legacy));
+    std::printf("%7zu MB %16s %16s %16s %16s\n", size / MB, legacyCell,
+                kernelCells[0], kernelCells[1], kernelCells[2]);
+  }
+}
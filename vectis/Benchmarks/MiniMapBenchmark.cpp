@@ -0,0 +1,91 @@
+#include <Benchmarks/Benchmark.h>
+#include <UI/CodeTextEdit/Lexers/CPPLexer.h>
+#include <UI/MiniMap/MiniMapSilhouette.h>
+#include <QStringList>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// Paints the minimap silhouette of 100k lines of TestData/BasicBlock.cpp, lexed beforehand.
+// The geometry is the editor's one (15 px monospace font) on a 900 px wide viewport, scaled to the
+// 150 px wide minimap
+
+void runMiniMapBenchmark(size_t maxBytes) {
+  (void)maxBytes; // Always 100k lines
+
+  std::ifstream file(std::string(VECTIS_TESTDATA) + "/BasicBlock.cpp", std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  QStringList sourceLines = QString::fromStdString(contents.str()).split('\n');
+  if (sourceLines.size() < 2) {
+    std::printf("could not read %s/BasicBlock.cpp\n", VECTIS_TESTDATA);
+    return;
+  }
+  QStringList lines;
+  while (lines.size() < 100000)
+    lines.append(sourceLines.at(lines.size() % sourceLines.size()));
+
+  // The colours of the editor styles, from Normal to CPP_QtClass
+  const quint32 colors[] = { 0xFFFFFFFF, 0xFF66D9EF, 0xFFF92672, 0xFF75715E, 0xFFA6E22E, 0xFFE6DB58, 0xFFA6E22E,
+                             0xFFA6E22E, 0xFFAE81FF, 0xFFE6DB58, 0xFFA6E22E };
+  const std::string text = lines.join('\n').toStdString();
+  CPPLexer lexer;
+  StyleDatabase styles;
+  lexer.lexInput(LexerInput(text.data(), text.size()), styles);
+  std::vector<std::vector<SilhouetteRun>> runs(static_cast<size_t>(lines.size()));
+  for (int i = 0; i < lines.size() && static_cast<size_t>(i) < styles.lineCount(); ++i) {
+    const StyleDatabase::Line& line = styles.line(static_cast<size_t>(i));
+    for (uint32_t run = 0; run < line.runCount; ++run) {
+      const LexerRun& lexed = line.runs[run];
+      runs[i].push_back(SilhouetteRun{static_cast<int>(lexed.start), lexed.length, colors[lexed.style]});
+    }
+  }
+
+  SilhouetteGeometry geometry;
+  geometry.scale = 150.f / 900.f;
+  geometry.characterWidth = 9.f;
+  geometry.lineHeight = 18.f;
+  geometry.margin = 4.f;
+  geometry.wrapColumns = (900 - 8) / 9;
+  geometry.tabColumns = 8;
+
+  // Turned into their cells beforehand, as MiniMapRenderer does for the tiles which changed
+  std::vector<SilhouetteBlock> blocks(runs.size());
+  for (int i = 0; i < lines.size(); ++i)
+    blocks[i] = silhouetteBlock(lines.at(i).constData(), lines.at(i).length(), runs[i].data(),
+                                static_cast<int>(runs[i].size()), 0xFFFFFFFF, geometry);
+
+  // Lines are painted into 256-row images, one after the other, as MiniMapRenderer would if the
+  // whole thumbnail was on screen
+  const int rows = 256, width = 150;
+  std::vector<int> lineCounts(static_cast<size_t>(lines.size()));
+  std::vector<quint32> image(static_cast<size_t>(width * rows));
+  int images = 0;
+  volatile quint32 sink = 0;
+  double ms = bestOfMs(5, [&]() {
+    int visualLines = 0;
+    for (int i = 0; i < lines.size(); ++i) {
+      lineCounts[i] = silhouetteLineCount(blocks[i], geometry);
+      visualLines += lineCounts[i];
+    }
+    images = (silhouetteRow(visualLines, geometry) + rows - 1) / rows;
+    int line = 0, next = 0;
+    for (int index = 0; index < images; ++index) {
+      std::fill(image.begin(), image.end(), 0u);
+      // The first line not entirely above the image, and the following ones until its bottom
+      while (next < lines.size() && silhouetteRow(line + lineCounts[next], geometry) <= index * rows)
+        line += lineCounts[next++];
+      int paintLine = line;
+      for (int i = next; i < lines.size() && silhouetteRow(paintLine, geometry) < (index + 1) * rows; ++i)
+        paintLine += paintSilhouette(image.data(), width * 4, width, rows, index * rows, paintLine, blocks[i], geometry);
+      sink = sink + image[image.size() / 2];
+    }
+  });
+  (void)sink;
+
+  std::printf("%d lines\n", lines.size());
+  std::printf("%-24s %10.2f ms\n", "silhouette", ms);
+  std::printf("%-24s %10.3f ms\n", "per 256-row image", ms / images);
+}
@@ -0,0 +1,73 @@
+#include <Benchmarks/Benchmark.h>
+#include <UI/CodeTextEdit/Lexers/NumericLiteral.h>
+#include <algorithm>
+#include <cstdio>
+#include <regex>
+#include <vector>
+
+// Compares the numeric literal DFA with the two regular expressions CPPLexer used to match
+// literals (which it constructed again for every token)
+
+namespace {
+
+  const char *samples[] = { "0", "42", "1000000", "0x1F", "0xDEADBEEFull", "017", "0b1010", "10u",
+                            "3ul", "1'000'000", "1.5", "3.14159f", "1e10", "2.5e-3L", "0x1.8p3", "12abc" };
+
+  bool legacyIsLiteral(const std::string& token) {
+    std::regex lit("\\d+[uUlL]?[ull]?[ULL]?[UL]?[ul]?[ll]?[LL]?");
+    std::regex lit2("0[xbX][\\da-fA-F]+");
+    return std::regex_match(token, lit) || std::regex_match(token, lit2);
+  }
+
+  bool legacyPrebuiltIsLiteral(const std::string& token) {
+    static const std::regex lit("\\d+[uUlL]?[ull]?[ULL]?[UL]?[ul]?[ll]?[LL]?");
+    static const std::regex lit2("0[xbX][\\da-fA-F]+");
+    return std::regex_match(token, lit) || std::regex_match(token, lit2);
+  }
+
+  struct StringInput {
+    const std::string& text;
+    char at(size_t pos) const { return text.at(pos); }
+  };
+}
+
+void runNumericLiteralBenchmark(size_t maxBytes) {
+  // Tokens separated by spaces, as the DFA needs a terminator
+  std::vector<std::string> tokens;
+  std::string text;
+  size_t budget = std::min<size_t>(maxBytes, 4u * 1024u * 1024u);
+  for (size_t i = 0; text.size() < budget; ++i) {
+    tokens.emplace_back(samples[i % (sizeof(samples) / sizeof(samples[0]))]);
+    text += tokens.back();
+    text.push_back(' ');
+  }
+
+  volatile size_t sink = 0;
+  const size_t legacyCount = std::min<size_t>(tokens.size(), 20000);
+  double legacy = bestOfMs(1, [&]() {
+    size_t literals = 0;
+    for (size_t i = 0; i < legacyCount; ++i)
+      literals += legacyIsLiteral(tokens[i]);
+    sink = literals;
+  });
+  double prebuilt = bestOfMs(3, [&]() {
+    size_t literals = 0;
+    for (auto& token : tokens)
+      literals += legacyPrebuiltIsLiteral(token);
+    sink = literals;
+  });
+  double dfa = bestOfMs(5, [&]() {
+    StringInput input{text};
+    size_t literals = 0;
+    for (size_t pos = 0; pos < text.size(); ++pos) // Skips the separating space
+      literals += scanNumericLiteral(input, pos) != NumericLiteralKind::Invalid;
+    sink = literals;
+  });
+  (void)sink;
+
+  auto nsPerToken = [](double ms, size_t count) { return ms * 1e6 / static_cast<double>(count); };
+  std::printf("%zu tokens\n", tokens.size());
+  std::printf("%-28s %10.1f ns/token\n", "regex built per token", nsPerToken(legacy, legacyCount));
+  std::printf("%-28s %10.1f ns/token\n", "regex built once", nsPerToken(prebuilt, tokens.size()));
+  std::printf("%-28s %10.1f ns/token\n", "DFA", nsPerToken(dfa, tokens.size()));
+}
@@ -0,0 +1,81 @@
+#include <Benchmarks/Benchmark.h>
+#include <UI/CodeTextEdit/LineBreaks.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Rewraps a document at every width of a resize drag, as Document::wrapLines does: the legacy
+// loop rescanned each long line for spaces and copied the rest of the line at every split
+// (std::string stands in for QString), the LineBreaks walk only looks at the break offsets built
+// beforehand. Editor lines are just counted, their characters aren't copied by either
+
+namespace {
+
+  size_t legacyWrap(const std::string& line, int maxChars) {
+    size_t editorLines = 1;
+    std::string restOfLine = line;
+    while (static_cast<int>(restOfLine.size()) > maxChars) {
+      int bestSplittingPointFound = -1;
+      for (int i = 0; i < static_cast<int>(restOfLine.size()); ++i) {
+        if (i > maxChars)
+          break;
+        if (restOfLine[i] == ' ' && i != 0)
+          bestSplittingPointFound = i;
+      }
+      int split = (bestSplittingPointFound != -1) ? bestSplittingPointFound : maxChars;
+      restOfLine = restOfLine.substr(split);
+      ++editorLines;
+    }
+    return editorLines;
+  }
+}
+
+void runWrapBenchmark(size_t maxBytes) {
+  const size_t MB = 1024u * 1024u;
+  std::string text = generateSourceText(std::min<size_t>(maxBytes, 16 * MB));
+
+  // Long lines are what wrapping is about: join every 8 generated lines into one
+  std::vector<std::string> lines(1);
+  int joined = 0;
+  for (char c : text) {
+    if (c != '\n') {
+      lines.back().push_back(c);
+    } else if (++joined % 8 == 0) {
+      lines.back().push_back('\n');
+      lines.emplace_back();
+    } else {
+      lines.back().push_back(' ');
+    }
+  }
+
+  std::vector<LineBreaks> breaks(lines.size());
+  Arena arena;
+  double build = bestOfMs(3, [&]() {
+    for (size_t i = 0; i < lines.size(); ++i)
+      breaks[i].build(lines[i].data(), lines[i].size(), LineEncoding::Ascii, arena); // Generated text is ASCII
+  });
+
+  // A drag from 40 to 200 columns
+  volatile size_t sink = 0;
+  double legacy = bestOfMs(1, [&]() {
+    for (int maxChars = 40; maxChars <= 200; ++maxChars) {
+      for (const std::string& line : lines)
+        sink = sink + legacyWrap(line, maxChars);
+    }
+  });
+  double walk = bestOfMs(3, [&]() {
+    for (int maxChars = 40; maxChars <= 200; ++maxChars) {
+      for (size_t i = 0; i < lines.size(); ++i) {
+        size_t editorLines = 0;
+        breaks[i].wrap(static_cast<int>(lines[i].size()), maxChars, [&editorLines](int, int) { ++editorLines; });
+        sink = sink + editorLines;
+      }
+    }
+  });
+
+  std::printf("%zu lines, %.1f MB\n", lines.size(), text.size() / static_cast<double>(MB));
+  std::printf("%-24s %10.2f ms\n", "build breaks", build);
+  std::printf("%-24s %10.2f ms\n", "legacy, 161 widths", legacy);
+  std::printf("%-24s %10.2f ms\n", "breaks, 161 widths", walk);
+}
@@ -0,0 +1,66 @@
+#include <Benchmarks/Benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+  struct BenchmarkEntry {
+    const char *name;
+    void (*run)(size_t maxBytes);
+  };
+
+  const BenchmarkEntry benchmarks[] = {
+    {"linescan", runLineScanBenchmark},
+    {"lexer", runLexerBenchmark},
+    {"literals", runNumericLiteralBenchmark},
+    {"keywords", runKeywordsBenchmark},
+    {"highlight", runHighlightBenchmark},
+    {"minimap", runMiniMapBenchmark},
+    {"wrap", runWrapBenchmark},
+    {"arena", runArenaBenchmark}
+  };
+}
+
+std::string generateSourceText(size_t size) {
+  static const char *tokens[] = { "int", "return", "std::vector<int>", "value", "=", "+", "(", ")", "{", "}",
+                                  ";", "// comment", "\"string\"", "0x1F", "42", "if", "else", "for" };
+  std::mt19937 rng(42);
+  std::string text;
+  text.reserve(size);
+  while (text.size() < size) {
+    text.append(std::string(4 * (rng() % 4), ' ')); // Indentation
+    unsigned count = rng() % 10;
+    for (unsigned i = 0; i < count; ++i) {
+      text.append(tokens[rng() % (sizeof(tokens) / sizeof(tokens[0]))]);
+      text.push_back(' ');
+    }
+    text.push_back('\n');
+  }
+  text.resize(size);
+  return text;
+}
+
+// Usage: benchmarks [--max-mb N] [name...]
+int main(int argc, char *argv[]) {
+  size_t maxBytes = 1024u * 1024u * 1024u;
+  std::vector<const char*> selected;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--max-mb") == 0 && i + 1 < argc)
+      maxBytes = static_cast<size_t>(std::atoll(argv[++i])) * 1024u * 1024u;
+    else
+      selected.push_back(argv[i]);
+  }
+
+  for (auto& benchmark : benchmarks) {
+    bool run = selected.empty();
+    for (auto name : selected)
+      run |= std::strcmp(name, benchmark.name) == 0;
+    if (!run)
+      continue;
+    std::printf("== %s ==\n", benchmark.name);
+    benchmark.run(maxBytes);
+  }
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <Tests/Test.h>
+#include <UI/CodeTextEdit/EditorLineIndex.h>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Random edits of an EditorLineIndex must agree with a plain vector of counts. Enough lines are
+// inserted and removed for chunks to be split and joined many times
+
+namespace {
+
+  bool matches(const EditorLineIndex& index, const std::vector<int>& counts) {
+    const int lines = static_cast<int>(counts.size());
+    std::vector<int> firstEditorLines(lines + 1, 0);
+    std::partial_sum(counts.begin(), counts.end(), firstEditorLines.begin() + 1);
+    if (!CHECK(index.lineCount() == lines) || !CHECK(index.editorLineCount() == firstEditorLines[lines]))
+      return false;
+    for (int line = 0; line <= lines; ++line) {
+      if (line < lines && !CHECK(index.count(line) == counts[line]))
+        return false;
+      if (!CHECK(index.firstEditorLine(line) == firstEditorLines[line]))
+        return false;
+    }
+    // An editor line belongs to the last line it doesn't precede (lines without editor lines are skipped)
+    if (!CHECK(index.lineAt(-1) == 0))
+      return false;
+    int line = 0;
+    for (int editorLine = 0; editorLine <= firstEditorLines[lines] + 1; ++editorLine) {
+      while (line < lines && firstEditorLines[line + 1] <= editorLine)
+        ++line;
+      if (!CHECK(index.lineAt(editorLine) == line))
+        return false;
+    }
+    return true;
+  }
+}
+
+void testEditorLineIndex() {
+  EditorLineIndex index;
+  std::vector<int> counts;
+  CHECK(matches(index, counts));
+
+  index.build({1, 0, 3});
+  counts = {1, 0, 3};
+  CHECK(index.lineAt(1) == 2); // The line without editor lines is skipped
+  CHECK(matches(index, counts));
+
+  std::mt19937 random(7);
+  auto randomCount = [&random]() { return static_cast<int>(random() % 4); }; // 0 if not wrapped yet
+  counts.resize(300);
+  for (int& count : counts)
+    count = randomCount();
+  index.build(counts);
+  CHECK(matches(index, counts));
+
+  for (int step = 0; step < 4000; ++step) {
+    const int lines = static_cast<int>(counts.size());
+    const int action = static_cast<int>(random() % 10);
+    // Grow during the first half and shrink to nothing during the second one
+    const bool growing = (step < 2000);
+    if (lines > 0 && action < 3) {
+      const int line = static_cast<int>(random() % lines);
+      const int count = randomCount();
+      index.set(line, count);
+      counts[line] = count;
+    } else if (lines == 0 || action < (growing ? 8 : 4)) {
+      const int line = static_cast<int>(random() % (lines + 1));
+      const int count = randomCount();
+      index.insert(line, count);
+      counts.insert(counts.begin() + line, count);
+    } else {
+      const int line = static_cast<int>(random() % lines);
+      index.remove(line);
+      counts.erase(counts.begin() + line);
+    }
+    if (step % 97 == 0 && !matches(index, counts))
+      return;
+  }
+  CHECK(matches(index, counts));
+
+  // Many lines in the same place
+  const int middle = static_cast<int>(counts.size()) / 2;
+  for (int i = 0; i < 1000; ++i) {
+    index.insert(middle, 1);
+    counts.insert(counts.begin() + middle, 1);
+  }
+  CHECK(matches(index, counts));
+
+  while (!counts.empty()) {
+    index.remove(0);
+    counts.erase(counts.begin());
+  }
+  CHECK(matches(index, counts));
+  index.insert(0, 2);
+  counts.insert(counts.begin(), 2);
+  CHECK(matches(index, counts));
+}
@@ -0,0 +1,144 @@
+#include <Tests/Test.h>
+#include <UI/CodeTextEdit/LineBreaks.h>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Wrapping a line through its breaks must give the same editor lines as a greedy wrap which looks
+// for break opportunities in the text itself
+
+namespace {
+
+  typedef std::vector<std::pair<int, int>> EditorLines; // (start, length)
+
+  EditorLines wrap(const LineBreaks& breaks, const std::string& line, int maxChars) {
+    EditorLines lines;
+    breaks.wrap(static_cast<int>(line.size()), maxChars, [&lines](int start, int length) {
+      lines.emplace_back(start, length);
+    });
+    return lines;
+  }
+
+  // Single-byte lines only: every byte is a column
+  EditorLines referenceWrap(const std::string& line, int maxChars) {
+    auto isBreak = [&line](int offset) {
+      return offset > 0 && offset < static_cast<int>(line.size()) &&
+             (line[offset] == ' ' || line[offset - 1] == ',' || line[offset - 1] == ';');
+    };
+    EditorLines lines;
+    int start = 0;
+    const int length = static_cast<int>(line.size());
+    while (length - start > maxChars) {
+      int end = start + maxChars;
+      while (end > start && !isBreak(end))
+        --end;
+      if (end == start)
+        end = start + maxChars;
+      lines.emplace_back(start, end - start);
+      start = end;
+    }
+    lines.emplace_back(start, length - start);
+    return lines;
+  }
+}
+
+void testLineBreaks() {
+  Arena arena;
+  LineBreaks breaks;
+
+  // Bytes which lead CJK sequences in UTF-8 are accented letters in Latin-1: no breaks around them
+  const std::string latin1 = "d\xE9j\xE0 \xE9t\xE9, caf\xE9";
+  breaks.build(latin1.data(), latin1.size(), LineEncoding::Latin1, arena);
+  CHECK(breaks.size() == 2);
+  CHECK((wrap(breaks, latin1, 6) == EditorLines{{0, 4}, {4, 5}, {9, 5}}));
+
+  const std::string cjk = "\xE6\xBC\xA2\xE5\xAD\x97\xE6\xBC\xA2\xE5\xAD\x97"; // Four ideographs
+  breaks.build(cjk.data(), cjk.size(), LineEncoding::Utf8, arena);
+  CHECK(breaks.size() == 3);
+  CHECK((wrap(breaks, cjk, 7) == EditorLines{{0, 6}, {6, 6}}));
+
+  // UTF-8 lines are wrapped at a width in characters, at character boundaries
+  auto wrapUtf8 = [](const LineBreaks& utf8Breaks, const std::string& line, int maxChars) {
+    std::vector<int> starts; // Of every character, then the line length
+    for (size_t i = 0; i < line.size(); ++i) {
+      if (isCharacterBoundary(line.data(), i))
+        starts.push_back(static_cast<int>(i));
+    }
+    starts.push_back(static_cast<int>(line.size()));
+    EditorLines lines;
+    utf8Breaks.wrap(static_cast<int>(line.size()), maxChars, [&lines](int start, int length) {
+      lines.emplace_back(start, length);
+    }, [&starts](int offset) {
+      return static_cast<int>(std::lower_bound(starts.begin(), starts.end(), offset) - starts.begin());
+    }, [&starts](int column) {
+      return starts[std::min<size_t>(column, starts.size() - 1)];
+    });
+    return lines;
+  };
+  const std::string accented = "\xC3\xA0\xC3\xA0\xC3\xA0\xC3\xA0 \xC3\xA0\xC3\xA0\xC3\xA0"; // Eight characters
+  breaks.build(accented.data(), accented.size(), LineEncoding::Utf8, arena);
+  CHECK((wrapUtf8(breaks, accented, 5) == EditorLines{{0, 8}, {8, 7}}));
+  CHECK((wrapUtf8(breaks, accented, 8) == EditorLines{{0, 15}}));
+  CHECK((wrapUtf8(breaks, accented, 3) == EditorLines{{0, 6}, {6, 2}, {8, 5}, {13, 2}}));
+
+  // A line being typed into is built again after every keystroke: the storage it leaves behind in
+  // the arena must stay proportional to its final size
+  Arena typingArena;
+  LineBreaks typed;
+  std::string typing;
+  for (int i = 0; i < 20000; ++i) {
+    typing += "ab ";
+    typed.build(typing.data(), typing.size(), LineEncoding::Ascii, typingArena);
+  }
+  CHECK(typed.size() == 20000);
+  CHECK(typingArena.statistics().bytesUsed <= 4 * typed.size() * sizeof(uint32_t) + 64);
+
+  std::mt19937 rng(5);
+  for (int round = 0; round < 3000; ++round) {
+    std::string line;
+    // Mostly short lines, a few past 64K to use 32-bit offsets
+    size_t length = (round % 500 == 0) ? 70000 + rng() % 1000 : rng() % 300;
+    for (size_t i = 0; i < length; ++i)
+      line.push_back("aaaab ,;"[rng() % 8]);
+    if (round % 100 == 0) {
+      arena.reset();
+      breaks = LineBreaks(); // Its storage went away with the reset
+    }
+    breaks.build(line.data(), line.size(), LineEncoding::Ascii, arena);
+    for (int maxChars : { 1, 7, 10, 80, 200 }) {
+      if (!CHECK(wrap(breaks, line, maxChars) == referenceWrap(line, maxChars)))
+        return;
+    }
+  }
+
+  // Threads allocating from the same arena (each from a region of its own) never get the same memory
+  Arena sharedArena(1024);
+  const int THREADS = 4, ALLOCATIONS = 5000;
+  std::vector<std::vector<std::pair<uint32_t*, size_t>>> allocations(THREADS);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&sharedArena, &allocations, t]() {
+      std::mt19937 random(t);
+      for (int i = 0; i < ALLOCATIONS; ++i) {
+        const size_t count = 1 + random() % 40;
+        uint32_t *values = sharedArena.allocateArray<uint32_t>(count);
+        std::fill(values, values + count, static_cast<uint32_t>(t * ALLOCATIONS + i));
+        allocations[t].emplace_back(values, count);
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (int t = 0; t < THREADS; ++t) {
+    for (int i = 0; i < ALLOCATIONS; ++i) {
+      const auto& allocation = allocations[t][i];
+      const uint32_t expected = static_cast<uint32_t>(t * ALLOCATIONS + i);
+      if (!CHECK(std::all_of(allocation.first, allocation.first + allocation.second,
+                             [expected](uint32_t value) { return value == expected; })))
+        return;
+    }
+  }
+  CHECK(sharedArena.statistics().allocations == static_cast<size_t>(THREADS * ALLOCATIONS));
+}
@@ -0,0 +1,68 @@
+#include <Tests/Test.h>
+#include <UI/CodeTextEdit/Buffer/LineScanner.h>
+#include <UI/CodeTextEdit/Buffer/LineIndex.h>
+#include <random>
+#include <vector>
+
+// Every kernel the CPU supports must find the same line starts (and the same '\r'/'\t' flags) as
+// a plain loop, whatever the alignment of the data and the amount of data left for the scalar tail
+
+namespace {
+
+  template <typename Offset>
+  LineScanResult referenceScan(const std::string& text, size_t baseOffset, std::vector<Offset>& lineStarts) {
+    LineScanResult result;
+    for (size_t i = 0; i < text.size(); ++i) {
+      if (text[i] == '\n')
+        lineStarts.push_back(static_cast<Offset>(baseOffset + i + 1));
+      result.hasCarriageReturns |= text[i] == '\r';
+      result.hasTabs |= text[i] == '\t';
+    }
+    return result;
+  }
+
+  template <typename Offset>
+  bool sameScan(ScanKernel kernel, const std::string& text, size_t baseOffset) {
+    std::vector<Offset> expected{0}, found{0};
+    LineScanResult expectedResult = referenceScan(text, baseOffset, expected);
+    LineScanResult result = scanLineStarts(kernel, text.data(), text.size(), baseOffset, found);
+    return CHECK(found == expected) &&
+           CHECK(result.hasCarriageReturns == expectedResult.hasCarriageReturns) &&
+           CHECK(result.hasTabs == expectedResult.hasTabs);
+  }
+}
+
+void testLineScanner() {
+  std::mt19937 rng(7);
+  const char alphabet[] = { 'a', ' ', '\n', '\r', '\t', '\xE9' };
+  const ScanKernel kernels[] = { ScanKernel::Scalar, ScanKernel::SSE2, ScanKernel::AVX2 };
+
+  for (int round = 0; round < 2000; ++round) {
+    // Short buffers exercise the tails, the padding makes the data start at any alignment
+    size_t size = (round % 10 == 0) ? rng() % 5000 : rng() % 200;
+    size_t padding = rng() % 64;
+    std::string buffer(padding, 'x');
+    for (size_t i = 0; i < size; ++i)
+      buffer.push_back(alphabet[rng() % ((round % 3 == 0) ? 3 : sizeof(alphabet))]);
+    std::string text = buffer.substr(padding);
+    size_t baseOffset = rng() % 1000;
+
+    for (ScanKernel kernel : kernels) {
+      if (!scanKernelSupported(kernel))
+        continue;
+      if (!sameScan<uint32_t>(kernel, text, baseOffset) || !sameScan<uint64_t>(kernel, text, baseOffset))
+        return;
+    }
+  }
+
+  // The index built on top of the scanner
+  std::string text = "first\nsecond\r\n\n\tlast";
+  LineIndex index;
+  index.build(text.data(), text.size());
+  CHECK(index.lineCount() == 4);
+  CHECK(index.lineStart(1) == 6);
+  CHECK(index.lineLength(1) == 8);
+  CHECK(index.lineAt(0) == 0 && index.lineAt(5) == 0 && index.lineAt(6) == 1 && index.lineAt(15) == 3);
+  CHECK(index.lineStart(4) == text.size());
+  CHECK(index.hasCarriageReturns() && index.hasTabs());
+}
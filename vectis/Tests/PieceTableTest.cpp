@@ -0,0 +1,134 @@
+#include <Tests/Test.h>
+#include <UI/CodeTextEdit/Buffer/PieceTable.h>
+#include <UI/CodeTextEdit/Buffer/LineScanner.h>
+#include <random>
+
+// Random edits applied both to a piece table and to a std::string: after every edit the table must
+// hold the same text and answer every line query as the string would
+
+namespace {
+
+  bool sameAsModel(const PieceTable& table, const std::string& model) {
+    if (!CHECK(table.size() == model.size()) || !CHECK(table.text() == model))
+      return false;
+    size_t line = 0, lineStart = 0;
+    for (size_t offset = 0; offset <= model.size(); ++offset) {
+      if (offset > 0 && model[offset - 1] == '\n') {
+        ++line;
+        lineStart = offset;
+      }
+      if (!CHECK(table.lineAt(offset) == line) || !CHECK(table.lineStart(line) == lineStart))
+        return false;
+      if (offset < model.size() && !CHECK(table.at(offset) == model[offset]))
+        return false;
+    }
+    return CHECK(table.lineCount() == line + 1) && CHECK(table.lineStart(line + 1) == model.size());
+  }
+
+  // Chunks must cover the requested range, in order, with the right contents
+  bool sameChunks(const PieceTable& table, const std::string& model, size_t offset, size_t length) {
+    std::string joined;
+    size_t expectedOffset = offset;
+    bool contiguous = true;
+    table.forEachChunk(offset, length, [&](const PieceTable::Chunk& chunk) {
+      contiguous &= chunk.offset == expectedOffset;
+      expectedOffset += chunk.size;
+      joined.append(chunk.data, chunk.size);
+    });
+    return CHECK(contiguous) && CHECK(joined == model.substr(offset, length));
+  }
+}
+
+void testPieceTable() {
+  std::mt19937 rng(3);
+  for (int round = 0; round < 100; ++round) {
+    std::string original;
+    size_t originalSize = rng() % 200;
+    for (size_t i = 0; i < originalSize; ++i)
+      original.push_back("ab\n"[rng() % 3]);
+
+    PieceTable table;
+    if (round % 2 == 0)
+      table.reset(original.data(), original.size());
+    else
+      table.reset(original);
+    std::string model = original;
+
+    for (int edit = 0; edit < 200; ++edit) {
+      if (rng() % 3 != 0) {
+        size_t offset = rng() % (model.size() + 1);
+        std::string text;
+        for (size_t i = 0, n = 1 + rng() % 5; i < n; ++i)
+          text.push_back("xy\n"[rng() % 3]);
+        table.insert(offset, text);
+        model.insert(offset, text);
+        // Typing right after the insertion extends the last piece instead of adding new ones
+        for (int i = 0; i < 3; ++i) {
+          offset += text.size();
+          text = (rng() % 3 == 0) ? "\n" : "z";
+          table.insert(offset, text);
+          model.insert(offset, text);
+        }
+      } else if (!model.empty()) {
+        size_t offset = rng() % model.size();
+        size_t length = std::min<size_t>(rng() % 10, model.size() - offset);
+        table.remove(offset, length);
+        model.erase(offset, length);
+      }
+      if (!sameAsModel(table, model))
+        return;
+      size_t offset = rng() % (model.size() + 1);
+      if (!sameChunks(table, model, offset, rng() % (model.size() - offset + 1)))
+        return;
+    }
+  }
+
+  // A file loaded a chunk at a time (see FileText), edited while it's being loaded: every chunk is
+  // appended to the end of the document, wherever the edits left it
+  for (int round = 0; round < 50; ++round) {
+    std::string original;
+    for (size_t i = 0, n = rng() % 2000; i < n; ++i)
+      original.push_back("ab\n"[rng() % 3]);
+
+    PieceTable table;
+    table.resetGrowing(original.data(), original.size());
+    std::string model;
+    size_t read = 0;
+    while (read < original.size()) {
+      size_t end = std::min(original.size(), read + 1 + rng() % 300);
+      end = std::min(original.size(), original.find('\n', end - 1) + 1); // npos + 1 is 0
+      if (end == 0)
+        end = original.size();
+      std::vector<uint64_t> lineStarts;
+      scanLineStarts(original.data() + read, end - read, read, lineStarts);
+      table.appendOriginal(end - read, lineStarts);
+      model.append(original, read, end - read);
+      read = end;
+      if (!sameAsModel(table, model))
+        return;
+
+      for (int edit = 0, edits = rng() % 3; edit < edits; ++edit) {
+        size_t offset = rng() % (model.size() + 1);
+        if (rng() % 2 == 0) {
+          const std::string text = (rng() % 2 == 0) ? "\n" : "xy";
+          table.insert(offset, text);
+          model.insert(offset, text);
+        } else {
+          size_t length = std::min<size_t>(rng() % 10, model.size() - offset);
+          table.remove(offset, length);
+          model.erase(offset, length);
+        }
+      }
+      if (!sameAsModel(table, model))
+        return;
+    }
+  }
+
+  PieceTable table;
+  table.reset(std::string("one\ntwo\n"));
+  CHECK(table.lineCount() == 3 && table.lineText(1) == "two\n" && table.lineLength(2) == 0);
+  table.clear();
+  CHECK(table.isEmpty() && table.lineCount() == 1);
+  table.insert(0, "a\nb");
+  CHECK(table.lineCount() == 2 && table.lineStart(1) == 2);
+}
@@ -0,0 +1,187 @@
+#include <Tests/Test.h>
+#include <UI/CodeTextEdit/Lexers/CPPLexer.h>
+#include <UI/CodeTextEdit/Buffer/PieceTable.h>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// Random edits to a C++ file held in a piece table, each one followed by an incremental relexing
+// of the edited region: the results must always be the ones of lexing the whole file again
+
+namespace {
+
+  bool sameLexing(const StyleDatabase& relexed, const StyleDatabase& full) {
+    if (!CHECK(relexed.lineCount() == full.lineCount()))
+      return false;
+    for (size_t line = 0; line < full.lineCount(); ++line) {
+      const StyleDatabase::Line& a = relexed.line(line);
+      const StyleDatabase::Line& b = full.line(line);
+      if (!CHECK(a.length == b.length) || !CHECK(a.checkpoint == b.checkpoint) || !CHECK(a.runCount == b.runCount))
+        return false;
+      for (uint32_t run = 0; run < b.runCount; ++run) {
+        if (!CHECK(a.runs[run].start == b.runs[run].start) ||
+            !CHECK(a.runs[run].length == b.runs[run].length) ||
+            !CHECK(a.runs[run].style == b.runs[run].style))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  void relexRandomEdits(const char *fileName, unsigned seed, int edits) {
+    std::string text = readTestFile(fileName);
+    if (!CHECK(!text.empty()))
+      return;
+    // Snippets which open and close scopes, comments, strings, macros and class declarations
+    const char *snippets[] = { "x", " ", "\n", "{", "}", "/*", "*/", "(", ";", "::", "\"", "foo(",
+                               "class A", "// c\n", "#define X \\\n" };
+    const size_t snippetCount = sizeof(snippets) / sizeof(snippets[0]);
+
+    PieceTable table;
+    table.reset(text.data(), text.size());
+    CPPLexer lexer;
+    StyleDatabase sdb;
+    lexer.lexInput(LexerInput(table), sdb);
+
+    std::mt19937 rng(seed);
+    for (int edit = 0; edit < edits; ++edit) {
+      size_t offset = rng() % (table.size() + 1);
+      size_t removed = 0;
+      if (rng() % 3 == 0 && offset < table.size()) {
+        // Now and then a few lines at once
+        removed = std::min<size_t>((rng() % 8 == 0) ? rng() % 200 + 1 : rng() % 5 + 1, table.size() - offset);
+        table.remove(offset, removed);
+      }
+      const char *snippet = snippets[rng() % snippetCount];
+      size_t added = (rng() % 4 == 0) ? 0 : std::strlen(snippet);
+      table.insert(offset, snippet, added);
+      if (rng() % 4 == 0 && offset + added < table.size()) {
+        // Another edit after this one before relexing: both are relexed in order
+        sdb.applyEdit(LexerInput(table), offset, removed, added);
+        const size_t next = offset + added + rng() % (table.size() - offset - added);
+        const char *nextSnippet = snippets[rng() % snippetCount];
+        table.insert(next, nextSnippet, std::strlen(nextSnippet));
+        sdb.applyEdit(LexerInput(table), next, 0, std::strlen(nextSnippet));
+        lexer.relexEdit(LexerInput(table), sdb, offset, added);
+        lexer.relexEdit(LexerInput(table), sdb, next, std::strlen(nextSnippet));
+      } else {
+        lexer.relexInput(LexerInput(table), sdb, offset, removed, added);
+      }
+
+      CPPLexer fullLexer;
+      StyleDatabase full;
+      fullLexer.lexInput(LexerInput(table), full);
+      if (!sameLexing(sdb, full)) {
+        std::printf("%s, seed %u: edit %d (offset %zu, %zu removed, %zu added) relexed differently\n",
+                    fileName, seed, edit, offset, removed, added);
+        return;
+      }
+    }
+  }
+
+  // An edit in the middle of a big file only relexes a few lines around it, both when it changes
+  // a line and when it adds or removes one
+  void relexBigFile() {
+    const std::string source = readTestFile("BasicBlock.cpp");
+    if (!CHECK(!source.empty()))
+      return;
+    std::string text;
+    while (text.size() < 4 * 1024 * 1024)
+      text += source;
+    PieceTable table;
+    table.reset(text.data(), text.size());
+    CPPLexer lexer;
+    StyleDatabase sdb;
+    lexer.lexInput(LexerInput(table), sdb);
+
+    const size_t offset = table.lineStart(table.lineCount() / 2) + 1;
+    const char *edits[] = { "x", "\n", "  " };
+    for (const char *edit : edits) {
+      table.insert(offset, edit, std::strlen(edit));
+      lexer.relexInput(LexerInput(table), sdb, offset, 0, std::strlen(edit));
+      CHECK(sdb.restyledTo - sdb.restyledFrom < 64);
+      table.remove(offset, std::strlen(edit));
+      lexer.relexInput(LexerInput(table), sdb, offset, std::strlen(edit), 0);
+      CHECK(sdb.restyledTo - sdb.restyledFrom < 64);
+    }
+    CPPLexer fullLexer;
+    StyleDatabase full;
+    fullLexer.lexInput(LexerInput(table), full);
+    sameLexing(sdb, full);
+  }
+
+  // Relexes an edit the way the document's lexing job does: on a copy of a window of text at a
+  // time, every patch ending at its last checkpoint and the next one resuming from there. Returns
+  // the number of windows
+  int relexInWindows(const PieceTable& table, StyleDatabase& sdb, size_t offset, size_t added, size_t window) {
+    size_t end = offset + added;
+    for (int windows = 1; ; ++windows) {
+      LexingStart start = sdb.resumePoint(LexerInput(table), offset, end - offset);
+      const size_t from = table.lineStart(start.line);
+      const size_t lastLine = table.lineAt(std::min(table.size(), start.convergeFrom + window));
+      const size_t to = table.lineStart(lastLine + 1);
+      CheckpointCopy previous;
+      sdb.copyCheckpoints(start.line, lastLine, previous);
+      const std::string text = table.text(from, to - from);
+      start.position -= from;
+      start.convergeFrom -= from;
+
+      CPPLexer lexer;
+      StylePatch patch;
+      lexer.lex(LexerInput(text.data(), text.size()), start, &previous, patch);
+      if (to == table.size() || patch.endsAtCheckpoint()) {
+        sdb.apply(patch);
+        return windows;
+      }
+      if (!CHECK(patch.cutAtLastCheckpoint()))
+        return windows;
+      const size_t resumeAt = table.lineStart(patch.lastLine()) + patch.lastColumn();
+      if (!CHECK(resumeAt > offset))
+        return windows;
+      offset = resumeAt;
+      end = std::max(end, offset + 1);
+      sdb.apply(patch);
+    }
+  }
+
+  // A scope opened near the start of a file changes the lexer state up to its end: the lexing goes
+  // on window after window, and gets back to the previous results once the scope is gone
+  void relexWindows() {
+    const std::string source = readTestFile("BasicBlock.cpp");
+    if (!CHECK(!source.empty()))
+      return;
+    std::string text;
+    while (text.size() < 256 * 1024)
+      text += source;
+    PieceTable table;
+    table.reset(text.data(), text.size());
+    CPPLexer lexer;
+    StyleDatabase sdb;
+    lexer.lexInput(LexerInput(table), sdb);
+
+    const size_t offset = table.lineStart(10);
+    table.insert(offset, "{", 1);
+    sdb.applyEdit(LexerInput(table), offset, 0, 1);
+    CHECK(relexInWindows(table, sdb, offset, 1, 4096) > 1);
+    CPPLexer fullLexer;
+    StyleDatabase full;
+    fullLexer.lexInput(LexerInput(table), full);
+    if (!sameLexing(sdb, full))
+      return;
+
+    table.remove(offset, 1);
+    sdb.applyEdit(LexerInput(table), offset, 1, 0);
+    relexInWindows(table, sdb, offset, 0, 4096);
+    StyleDatabase original;
+    fullLexer.lexInput(LexerInput(table), original);
+    sameLexing(sdb, original);
+  }
+}
+
+void testIncrementalRelex() {
+  relexBigFile();
+  relexWindows();
+  relexRandomEdits("BasicBlock.cpp", 3, 1500);
+  relexRandomEdits("BasicBlock.cpp", 7, 1500);
+  relexRandomEdits("SimpleFile.cpp", 11, 500);
+}
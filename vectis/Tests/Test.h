@@ -0,0 +1,20 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <string>
+
+// Reports a failed check (where it happened and what failed). Returns condition, so that a test
+// can give up on the first failure of a long sequence: if (!CHECK(...)) return;
+bool check(bool condition, const char *file, int line, const char *expression);
+#define CHECK(condition) check((condition), __FILE__, __LINE__, #condition)
+
+// Contents of a file in the TestData directory
+std::string readTestFile(const char *name);
+
+void testLineScanner();
+void testPieceTable();
+void testIncrementalRelex();
+void testLineBreaks();
+void testEditorLineIndex();
+
+#endif // TEST_H
@@ -0,0 +1,36 @@
+#-------------------------------------------------
+#
+# Tests for the parts of the editor which don't need a GUI.
+# Not part of the application build:
+#   qmake Tests.pro && make && ./tests [name...]
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+CONFIG   += console c++14
+CONFIG   -= app_bundle
+
+TARGET = tests
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/..
+DEFINES += VECTIS_TESTDATA=\\\"$$PWD/../TestData\\\"
+
+SOURCES += main.cpp \
+        LineScannerTest.cpp \
+        PieceTableTest.cpp \
+        RelexTest.cpp \
+        LineBreaksTest.cpp \
+        EditorLineIndexTest.cpp \
+        ../UI/CodeTextEdit/Buffer/LineScanner.cpp \
+        ../UI/CodeTextEdit/Buffer/LineIndex.cpp \
+        ../UI/CodeTextEdit/Buffer/PieceTable.cpp \
+        ../UI/CodeTextEdit/Arena.cpp \
+        ../UI/CodeTextEdit/LineBreaks.cpp \
+        ../UI/CodeTextEdit/EditorLineIndex.cpp \
+        ../UI/CodeTextEdit/Lexers/Lexer.cpp \
+        ../UI/CodeTextEdit/Lexers/LexerInput.cpp \
+        ../UI/CodeTextEdit/Lexers/CPPLexer.cpp
+
+HEADERS  += Test.h
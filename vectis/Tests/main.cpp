@@ -0,0 +1,56 @@
+#include <Tests/Test.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+  struct TestEntry {
+    const char *name;
+    void (*run)();
+  };
+
+  const TestEntry tests[] = {
+    {"linescanner", testLineScanner},
+    {"piecetable", testPieceTable},
+    {"relex", testIncrementalRelex},
+    {"linebreaks", testLineBreaks},
+    {"editorlineindex", testEditorLineIndex}
+  };
+
+  int failures = 0;
+}
+
+bool check(bool condition, const char *file, int line, const char *expression) {
+  if (!condition) {
+    std::printf("%s:%d: check failed: %s\n", file, line, expression);
+    ++failures;
+  }
+  return condition;
+}
+
+std::string readTestFile(const char *name) {
+  std::ifstream file(std::string(VECTIS_TESTDATA) + "/" + name, std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+// Usage: tests [name...]. Exits with a non-zero status if any check failed
+int main(int argc, char *argv[]) {
+  std::vector<const char*> selected(argv + 1, argv + argc);
+
+  for (auto& test : tests) {
+    bool run = selected.empty();
+    for (auto name : selected)
+      run |= std::strcmp(name, test.name) == 0;
+    if (!run)
+      continue;
+    int failuresBefore = failures;
+    test.run();
+    std::printf("%-16s %s\n", test.name, (failures == failuresBefore) ? "passed" : "FAILED");
+  }
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include <UI/CodeTextEdit/Arena.h>
+#include <algorithm>
+#include <new>
+
+// Functions reserved for this TU's internal use
+namespace {
+
+  const size_t REGION_SIZE = 16 * 1024; // Handed to a thread at a time (less if blocks are smaller)
+  const size_t CACHE_LINE = 64;
+  const int CACHED_REGIONS = 4; // Per thread: the arenas a thread uses at the same time
+
+  std::atomic<uint64_t> nextArenaId(1);
+
+  // The regions a thread is allocating from, most recently handed out first
+  struct CachedRegion {
+    uint64_t arenaId = 0;
+    void *region = nullptr;
+  };
+  thread_local CachedRegion cachedRegions[CACHED_REGIONS];
+}
+
+Arena::Arena(size_t blockSize) :
+  m_blockSize(blockSize),
+  m_id(nextArenaId.fetch_add(1))
+{
+}
+
+Arena::Region *Arena::cachedRegion() const {
+  for (const CachedRegion& cached : cachedRegions) {
+    if (cached.arenaId == m_id)
+      return static_cast<Region*>(cached.region);
+  }
+  return nullptr;
+}
+
+// Carves a region out of the last block (adding one if needed) for the calling thread and
+// allocates from it. Allocations bigger than a region get one of their own size
+void *Arena::allocateInNewRegion(size_t size, size_t alignment) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // The region starts with its bookkeeping, on a cache line of its own: threads don't write
+  // to the same lines when they allocate
+  const size_t header = CACHE_LINE + sizeof(Region);
+  const size_t regionSize = header + std::max(std::min(REGION_SIZE, m_blockSize), size + alignment);
+  if (m_blocks.empty() || m_used + regionSize > m_blocks.back().size)
+    addBlock(regionSize);
+  char *start = m_blocks.back().data.get() + m_used;
+  char *end = start + regionSize;
+  m_used += regionSize;
+
+  Region *region = new (alignUp(start, CACHE_LINE)) Region();
+  char *p = alignUp(reinterpret_cast<char*>(region + 1), alignment);
+  region->next.store(p + size, std::memory_order_relaxed);
+  region->end = end;
+  region->allocations.store(1, std::memory_order_relaxed);
+  region->bytesUsed.store(size, std::memory_order_relaxed);
+  m_regions.push_back(region);
+
+  // Replace this arena's previous region, or else the least recently handed out one
+  int slot = CACHED_REGIONS - 1;
+  for (int i = 0; i < CACHED_REGIONS; ++i) {
+    if (cachedRegions[i].arenaId == m_id) {
+      slot = i;
+      break;
+    }
+  }
+  for (int i = slot; i > 0; --i)
+    cachedRegions[i] = cachedRegions[i - 1];
+  cachedRegions[0] = CachedRegion{m_id, region};
+  return p;
+}
+
+// Blocks double in size (up to 64 times the initial one) so that a big pass needs just a few
+void Arena::addBlock(size_t minimumSize) {
+  size_t size = m_blockSize;
+  if (!m_blocks.empty())
+    size = std::min(m_blocks.back().size * 2, m_blockSize * 64);
+  size = std::max(size, minimumSize);
+  m_blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+  m_used = 0;
+  m_statistics.bytesReserved += size;
+  ++m_statistics.blocks;
+}
+
+void Arena::reset() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_id = nextArenaId.fetch_add(1); // Regions cached by any thread aren't found anymore
+  m_regions.clear();
+  if (!m_blocks.empty()) {
+    auto largest = std::max_element(m_blocks.begin(), m_blocks.end(), [](const Block& a, const Block& b) {
+      return a.size < b.size;
+    });
+    Block kept = std::move(*largest);
+    m_blocks.clear();
+    m_blocks.push_back(std::move(kept));
+  }
+  m_used = 0;
+  const size_t resets = m_statistics.resets + 1;
+  m_statistics = Statistics();
+  m_statistics.resets = resets;
+  m_statistics.blocks = m_blocks.size();
+  m_statistics.bytesReserved = m_blocks.empty() ? 0 : m_blocks.back().size;
+}
+
+Arena::Statistics Arena::statistics() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Statistics statistics = m_statistics;
+  for (const Region *region : m_regions) {
+    statistics.allocations += region->allocations.load(std::memory_order_relaxed);
+    statistics.bytesUsed += region->bytesUsed.load(std::memory_order_relaxed);
+  }
+  return statistics;
+}
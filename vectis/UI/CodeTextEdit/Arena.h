@@ -0,0 +1,114 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// A monotonic allocator: memory is handed out of large blocks by bumping a pointer and is never
+// given back one allocation at a time. Everything is freed in one shot by reset(), which keeps
+// the largest block around so that the next pass doesn't have to fault its pages in again.
+//
+// Every thread allocates from a region of a block of its own, found through a small per-thread
+// cache: the lock is only taken to hand out a new region (lines are wrapped in parallel).
+// Allocating is thread-safe, resetting is not
+class Arena {
+public:
+  struct Statistics {
+    size_t allocations = 0; // Since the last reset
+    size_t bytesUsed = 0;
+    size_t bytesReserved = 0; // In blocks
+    size_t blocks = 0;
+    size_t resets = 0;
+  };
+
+  explicit Arena(size_t blockSize = 64 * 1024);
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void *allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+    if (Region *region = cachedRegion()) {
+      char *next = region->next.load(std::memory_order_relaxed);
+      char *p = alignUp(next, alignment);
+      if (p + size <= region->end) {
+        // Only this thread writes to its region: relaxed stores, for statistics() to read
+        region->next.store(p + size, std::memory_order_relaxed);
+        region->allocations.store(region->allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        region->bytesUsed.store(region->bytesUsed.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+        return p;
+      }
+    }
+    return allocateInNewRegion(size, alignment);
+  }
+  template <typename T>
+  T *allocateArray(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+
+  // Frees every allocation at once. No thread may be allocating
+  void reset();
+
+  Statistics statistics() const;
+
+private:
+  // The part of a block a single thread allocates from (nothing to destroy)
+  struct Region {
+    std::atomic<char*> next;
+    char *end;
+    std::atomic<size_t> allocations;
+    std::atomic<size_t> bytesUsed;
+  };
+
+  static char *alignUp(char *p, size_t alignment) {
+    return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + alignment - 1) & ~uintptr_t(alignment - 1));
+  }
+  Region *cachedRegion() const;
+  void *allocateInNewRegion(size_t size, size_t alignment);
+  void addBlock(size_t minimumSize);
+
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  const size_t m_blockSize;
+  uint64_t m_id; // Per-thread caches find their region by this, a new one after every reset
+  std::vector<Block> m_blocks; // The last one is being carved into regions
+  size_t m_used = 0; // In the last block
+  std::vector<Region*> m_regions; // Stored at the start of the regions themselves
+  Statistics m_statistics; // Allocations and bytes used are kept by the regions
+  mutable std::mutex m_mutex;
+};
+
+// Standard allocator interface over an Arena, for containers whose contents all go away at the
+// same time. Deallocating does nothing: a container growing in an arena leaves its previous
+// storage behind until the arena is reset, reserve() what's needed where possible
+template <typename T>
+class ArenaAllocator {
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  explicit ArenaAllocator(Arena& arena) : m_arena(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) {}
+
+  T *allocate(size_t count) { return m_arena->allocateArray<T>(count); }
+  void deallocate(T *, size_t) {}
+
+  Arena *arena() const { return m_arena; }
+
+private:
+  Arena *m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() == b.arena(); }
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() != b.arena(); }
+
+#endif // ARENA_H
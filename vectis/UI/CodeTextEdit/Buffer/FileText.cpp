@@ -0,0 +1,98 @@
+#include <UI/CodeTextEdit/Buffer/FileText.h>
+#include <UI/CodeTextEdit/Buffer/LineScanner.h>
+#include <algorithm>
+#include <cstring>
+
+namespace { // Functions reserved for this TU's internal use
+
+  const char TABULATION_MARKER = 0x07;
+  const size_t TABULATION_WIDTH = 4;
+
+  size_t countOf(char c, const char *data, size_t size) {
+    size_t count = 0;
+    for (const char *p = data, *end = data + size; (p = static_cast<const char*>(std::memchr(p, c, end - p))) != nullptr; ++p)
+      ++count;
+    return count;
+  }
+
+  // The first c in [from; end), end if there's none
+  const char *find(char c, const char *from, const char *end) {
+    const void *found = std::memchr(from, c, end - from);
+    return (found != nullptr) ? static_cast<const char*>(found) : end;
+  }
+
+  // Where the line containing offset ends: after its '\n', '\r' or "\r\n"
+  size_t lineEnd(const char *data, size_t offset, size_t size) {
+    const char *newline = find('\n', data + offset, data + size);
+    const char *end = find('\r', data + offset, newline);
+    if (end == data + size)
+      return size;
+    if (*end == '\r' && end + 1 < data + size && end[1] == '\n')
+      ++end;
+    return static_cast<size_t>(end - data) + 1;
+  }
+
+}
+
+bool FileText::open(const QString& path) {
+  m_converted.reset();
+  m_fileSize = m_fileRead = m_size = 0;
+  if (!m_file.open(path))
+    return false;
+  m_fileSize = m_file.size();
+
+  // Line endings are stored as '\n': "\r\n" and lone '\r' only ever make the text shorter
+  const size_t tabs = countOf('\t', m_file.data(), m_file.size());
+  const bool carriageReturns = std::memchr(m_file.data(), '\r', m_file.size()) != nullptr;
+  m_maximumSize = m_file.size() + tabs * (TABULATION_WIDTH - 1);
+  if (tabs == 0 && !carriageReturns) {
+    m_data = m_file.data();
+  } else {
+    m_converted.reset(new char[m_maximumSize]);
+    m_data = m_converted.get();
+  }
+  return true;
+}
+
+size_t FileText::readChunk(size_t bytes, std::vector<uint64_t>& lineStarts) {
+  const char *file = m_file.data();
+  const size_t fileSize = m_file.size();
+  const size_t from = m_fileRead;
+  size_t to = std::min(fileSize, from + bytes);
+  if (to < fileSize) // Up to the end of the line, never between the '\r' and the '\n' of a "\r\n"
+    to = lineEnd(file, to, fileSize);
+
+  const size_t start = m_size;
+  if (!m_converted) {
+    m_size = to;
+  } else {
+    char *out = m_converted.get() + m_size;
+    const char *nextTab = nullptr, *nextReturn = nullptr; // Searched again once passed
+    for (size_t i = from; i < to;) {
+      if (nextTab < file + i)
+        nextTab = find('\t', file + i, file + to);
+      if (nextReturn < file + i)
+        nextReturn = find('\r', file + i, file + to);
+      const size_t run = static_cast<size_t>(std::min(nextTab, nextReturn) - file) - i;
+      std::memcpy(out, file + i, run);
+      out += run;
+      i += run;
+      if (i == to)
+        break;
+      if (file[i] == '\t') {
+        out = std::fill_n(out, TABULATION_WIDTH, TABULATION_MARKER);
+      } else {
+        *out++ = '\n';
+        if (i + 1 < to && file[i + 1] == '\n')
+          ++i;
+      }
+      ++i;
+    }
+    m_size = static_cast<size_t>(out - m_converted.get());
+  }
+  m_fileRead = to;
+  scanLineStarts(m_data + start, m_size - start, start, lineStarts);
+  if (m_converted && atEnd())
+    m_file.close(); // Its pages would be a second copy of the text
+  return m_size;
+}
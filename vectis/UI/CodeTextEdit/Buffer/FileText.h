@@ -0,0 +1,50 @@
+#ifndef FILETEXT_H
+#define FILETEXT_H
+
+#include <UI/CodeTextEdit/Buffer/MappedFile.h>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// The text of a file as a document stores it, read a chunk at a time. The file is memory-mapped and
+// used as is unless its text has to be converted (tabs are stored as 4 0x07 BELL ascii chars, i.e.
+// tabulation markers, so that every character takes exactly one cell, and "\r\n" or lone '\r' line
+// endings as '\n', as in QFile::Text mode for the former): the converted text then goes
+// to a buffer allocated once for all of it, and the file is unmapped once it's all read. Either way
+// the text never moves, the chunks read so far can be used (e.g. by a PieceTable) while the next
+// ones are read in another thread.
+//
+// Chunks end with a line: the starts of the lines in a chunk are found while reading it.
+class FileText {
+public:
+  FileText() = default;
+  FileText(const FileText&) = delete;
+  FileText& operator=(const FileText&) = delete;
+
+  // Opens the file, nothing is read yet. Returns true on success
+  bool open(const QString& path);
+
+  const char *data() const { return m_data; }
+  // Of the whole text, once read
+  size_t maximumSize() const { return m_maximumSize; }
+  // Bytes of the file read so far and in total
+  size_t fileRead() const { return m_fileRead; }
+  size_t fileSize() const { return m_fileSize; }
+  bool atEnd() const { return m_fileRead == m_fileSize; }
+
+  // Reads the next chunk of about 'bytes' bytes of the file (up to the end of a line), appending the
+  // starts of the lines it contains to lineStarts. Returns the size of the text read so far
+  size_t readChunk(size_t bytes, std::vector<uint64_t>& lineStarts);
+
+private:
+  MappedFile m_file;
+  std::unique_ptr<char[]> m_converted; // Only if the text had to be converted
+  const char *m_data = nullptr;
+  size_t m_maximumSize = 0;
+  size_t m_fileSize = 0;
+  size_t m_fileRead = 0;
+  size_t m_size = 0; // Of the text read so far
+};
+
+#endif // FILETEXT_H
@@ -0,0 +1,71 @@
+#include <UI/CodeTextEdit/Buffer/LineIndex.h>
+#include <UI/CodeTextEdit/Buffer/LineScanner.h>
+#include <algorithm>
+#include <limits>
+
+namespace { // Functions reserved for this TU's internal use
+
+  template <typename Offset>
+  LineScanResult buildStarts(const char *data, size_t size, std::vector<Offset>& starts) {
+    starts.clear();
+    // Source code averages well above 16 bytes per line: avoid most of the reallocations
+    starts.reserve(size / 32 + 1);
+    starts.push_back(0);
+    LineScanResult result = scanLineStarts(data, size, 0, starts);
+    starts.shrink_to_fit();
+    return result;
+  }
+
+  template <typename Offset>
+  size_t findLine(const std::vector<Offset>& starts, size_t offset) {
+    auto it = std::upper_bound(starts.begin(), starts.end(), static_cast<Offset>(offset));
+    return static_cast<size_t>(it - starts.begin()) - 1;
+  }
+}
+
+void LineIndex::build(const char *data, size_t size) {
+  clear();
+  m_size = size;
+  m_wide = size >= std::numeric_limits<uint32_t>::max();
+
+  LineScanResult result = m_wide ? buildStarts(data, size, m_wideStarts)
+                                 : buildStarts(data, size, m_narrowStarts);
+  m_hasCarriageReturns = result.hasCarriageReturns;
+  m_hasTabs = result.hasTabs;
+}
+
+void LineIndex::begin(size_t maximumSize) {
+  clear();
+  m_wide = maximumSize >= std::numeric_limits<uint32_t>::max();
+  if (m_wide)
+    m_wideStarts.push_back(0);
+  else
+    m_narrowStarts.push_back(0);
+}
+
+void LineIndex::extend(const std::vector<uint64_t>& starts, size_t size) {
+  if (m_wide)
+    m_wideStarts.insert(m_wideStarts.end(), starts.begin(), starts.end());
+  else
+    m_narrowStarts.insert(m_narrowStarts.end(), starts.begin(), starts.end());
+  m_size = size;
+}
+
+void LineIndex::clear() {
+  std::vector<uint32_t>().swap(m_narrowStarts);
+  std::vector<uint64_t>().swap(m_wideStarts);
+  m_wide = false;
+  m_size = 0;
+  m_hasCarriageReturns = false;
+  m_hasTabs = false;
+}
+
+size_t LineIndex::lineAt(size_t offset) const {
+  if (lineCount() == 0)
+    return 0;
+  return m_wide ? findLine(m_wideStarts, offset) : findLine(m_narrowStarts, offset);
+}
+
+size_t LineIndex::memoryUsage() const {
+  return m_narrowStarts.capacity() * sizeof(uint32_t) + m_wideStarts.capacity() * sizeof(uint64_t);
+}
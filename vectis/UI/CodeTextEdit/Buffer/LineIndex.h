@@ -0,0 +1,54 @@
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Stores the starting offset of every line in a byte buffer. A line ends with a '\n' character
+// (which belongs to the line) or with the end of the buffer, thus a buffer with N newlines
+// always has N + 1 lines (the last one might be empty).
+//
+// The index is built in a single vectorized pass (see LineScanner) and answers line <-> offset
+// queries without touching the buffer: it's meant to be built once per buffer and kept around
+// for anyone needing to locate lines (wrapping, lexing, cursor mapping, minimap). Offsets are
+// stored in 32 bits unless the buffer is 4 GB or larger.
+class LineIndex {
+public:
+  void build(const char *data, size_t size);
+  void clear();
+  // Empties the index of a buffer which is going to be filled a chunk at a time, up to maximumSize
+  // bytes: extend() adds the lines starting in every chunk, which brings the buffer to 'size' bytes
+  void begin(size_t maximumSize);
+  void extend(const std::vector<uint64_t>& starts, size_t size);
+
+  size_t lineCount() const { return m_wide ? m_wideStarts.size() : m_narrowStarts.size(); }
+  size_t bufferSize() const { return m_size; }
+
+  // Offset of the first byte of a line in O(1). lineStart(lineCount()) returns the buffer size
+  size_t lineStart(size_t line) const {
+    if (line >= lineCount())
+      return m_size;
+    return m_wide ? static_cast<size_t>(m_wideStarts[line]) : static_cast<size_t>(m_narrowStarts[line]);
+  }
+  // Length of a line in bytes (including its newline, if any)
+  size_t lineLength(size_t line) const { return lineStart(line + 1) - lineStart(line); }
+  // Returns the line containing the given offset (O(log n))
+  size_t lineAt(size_t offset) const;
+  // Number of newlines in [from; to)
+  size_t newlinesBetween(size_t from, size_t to) const { return lineAt(to) - lineAt(from); }
+
+  bool hasCarriageReturns() const { return m_hasCarriageReturns; }
+  bool hasTabs() const { return m_hasTabs; }
+  size_t memoryUsage() const;
+
+private:
+  std::vector<uint32_t> m_narrowStarts; // Used for buffers smaller than 4 GB
+  std::vector<uint64_t> m_wideStarts;
+  bool m_wide = false;
+  size_t m_size = 0;
+  bool m_hasCarriageReturns = false;
+  bool m_hasTabs = false;
+};
+
+#endif // LINEINDEX_H
@@ -0,0 +1,183 @@
+#include <UI/CodeTextEdit/Buffer/LineScanner.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define VECTIS_SCANNER_SSE2
+  #include <emmintrin.h>
+  #if defined(__GNUC__) || defined(__clang__)
+    #define VECTIS_SCANNER_AVX2
+    #define VECTIS_TARGET_AVX2 __attribute__((target("avx2")))
+    #include <immintrin.h>
+  #elif defined(_MSC_VER) && _MSC_VER >= 1800
+    #define VECTIS_SCANNER_AVX2
+    #define VECTIS_TARGET_AVX2
+    #include <immintrin.h>
+    #include <intrin.h>
+  #endif
+#endif
+
+namespace { // Functions reserved for this TU's internal use
+
+  inline unsigned countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+  }
+
+  // Pushes one line start for every bit set in a newline mask of a block starting at blockOffset
+  template <typename Offset>
+  inline void emitMask(uint32_t mask, size_t blockOffset, std::vector<Offset>& lineStarts) {
+    while (mask != 0) {
+      lineStarts.push_back(static_cast<Offset>(blockOffset + countTrailingZeros(mask) + 1));
+      mask &= mask - 1; // Clear the lowest set bit
+    }
+  }
+
+  template <typename Offset>
+  void scanScalar(const char *data, size_t size, size_t baseOffset, std::vector<Offset>& lineStarts,
+                  LineScanResult& result) {
+    for (size_t i = 0; i < size; ++i) {
+      char ch = data[i];
+      if (ch == '\n')
+        lineStarts.push_back(static_cast<Offset>(baseOffset + i + 1));
+      else if (ch == '\r')
+        result.hasCarriageReturns = true;
+      else if (ch == '\t')
+        result.hasTabs = true;
+    }
+  }
+
+#ifdef VECTIS_SCANNER_SSE2
+  template <typename Offset>
+  size_t scanSSE2(const char *data, size_t size, size_t baseOffset, std::vector<Offset>& lineStarts,
+                  LineScanResult& result) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    __m128i seenCarriageReturns = _mm_setzero_si128();
+    __m128i seenTabs = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      seenCarriageReturns = _mm_or_si128(seenCarriageReturns, _mm_cmpeq_epi8(block, carriageReturn));
+      seenTabs = _mm_or_si128(seenTabs, _mm_cmpeq_epi8(block, tab));
+      uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+      emitMask(mask, baseOffset + i, lineStarts);
+    }
+    result.hasCarriageReturns |= _mm_movemask_epi8(seenCarriageReturns) != 0;
+    result.hasTabs |= _mm_movemask_epi8(seenTabs) != 0;
+    return i; // Bytes consumed, the tail is left to the scalar loop
+  }
+#endif
+
+#ifdef VECTIS_SCANNER_AVX2
+  template <typename Offset>
+  VECTIS_TARGET_AVX2
+  size_t scanAVX2(const char *data, size_t size, size_t baseOffset, std::vector<Offset>& lineStarts,
+                  LineScanResult& result) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriageReturn = _mm256_set1_epi8('\r');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    __m256i seenCarriageReturns = _mm256_setzero_si256();
+    __m256i seenTabs = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      seenCarriageReturns = _mm256_or_si256(seenCarriageReturns, _mm256_cmpeq_epi8(block, carriageReturn));
+      seenTabs = _mm256_or_si256(seenTabs, _mm256_cmpeq_epi8(block, tab));
+      uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+      emitMask(mask, baseOffset + i, lineStarts);
+    }
+    result.hasCarriageReturns |= _mm256_movemask_epi8(seenCarriageReturns) != 0;
+    result.hasTabs |= _mm256_movemask_epi8(seenTabs) != 0;
+    return i;
+  }
+
+  bool cpuSupportsAVX2() {
+  #if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+      return false;
+    __cpuid(info, 1);
+    bool osUsesXSave = (info[2] & (1 << 27)) != 0;
+    if (!osUsesXSave || (_xgetbv(0) & 0x6) != 0x6) // The OS must save the YMM registers
+      return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+  #else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  #endif
+  }
+#endif
+
+  template <typename Offset>
+  LineScanResult scan(ScanKernel kernel, const char *data, size_t size, size_t baseOffset,
+                      std::vector<Offset>& lineStarts) {
+    LineScanResult result;
+    size_t consumed = 0;
+    switch (kernel) {
+#ifdef VECTIS_SCANNER_AVX2
+      case ScanKernel::AVX2: {
+        if (bestScanKernel() == ScanKernel::AVX2)
+          consumed = scanAVX2(data, size, baseOffset, lineStarts, result);
+      } break;
+#endif
+#ifdef VECTIS_SCANNER_SSE2
+      case ScanKernel::SSE2: {
+        consumed = scanSSE2(data, size, baseOffset, lineStarts, result);
+      } break;
+#endif
+      default:
+        break;
+    }
+    scanScalar(data + consumed, size - consumed, baseOffset + consumed, lineStarts, result);
+    return result;
+  }
+}
+
+ScanKernel bestScanKernel() {
+#if defined(VECTIS_SCANNER_AVX2)
+  static const ScanKernel best = cpuSupportsAVX2() ? ScanKernel::AVX2 : ScanKernel::SSE2;
+  return best;
+#elif defined(VECTIS_SCANNER_SSE2)
+  return ScanKernel::SSE2;
+#else
+  return ScanKernel::Scalar;
+#endif
+}
+
+bool scanKernelSupported(ScanKernel kernel) {
+  return static_cast<int>(kernel) <= static_cast<int>(bestScanKernel()); // Every kernel implies the ones before it
+}
+
+const char *scanKernelName(ScanKernel kernel) {
+  switch (kernel) {
+    case ScanKernel::AVX2: return "AVX2";
+    case ScanKernel::SSE2: return "SSE2";
+    default:               return "Scalar";
+  }
+}
+
+template <typename Offset>
+LineScanResult scanLineStarts(const char *data, size_t size, size_t baseOffset, std::vector<Offset>& lineStarts) {
+  return scan(bestScanKernel(), data, size, baseOffset, lineStarts);
+}
+
+template <typename Offset>
+LineScanResult scanLineStarts(ScanKernel kernel, const char *data, size_t size, size_t baseOffset,
+                              std::vector<Offset>& lineStarts) {
+  return scan(kernel, data, size, baseOffset, lineStarts);
+}
+
+// Offsets are stored as 32 bit values whenever possible (see LineIndex)
+template LineScanResult scanLineStarts<uint32_t>(const char*, size_t, size_t, std::vector<uint32_t>&);
+template LineScanResult scanLineStarts<uint64_t>(const char*, size_t, size_t, std::vector<uint64_t>&);
+template LineScanResult scanLineStarts<uint32_t>(ScanKernel, const char*, size_t, size_t, std::vector<uint32_t>&);
+template LineScanResult scanLineStarts<uint64_t>(ScanKernel, const char*, size_t, size_t, std::vector<uint64_t>&);
@@ -0,0 +1,36 @@
+#ifndef LINESCANNER_H
+#define LINESCANNER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized newline scanning. A single pass over the buffer finds every '\n' (and records whether
+// any '\r' or '\t' was seen, which callers need to decide on CRLF/tab handling) at roughly memory
+// bandwidth. AVX2 is used if the CPU supports it, SSE2 otherwise, and a portable scalar loop on
+// non-x86 targets.
+
+enum class ScanKernel { Scalar, SSE2, AVX2 };
+
+struct LineScanResult {
+  bool hasCarriageReturns = false;
+  bool hasTabs = false;
+};
+
+// The fastest kernel supported by the running CPU (detected once)
+ScanKernel bestScanKernel();
+// Whether the running CPU (and the build) can use a kernel
+bool scanKernelSupported(ScanKernel kernel);
+const char *scanKernelName(ScanKernel kernel);
+
+// Appends to lineStarts the offset (relative to data, plus baseOffset) of the byte following
+// every '\n' found in [data; data + size)
+template <typename Offset>
+LineScanResult scanLineStarts(const char *data, size_t size, size_t baseOffset, std::vector<Offset>& lineStarts);
+
+// Same as above but forcing a specific kernel (kernels unsupported by the CPU fall back to scalar)
+template <typename Offset>
+LineScanResult scanLineStarts(ScanKernel kernel, const char *data, size_t size, size_t baseOffset,
+                              std::vector<Offset>& lineStarts);
+
+#endif // LINESCANNER_H
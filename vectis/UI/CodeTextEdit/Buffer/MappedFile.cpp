@@ -0,0 +1,41 @@
+#include <UI/CodeTextEdit/Buffer/MappedFile.h>
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+// Maps the entire file in read-only mode. Returns true on success
+bool MappedFile::open(const QString& path) {
+  close();
+
+  m_file.setFileName(path);
+  if (!m_file.open(QFile::ReadOnly))
+    return false;
+
+  qint64 size = m_file.size();
+  if (size <= 0)
+    return true; // Nothing to map (empty files cannot be mapped anyway)
+
+  uchar *ptr = m_file.map(0, size);
+  if (ptr != nullptr) {
+    m_data = reinterpret_cast<const char*>(ptr);
+    m_size = static_cast<size_t>(size);
+  } else {
+    // Mapping is not supported for this file (e.g. a special device), read it instead
+    m_fallbackContents = m_file.readAll();
+    m_data = m_fallbackContents.constData();
+    m_size = static_cast<size_t>(m_fallbackContents.size());
+  }
+  return true;
+}
+
+void MappedFile::close() {
+  if (!m_file.isOpen())
+    return;
+  if (m_fallbackContents.isEmpty() && m_data != nullptr)
+    m_file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(m_data)));
+  m_fallbackContents.clear();
+  m_file.close();
+  m_data = nullptr;
+  m_size = 0;
+}
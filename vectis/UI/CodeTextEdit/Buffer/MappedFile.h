@@ -0,0 +1,33 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+// A read-only view of a file's contents backed by a memory mapping. Pages are brought in by the
+// OS only when they're touched and, being backed by the file itself, they can be evicted under
+// memory pressure: mapping a huge file is therefore (almost) free until its bytes are read.
+// If the platform refuses to map the file, the contents are read into memory as a fallback.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const QString& path);
+  void close();
+
+  bool isOpen() const { return m_file.isOpen(); }
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  QFile m_file;
+  QByteArray m_fallbackContents; // Only used if mapping failed
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+};
+
+#endif // MAPPEDFILE_H
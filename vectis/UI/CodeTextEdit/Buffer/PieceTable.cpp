@@ -0,0 +1,336 @@
+#include <UI/CodeTextEdit/Buffer/PieceTable.h>
+#include <UI/CodeTextEdit/Buffer/LineScanner.h>
+#include <stdexcept>
+
+void PieceTable::reset(const char *original, size_t size) {
+  clear();
+  initialize(original, size);
+}
+
+void PieceTable::reset(std::string original) {
+  clear();
+  m_ownedOriginal = std::move(original);
+  initialize(m_ownedOriginal.data(), m_ownedOriginal.size());
+}
+
+void PieceTable::resetGrowing(const char *original, size_t maximumSize) {
+  clear();
+  m_original = original;
+  m_originalIndex.begin(maximumSize);
+}
+
+void PieceTable::appendOriginal(size_t length, const std::vector<uint64_t>& lineStarts) {
+  const size_t start = m_originalSize;
+  m_originalSize += length;
+  m_originalIndex.extend(lineStarts, m_originalSize);
+  if (length > 0)
+    m_root = merge(m_root, newNode(makePiece(OriginalBuffer, start, length)));
+}
+
+void PieceTable::initialize(const char *original, size_t size) {
+  m_original = original;
+  m_originalSize = size;
+  m_originalIndex.build(original, size);
+  if (size > 0)
+    m_root = newNode(makePiece(OriginalBuffer, 0, size));
+}
+
+void PieceTable::clear() {
+  m_nodes.clear();
+  m_freeNodes.clear();
+  m_root = -1;
+  m_original = nullptr;
+  m_originalSize = 0;
+  m_ownedOriginal.clear();
+  m_originalIndex.clear();
+  m_add.clear();
+  m_addLineStarts.assign(1, 0);
+}
+
+//==---------------------------------------------------------------------------==//
+//                              Buffers handling                                 //
+//==---------------------------------------------------------------------------==//
+
+size_t PieceTable::bufferLineAt(BufferId buffer, size_t offset) const {
+  if (buffer == OriginalBuffer)
+    return m_originalIndex.lineAt(offset);
+  auto it = std::upper_bound(m_addLineStarts.begin(), m_addLineStarts.end(), offset);
+  return static_cast<size_t>(it - m_addLineStarts.begin()) - 1;
+}
+
+size_t PieceTable::bufferLineStart(BufferId buffer, size_t line) const {
+  if (buffer == OriginalBuffer)
+    return m_originalIndex.lineStart(line);
+  return (line < m_addLineStarts.size()) ? m_addLineStarts[line] : m_add.size();
+}
+
+size_t PieceTable::bufferNewlines(BufferId buffer, size_t from, size_t to) const {
+  return bufferLineAt(buffer, to) - bufferLineAt(buffer, from);
+}
+
+PieceTable::Piece PieceTable::makePiece(BufferId buffer, size_t start, size_t length) const {
+  return Piece{ buffer, start, length, bufferNewlines(buffer, start, start + length) };
+}
+
+//==---------------------------------------------------------------------------==//
+//                               Tree handling                                   //
+//==---------------------------------------------------------------------------==//
+
+int PieceTable::newNode(const Piece& piece) {
+  // xorshift32: priorities only need to be reasonably random for the tree to stay balanced
+  m_seed ^= m_seed << 13;
+  m_seed ^= m_seed >> 17;
+  m_seed ^= m_seed << 5;
+
+  Node node{ piece, m_seed, -1, -1, piece.length, piece.newlines };
+  if (!m_freeNodes.empty()) {
+    int index = m_freeNodes.back();
+    m_freeNodes.pop_back();
+    m_nodes[index] = node;
+    return index;
+  }
+  m_nodes.push_back(node);
+  return static_cast<int>(m_nodes.size()) - 1;
+}
+
+void PieceTable::freeSubtree(int node) {
+  if (node < 0)
+    return;
+  freeSubtree(m_nodes[node].left);
+  freeSubtree(m_nodes[node].right);
+  m_freeNodes.push_back(node);
+}
+
+void PieceTable::update(int node) {
+  Node& n = m_nodes[node];
+  n.subtreeLength = subtreeLength(n.left) + n.piece.length + subtreeLength(n.right);
+  n.subtreeNewlines = subtreeNewlines(n.left) + n.piece.newlines + subtreeNewlines(n.right);
+}
+
+// Splits a subtree into the first 'offset' characters and the rest. A piece straddling the
+// split point gets cut in two
+void PieceTable::split(int node, size_t offset, int& left, int& right) {
+  if (node < 0) {
+    left = right = -1;
+    return;
+  }
+  size_t leftLength = subtreeLength(m_nodes[node].left);
+  size_t pieceLength = m_nodes[node].piece.length;
+
+  if (offset <= leftLength) {
+    int subLeft, subRight;
+    split(m_nodes[node].left, offset, subLeft, subRight);
+    m_nodes[node].left = subRight;
+    update(node);
+    left = subLeft;
+    right = node;
+  } else if (offset >= leftLength + pieceLength) {
+    int subLeft, subRight;
+    split(m_nodes[node].right, offset - leftLength - pieceLength, subLeft, subRight);
+    m_nodes[node].right = subLeft;
+    update(node);
+    left = node;
+    right = subRight;
+  } else {
+    // The split point is inside this node's piece: keep the head here and move the tail
+    // (together with the right subtree) into a new tree
+    size_t headLength = offset - leftLength;
+    Piece piece = m_nodes[node].piece;
+    Piece tail = makePiece(piece.buffer, piece.start + headLength, piece.length - headLength);
+    int tailNode = newNode(tail); // Might reallocate m_nodes, don't hold references across this
+
+    Node& n = m_nodes[node];
+    n.piece.length = headLength;
+    n.piece.newlines = piece.newlines - tail.newlines;
+    int rightSubtree = n.right;
+    n.right = -1;
+    update(node);
+    left = node;
+    right = merge(tailNode, rightSubtree);
+  }
+}
+
+int PieceTable::merge(int left, int right) {
+  if (left < 0)
+    return right;
+  if (right < 0)
+    return left;
+  if (m_nodes[left].priority > m_nodes[right].priority) {
+    int merged = merge(m_nodes[left].right, right);
+    m_nodes[left].right = merged;
+    update(left);
+    return left;
+  } else {
+    int merged = merge(left, m_nodes[right].left);
+    m_nodes[right].left = merged;
+    update(right);
+    return right;
+  }
+}
+
+//==---------------------------------------------------------------------------==//
+//                                  Editing                                      //
+//==---------------------------------------------------------------------------==//
+
+// Typing usually appends to the add buffer right after the previous insertion: in that case
+// the piece ending at 'offset' is simply made longer instead of creating a new one
+bool PieceTable::tryExtendLastInsertion(size_t offset, size_t length, size_t addStart) {
+  if (offset == 0)
+    return false;
+
+  std::vector<int> path;
+  int node = m_root;
+  size_t target = offset - 1; // The piece must contain the character right before the insertion
+  while (node >= 0) {
+    const Node& n = m_nodes[node];
+    size_t leftLength = subtreeLength(n.left);
+    path.push_back(node);
+    if (target < leftLength) {
+      node = n.left;
+    } else if (target < leftLength + n.piece.length) {
+      bool endsAtOffset = (target == leftLength + n.piece.length - 1);
+      if (!endsAtOffset || n.piece.buffer != AddBuffer || n.piece.start + n.piece.length != addStart)
+        return false;
+      break;
+    } else {
+      target -= leftLength + n.piece.length;
+      node = n.right;
+    }
+  }
+  if (node < 0)
+    return false;
+
+  Piece& piece = m_nodes[node].piece;
+  piece.length += length;
+  piece.newlines += bufferNewlines(AddBuffer, addStart, addStart + length);
+  for (auto it = path.rbegin(); it != path.rend(); ++it)
+    update(*it);
+  return true;
+}
+
+void PieceTable::insert(size_t offset, const char *text, size_t length) {
+  if (length == 0)
+    return;
+  if (offset > size())
+    throw std::out_of_range("PieceTable::insert");
+
+  // Append the text to the add buffer and index its newlines
+  size_t addStart = m_add.size();
+  m_add.append(text, length);
+  scanLineStarts(text, length, addStart, m_addLineStarts);
+
+  if (tryExtendLastInsertion(offset, length, addStart))
+    return;
+
+  int left, right;
+  split(m_root, offset, left, right);
+  int node = newNode(makePiece(AddBuffer, addStart, length));
+  m_root = merge(merge(left, node), right);
+}
+
+void PieceTable::remove(size_t offset, size_t length) {
+  if (offset >= size() || length == 0)
+    return;
+  length = std::min(length, size() - offset);
+
+  int left, middle, right;
+  split(m_root, offset, left, right);
+  split(right, length, middle, right);
+  freeSubtree(middle);
+  m_root = merge(left, right);
+}
+
+//==---------------------------------------------------------------------------==//
+//                                  Queries                                      //
+//==---------------------------------------------------------------------------==//
+
+char PieceTable::at(size_t offset) const {
+  Chunk chunk = chunkAt(offset);
+  if (chunk.size == 0)
+    throw std::out_of_range("PieceTable::at");
+  return chunk.data[offset - chunk.offset];
+}
+
+PieceTable::Chunk PieceTable::chunkAt(size_t offset) const {
+  int node = m_root;
+  size_t base = 0;
+  while (node >= 0) {
+    const Node& n = m_nodes[node];
+    size_t leftLength = subtreeLength(n.left);
+    if (offset < base + leftLength) {
+      node = n.left;
+    } else if (offset < base + leftLength + n.piece.length) {
+      return Chunk{ bufferData(n.piece.buffer) + n.piece.start, n.piece.length, base + leftLength };
+    } else {
+      base += leftLength + n.piece.length;
+      node = n.right;
+    }
+  }
+  return Chunk{ nullptr, 0, size() };
+}
+
+size_t PieceTable::lineStart(size_t line) const {
+  if (line == 0)
+    return 0;
+  if (line >= lineCount())
+    return size();
+
+  // Find the piece holding the line-th newline: the line starts right after it
+  int node = m_root;
+  size_t base = 0;
+  while (node >= 0) {
+    const Node& n = m_nodes[node];
+    size_t leftNewlines = subtreeNewlines(n.left);
+    size_t leftLength = subtreeLength(n.left);
+    if (line <= leftNewlines) {
+      node = n.left;
+    } else if (line <= leftNewlines + n.piece.newlines) {
+      size_t nth = line - leftNewlines;
+      size_t firstLine = bufferLineAt(n.piece.buffer, n.piece.start);
+      size_t bufferOffset = bufferLineStart(n.piece.buffer, firstLine + nth);
+      return base + leftLength + (bufferOffset - n.piece.start);
+    } else {
+      line -= leftNewlines + n.piece.newlines;
+      base += leftLength + n.piece.length;
+      node = n.right;
+    }
+  }
+  return size(); // Unreachable if the aggregates are consistent
+}
+
+size_t PieceTable::lineAt(size_t offset) const {
+  if (offset >= size())
+    return lineCount() - 1;
+
+  // Count the newlines before offset
+  int node = m_root;
+  size_t newlines = 0;
+  while (node >= 0) {
+    const Node& n = m_nodes[node];
+    size_t leftLength = subtreeLength(n.left);
+    if (offset < leftLength) {
+      node = n.left;
+    } else if (offset < leftLength + n.piece.length) {
+      size_t inPiece = offset - leftLength;
+      return newlines + subtreeNewlines(n.left) +
+             bufferNewlines(n.piece.buffer, n.piece.start, n.piece.start + inPiece);
+    } else {
+      newlines += subtreeNewlines(n.left) + n.piece.newlines;
+      offset -= leftLength + n.piece.length;
+      node = n.right;
+    }
+  }
+  return newlines;
+}
+
+std::string PieceTable::text(size_t offset, size_t length) const {
+  std::string result;
+  if (offset >= size())
+    return result;
+  length = std::min(length, size() - offset);
+  result.reserve(length);
+  forEachChunk(offset, length, [&result](const Chunk& chunk) {
+    result.append(chunk.data, chunk.size);
+  });
+  return result;
+}
@@ -0,0 +1,149 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <UI/CodeTextEdit/Buffer/LineIndex.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// A piece table text buffer. The original contents are never modified (they can be a memory-mapped
+// file) and every inserted text is appended to an 'add' buffer: the document is the in-order
+// sequence of pieces, i.e. spans of one of these two buffers.
+//
+// Pieces are the nodes of a treap (a randomized balanced binary tree) where every node also stores
+// the total length and the total number of newlines of its subtree. This gives O(log n) insertions,
+// deletions and offset <-> line queries regardless of the document size and of where the edit is.
+//
+// Concurrent reads through const methods are safe as long as nobody is modifying the table.
+class PieceTable {
+public:
+  PieceTable() = default;
+  PieceTable(const PieceTable&) = delete;
+  PieceTable& operator=(const PieceTable&) = delete;
+
+  // Resets the table to an unmodified original buffer. The buffer isn't copied and must stay
+  // alive (and unchanged) until the next reset
+  void reset(const char *original, size_t size);
+  // Same as above but the table takes ownership of the original contents
+  void reset(std::string original);
+  // Resets the table to an empty document whose original buffer is going to be filled a chunk at a
+  // time, up to maximumSize bytes. The buffer must stay alive until the next reset
+  void resetGrowing(const char *original, size_t maximumSize);
+  // The next 'length' bytes of the original buffer are ready: they're appended to the end of the
+  // document (wherever edits left it). lineStarts are the lines starting within them
+  void appendOriginal(size_t length, const std::vector<uint64_t>& lineStarts);
+  void clear();
+
+  size_t size() const { return subtreeLength(m_root); }
+  bool isEmpty() const { return size() == 0; }
+  // Number of lines, i.e. the number of newlines + 1
+  size_t lineCount() const { return subtreeNewlines(m_root) + 1; }
+  size_t pieceCount() const { return m_nodes.size() - m_freeNodes.size(); }
+
+  void insert(size_t offset, const char *text, size_t length);
+  void insert(size_t offset, const std::string& text) { insert(offset, text.data(), text.size()); }
+  void remove(size_t offset, size_t length);
+
+  // Character at offset. Throws std::out_of_range past the end of the document
+  char at(size_t offset) const;
+  // Offset of the first character of a line. lineStart(lineCount()) returns size()
+  size_t lineStart(size_t line) const;
+  // Length of a line including its newline (if any)
+  size_t lineLength(size_t line) const { return lineStart(line + 1) - lineStart(line); }
+  // Line containing the given offset
+  size_t lineAt(size_t offset) const;
+
+  std::string text(size_t offset, size_t length) const;
+  std::string text() const { return text(0, size()); }
+  std::string lineText(size_t line) const { return text(lineStart(line), lineLength(line)); }
+
+  // A contiguous span of the document text
+  struct Chunk {
+    const char *data;
+    size_t size;
+    size_t offset; // Document offset of data[0]
+  };
+  // Returns the whole piece containing the given offset (size is 0 past the end of the document)
+  Chunk chunkAt(size_t offset) const;
+  // Calls fn(const Chunk&) in document order for every span of text in [offset; offset + length)
+  template <typename Fn>
+  void forEachChunk(size_t offset, size_t length, Fn&& fn) const {
+    if (length > 0)
+      forEachChunk(m_root, 0, offset, offset + length, fn);
+  }
+
+private:
+  enum BufferId : uint8_t { OriginalBuffer, AddBuffer };
+
+  struct Piece {
+    BufferId buffer;
+    size_t start; // Offset in the buffer
+    size_t length;
+    size_t newlines;
+  };
+
+  struct Node {
+    Piece piece;
+    uint32_t priority;
+    int left;
+    int right;
+    size_t subtreeLength;
+    size_t subtreeNewlines;
+  };
+
+  void initialize(const char *original, size_t size);
+  const char *bufferData(BufferId buffer) const {
+    return (buffer == OriginalBuffer) ? m_original : m_add.data();
+  }
+  size_t bufferNewlines(BufferId buffer, size_t from, size_t to) const;
+  size_t bufferLineStart(BufferId buffer, size_t line) const;
+  size_t bufferLineAt(BufferId buffer, size_t offset) const;
+  Piece makePiece(BufferId buffer, size_t start, size_t length) const;
+
+  size_t subtreeLength(int node) const { return (node < 0) ? 0 : m_nodes[node].subtreeLength; }
+  size_t subtreeNewlines(int node) const { return (node < 0) ? 0 : m_nodes[node].subtreeNewlines; }
+  int newNode(const Piece& piece);
+  void freeSubtree(int node);
+  void update(int node);
+  void split(int node, size_t offset, int& left, int& right);
+  int merge(int left, int right);
+  bool tryExtendLastInsertion(size_t offset, size_t length, size_t addStart);
+
+  template <typename Fn>
+  void forEachChunk(int node, size_t nodeOffset, size_t from, size_t to, Fn& fn) const {
+    // nodeOffset is the document offset where this subtree starts
+    while (node >= 0) {
+      const Node& n = m_nodes[node];
+      size_t pieceOffset = nodeOffset + subtreeLength(n.left);
+      if (from < pieceOffset)
+        forEachChunk(n.left, nodeOffset, from, to, fn);
+      size_t pieceEnd = pieceOffset + n.piece.length;
+      if (from < pieceEnd && to > pieceOffset) {
+        size_t begin = std::max(from, pieceOffset);
+        size_t end = std::min(to, pieceEnd);
+        fn(Chunk{ bufferData(n.piece.buffer) + n.piece.start + (begin - pieceOffset), end - begin, begin });
+      }
+      if (to <= pieceEnd)
+        return;
+      node = n.right; // Iterate instead of recursing on the right subtree
+      nodeOffset = pieceEnd;
+    }
+  }
+
+  std::vector<Node> m_nodes;
+  std::vector<int> m_freeNodes;
+  int m_root = -1;
+  uint32_t m_seed = 2463534242u;
+
+  const char *m_original = nullptr;
+  size_t m_originalSize = 0;
+  std::string m_ownedOriginal;
+  LineIndex m_originalIndex;
+
+  std::string m_add;
+  std::vector<size_t> m_addLineStarts{0}; // Every line of the add buffer, the first one starts at 0
+};
+
+#endif // PIECETABLE_H
@@ -0,0 +1,70 @@
+#include <UI/CodeTextEdit/Buffer/TextEncoding.h>
+#include <cstring>
+
+namespace { // Functions reserved for this TU's internal use
+
+  // Eight bytes at a time: the high bit of any of them is set in a non-ASCII line
+  bool isAscii(const char *text, size_t length) {
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+      uint64_t word;
+      std::memcpy(&word, text + i, 8);
+      if (word & 0x8080808080808080ULL)
+        return false;
+    }
+    for (; i < length; ++i) {
+      if (static_cast<unsigned char>(text[i]) & 0x80)
+        return false;
+    }
+    return true;
+  }
+
+  // Rejects overlong encodings, surrogates and code points past U+10FFFF as well
+  bool isValidUtf8(const unsigned char *text, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+      const unsigned char c = text[i];
+      if (c < 0x80) {
+        ++i;
+        continue;
+      }
+      size_t continuations;
+      unsigned char low = 0x80, high = 0xBF; // Range of the first continuation byte
+      if (c >= 0xC2 && c <= 0xDF) {
+        continuations = 1;
+      } else if (c >= 0xE0 && c <= 0xEF) {
+        continuations = 2;
+        if (c == 0xE0)
+          low = 0xA0;
+        else if (c == 0xED)
+          high = 0x9F;
+      } else if (c >= 0xF0 && c <= 0xF4) {
+        continuations = 3;
+        if (c == 0xF0)
+          low = 0x90;
+        else if (c == 0xF4)
+          high = 0x8F;
+      } else {
+        return false;
+      }
+      if (i + continuations >= length) // Truncated sequence
+        return false;
+      if (text[i + 1] < low || text[i + 1] > high)
+        return false;
+      for (size_t j = 2; j <= continuations; ++j) {
+        if ((text[i + j] & 0xC0) != 0x80)
+          return false;
+      }
+      i += continuations + 1;
+    }
+    return true;
+  }
+}
+
+LineEncoding detectLineEncoding(const char *text, size_t length) {
+  if (isAscii(text, length))
+    return LineEncoding::Ascii;
+  if (isValidUtf8(reinterpret_cast<const unsigned char*>(text), length))
+    return LineEncoding::Utf8;
+  return LineEncoding::Latin1;
+}
@@ -0,0 +1,19 @@
+#ifndef TEXTENCODING_H
+#define TEXTENCODING_H
+
+#include <cstddef>
+#include <cstdint>
+
+// How the bytes of a line are to be read. The buffer keeps files as they are, one byte per cell:
+// nearly every line is plain ASCII, the others are UTF-8 unless they aren't valid UTF-8, in which
+// case every byte is taken to be a Latin-1 character
+enum class LineEncoding : uint8_t { Ascii, Utf8, Latin1 };
+
+LineEncoding detectLineEncoding(const char *text, size_t length);
+
+// Whether a line may be split right before offset, i.e. not inside a multi-byte UTF-8 sequence
+inline bool isCharacterBoundary(const char *text, size_t offset) {
+  return (static_cast<unsigned char>(text[offset]) & 0xC0) != 0x80;
+}
+
+#endif // TEXTENCODING_H
@@ -0,0 +1,362 @@
+#ifndef CHUNKEDSEQUENCE_H
+#define CHUNKEDSEQUENCE_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+// Weight of items which don't have one (see ChunkedSequence)
+struct NoWeight {
+  template <typename T>
+  int operator()(const T&) const { return 0; }
+};
+
+// A sequence of items kept in chunks of a few dozen contiguous items. Chunks are the nodes of a
+// treap (like the pieces of a PieceTable) where every node also stores the number of items and the
+// total weight of its subtree: reading, writing, inserting or erasing an item anywhere, the total
+// weight of the items before an index and the index at a given total weight are all O(log n) plus
+// the size of a chunk, regardless of where in the sequence they happen
+template <typename T, typename WeightOf = NoWeight>
+class ChunkedSequence {
+public:
+  void assign(std::vector<T> items) {
+    clear();
+    append(std::move(items));
+  }
+  // Appends the items a chunk at a time, without a tree operation per item
+  void append(std::vector<T> items) {
+    const int count = static_cast<int>(items.size());
+    for (int first = 0; first < count; first += CHUNK_SIZE) {
+      const int last = std::min(first + CHUNK_SIZE, count);
+      std::vector<T> chunk(std::make_move_iterator(items.begin() + first),
+                           std::make_move_iterator(items.begin() + last));
+      m_root = merge(m_root, newNode(std::move(chunk)));
+    }
+  }
+  // Appends count copies of an item, constructed right in their chunks
+  void append(int count, const T& item) {
+    m_nodes.reserve(m_nodes.size() + count / CHUNK_SIZE + 1);
+    for (int first = 0; first < count; first += CHUNK_SIZE)
+      m_root = merge(m_root, newNode(std::vector<T>(std::min(CHUNK_SIZE, count - first), item)));
+  }
+  void clear() {
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_root = -1;
+  }
+
+  int size() const { return subtreeSize(m_root); }
+  bool isEmpty() const { return m_root < 0; }
+  int totalWeight() const { return subtreeWeight(m_root); }
+
+  const T& operator[](int index) const {
+    const Node& n = m_nodes[find(index)];
+    return n.items[index];
+  }
+  // The item has to keep its weight, use set() otherwise
+  T& operator[](int index) {
+    Node& n = m_nodes[find(index)];
+    return n.items[index];
+  }
+  void set(int index, T item) {
+    const int delta = m_weightOf(item) - m_weightOf((*this)[index]);
+    int chunkIndex;
+    const int node = descend(index, chunkIndex, false, 0, delta);
+    m_nodes[node].items[index] = std::move(item);
+    m_nodes[node].weight += delta;
+  }
+  // Inserts before index (index == size() appends)
+  void insert(int index, T item) {
+    if (m_root < 0) {
+      m_root = newNode(std::vector<T>(1, std::move(item)));
+      return;
+    }
+    const int weight = m_weightOf(item);
+    int chunkIndex;
+    const int node = descend(index, chunkIndex, true, 1, weight);
+    Node& n = m_nodes[node];
+    n.items.insert(n.items.begin() + index, std::move(item));
+    n.weight += weight;
+    if (static_cast<int>(n.items.size()) > 2 * CHUNK_SIZE)
+      splitChunk(node, chunkIndex);
+  }
+  void erase(int index) {
+    const int weight = m_weightOf((*this)[index]);
+    int chunkIndex;
+    const int node = descend(index, chunkIndex, false, -1, -weight);
+    Node& n = m_nodes[node];
+    n.items.erase(n.items.begin() + index);
+    n.weight -= weight;
+    if (static_cast<int>(n.items.size()) < CHUNK_SIZE / 4)
+      joinChunk(chunkIndex);
+  }
+
+  // Total weight of the items [0, index)
+  int weightBefore(int index) const {
+    int node = m_root;
+    int weight = 0;
+    while (node >= 0) {
+      const Node& n = m_nodes[node];
+      const int leftSize = subtreeSize(n.left);
+      if (index <= leftSize) {
+        node = n.left;
+        continue;
+      }
+      weight += subtreeWeight(n.left);
+      index -= leftSize;
+      if (index < static_cast<int>(n.items.size())) {
+        for (int i = 0; i < index; ++i)
+          weight += m_weightOf(n.items[i]);
+        return weight;
+      }
+      weight += n.weight;
+      index -= static_cast<int>(n.items.size());
+      node = n.right;
+    }
+    return weight;
+  }
+  // The last index whose weightBefore() isn't greater than the given weight: the item 'containing'
+  // that weight, skipping weightless items (size() if the weight is past the total one)
+  int indexAtWeight(int weight) const {
+    int node = m_root;
+    int index = 0;
+    while (node >= 0) {
+      const Node& n = m_nodes[node];
+      const int leftWeight = subtreeWeight(n.left);
+      if (weight < leftWeight) {
+        node = n.left;
+        continue;
+      }
+      weight -= leftWeight;
+      index += subtreeSize(n.left);
+      if (weight < n.weight) {
+        for (const T& item : n.items) {
+          const int itemWeight = m_weightOf(item);
+          if (weight < itemWeight)
+            return index;
+          weight -= itemWeight;
+          ++index;
+        }
+      }
+      weight -= n.weight;
+      index += static_cast<int>(n.items.size());
+      node = n.right;
+    }
+    return index;
+  }
+
+  // Calls fn(item) in order for the items [from, to). The items have to keep their weight
+  template <typename Fn>
+  void forEach(int from, int to, Fn&& fn) { forEach(*this, m_root, 0, from, to, fn); }
+  template <typename Fn>
+  void forEach(int from, int to, Fn&& fn) const { forEach(*this, m_root, 0, from, to, fn); }
+
+private:
+  // Chunks are split when they get twice as big as this and joined to a neighbour when they get
+  // smaller than a quarter of it
+  static const int CHUNK_SIZE = 64;
+
+  struct Node {
+    std::vector<T> items;
+    int weight; // Of the items of this chunk
+    uint32_t priority;
+    int left;
+    int right;
+    int subtreeChunks;
+    int subtreeSize;
+    int subtreeWeight;
+  };
+
+  int subtreeChunks(int node) const { return (node < 0) ? 0 : m_nodes[node].subtreeChunks; }
+  int subtreeSize(int node) const { return (node < 0) ? 0 : m_nodes[node].subtreeSize; }
+  int subtreeWeight(int node) const { return (node < 0) ? 0 : m_nodes[node].subtreeWeight; }
+
+  int newNode(std::vector<T> items) {
+    // xorshift32: priorities only need to be reasonably random for the tree to stay balanced
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    int index;
+    if (!m_freeNodes.empty()) {
+      index = m_freeNodes.back();
+      m_freeNodes.pop_back();
+    } else {
+      index = static_cast<int>(m_nodes.size());
+      m_nodes.emplace_back();
+    }
+    Node& n = m_nodes[index];
+    n.items = std::move(items);
+    n.priority = m_seed;
+    n.left = n.right = -1;
+    updateWeight(index);
+    update(index);
+    return index;
+  }
+  void freeNode(int node) {
+    std::vector<T>().swap(m_nodes[node].items);
+    m_freeNodes.push_back(node);
+  }
+  void updateWeight(int node) {
+    Node& n = m_nodes[node];
+    n.weight = 0;
+    for (const T& item : n.items)
+      n.weight += m_weightOf(item);
+  }
+  void update(int node) {
+    Node& n = m_nodes[node];
+    n.subtreeChunks = subtreeChunks(n.left) + 1 + subtreeChunks(n.right);
+    n.subtreeSize = subtreeSize(n.left) + static_cast<int>(n.items.size()) + subtreeSize(n.right);
+    n.subtreeWeight = subtreeWeight(n.left) + n.weight + subtreeWeight(n.right);
+  }
+
+  // Node of the chunk holding an item, index becomes relative to that chunk
+  int find(int& index) const {
+    int node = m_root;
+    while (true) {
+      const Node& n = m_nodes[node];
+      const int leftSize = subtreeSize(n.left);
+      if (index < leftSize) {
+        node = n.left;
+      } else if (index < leftSize + static_cast<int>(n.items.size())) {
+        index -= leftSize;
+        return node;
+      } else {
+        index -= leftSize + static_cast<int>(n.items.size());
+        node = n.right;
+      }
+    }
+  }
+  // Same as above but the size and the weight of every subtree on the way get the given deltas,
+  // i.e. the ones of the change about to be made to the chunk. With 'inserting' an index right
+  // past the end of a chunk stays in that chunk. chunkIndex is the position of the chunk
+  int descend(int& index, int& chunkIndex, bool inserting, int sizeDelta, int weightDelta) {
+    int node = m_root;
+    chunkIndex = 0;
+    while (true) {
+      Node& n = m_nodes[node];
+      n.subtreeSize += sizeDelta;
+      n.subtreeWeight += weightDelta;
+      const int leftSize = subtreeSize(n.left);
+      const int chunkSize = static_cast<int>(n.items.size());
+      if (index < leftSize) {
+        node = n.left;
+      } else if (index < leftSize + chunkSize || (inserting && index == leftSize + chunkSize)) {
+        index -= leftSize;
+        chunkIndex += subtreeChunks(n.left);
+        return node;
+      } else {
+        index -= leftSize + chunkSize;
+        chunkIndex += subtreeChunks(n.left) + 1;
+        node = n.right;
+      }
+    }
+  }
+
+  // Splits a subtree into its first 'chunks' chunks and the rest
+  void split(int node, int chunks, int& left, int& right) {
+    if (node < 0) {
+      left = right = -1;
+      return;
+    }
+    const int leftChunks = subtreeChunks(m_nodes[node].left);
+    int subLeft, subRight;
+    if (chunks <= leftChunks) {
+      split(m_nodes[node].left, chunks, subLeft, subRight);
+      m_nodes[node].left = subRight;
+      update(node);
+      left = subLeft;
+      right = node;
+    } else {
+      split(m_nodes[node].right, chunks - leftChunks - 1, subLeft, subRight);
+      m_nodes[node].right = subLeft;
+      update(node);
+      left = node;
+      right = subRight;
+    }
+  }
+  int merge(int left, int right) {
+    if (left < 0)
+      return right;
+    if (right < 0)
+      return left;
+    if (m_nodes[left].priority > m_nodes[right].priority) {
+      int merged = merge(m_nodes[left].right, right);
+      m_nodes[left].right = merged;
+      update(left);
+      return left;
+    } else {
+      int merged = merge(left, m_nodes[right].left);
+      m_nodes[right].left = merged;
+      update(right);
+      return right;
+    }
+  }
+
+  // Moves the second half of an oversized chunk into a new chunk right after it
+  void splitChunk(int node, int chunkIndex) {
+    std::vector<T>& items = m_nodes[node].items;
+    std::vector<T> tail(std::make_move_iterator(items.begin() + items.size() / 2),
+                        std::make_move_iterator(items.end()));
+    items.erase(items.begin() + items.size() / 2, items.end());
+    updateWeight(node);
+    const int tailNode = newNode(std::move(tail)); // Might reallocate m_nodes
+    int left, right;
+    split(m_root, chunkIndex + 1, left, right); // Updates the aggregates of the old chunk too
+    m_root = merge(merge(left, tailNode), right);
+  }
+  // Joins an undersized chunk with a neighbour, or drops it if it's empty and alone
+  void joinChunk(int chunkIndex) {
+    const int chunks = subtreeChunks(m_root);
+    if (chunks == 1) {
+      if (m_nodes[m_root].items.empty())
+        clear();
+      return;
+    }
+    const int first = (chunkIndex + 1 < chunks) ? chunkIndex : chunkIndex - 1;
+    int left, middle, right, second;
+    split(m_root, first, left, middle);
+    split(middle, 2, middle, right);
+    split(middle, 1, middle, second);
+    Node& a = m_nodes[middle];
+    Node& b = m_nodes[second];
+    a.items.insert(a.items.end(), std::make_move_iterator(b.items.begin()),
+                   std::make_move_iterator(b.items.end()));
+    a.weight += b.weight;
+    update(middle);
+    freeNode(second);
+    if (static_cast<int>(m_nodes[middle].items.size()) > 2 * CHUNK_SIZE) {
+      m_root = merge(merge(left, middle), right);
+      splitChunk(middle, first);
+      return;
+    }
+    m_root = merge(merge(left, middle), right);
+  }
+
+  template <typename Self, typename Fn>
+  static void forEach(Self& self, int node, int nodeIndex, int from, int to, Fn& fn) {
+    // nodeIndex is the index of the first item of this subtree
+    while (node >= 0 && from < to) {
+      auto& n = self.m_nodes[node];
+      const int chunkIndex = nodeIndex + self.subtreeSize(n.left);
+      if (from < chunkIndex)
+        forEach(self, n.left, nodeIndex, from, to, fn);
+      const int chunkEnd = chunkIndex + static_cast<int>(n.items.size());
+      for (int i = std::max(from, chunkIndex); i < std::min(to, chunkEnd); ++i)
+        fn(n.items[i - chunkIndex]);
+      if (to <= chunkEnd)
+        return;
+      node = n.right; // Iterate instead of recursing on the right subtree
+      nodeIndex = chunkEnd;
+    }
+  }
+
+  std::vector<Node> m_nodes;
+  std::vector<int> m_freeNodes;
+  int m_root = -1;
+  uint32_t m_seed = 2463534242u;
+  WeightOf m_weightOf;
+};
+
+#endif // CHUNKEDSEQUENCE_H
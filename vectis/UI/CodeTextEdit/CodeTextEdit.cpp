@@ -1,277 +1,53 @@
 #include <UI/CodeTextEdit/CodeTextEdit.h>
-#include <UI/Utils.h>
+#include <UI/MiniMap/MiniMap.h>
 #include <QPainter>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QInputMethodEvent>
+#include <QClipboard>
 #include <QResizeEvent>
-#include <QRegExp>
 #include <QScrollBar>
-#include <QTextBlock>
-#include <QLabel>
 #include <QHBoxLayout>
-#include <QSyntaxHighlighter>
 #include <QApplication>
 #include <algorithm>
-
-#include <QDebug>
-#include <QElapsedTimer>
-
-//class QTextDocumentSub : public QTextDocument {
-//public:
-//  QTextDocumentSub(QObject *parent = Q_NULLPTR) : QTextDocument(parent) {}
-
-//  void QTextDocumentSub::drawContents(QPainter *p, const QRectF &rect = QRectF()) {
-//    qDebug() << "Hello!!";
-//  }
-//};
-
-class MiniMap : public QLabel {
-public:
-  MiniMap(CodeTextEdit *parent = nullptr) :
-    m_parent(parent),
-    QLabel(parent) {
-    setFixedWidth(WIDTH);
-    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
-    setAlignment(Qt::AlignRight);
-    /*this->setStyleSheet("QLabel { \
-                             border-style: outset; \
-                             border-width: 1px; \
-                             border-color: red; \
-                           } \
-    ");*/
-    //setMouseTracking(true);
-    //setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    //setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-  }
-
-//  void setDocument(QTextDocument *document) {
-//    m_plain_text_edit.setDocument(document);
-//    connect(m_plain_text_edit.document(), &QTextDocument::contentsChanged, [&]() {
-//      QSizeF dim = m_parent->getDocumentDimensions();
-//      QPixmap shot = m_plain_text_edit.grab(QRect(0, 0, dim.width(), dim.height()));
-//      this->setPixmap(shot);
-//    });
-//  }
-
-  void mousePressEvent(QMouseEvent *ev) {
-    if (m_hovering) {
-      m_dragging = true;
-      m_start_dragging_pos = ev->pos();
-
-      auto line_height = QFontMetrics(m_parent->getMonospaceFont()).height();
-      m_start_dragging_scrollbar_pos = m_parent->getVScrollbarPos() / line_height;
-    } else
-      m_dragging = false;
-  }
-
-  void mouseReleaseEvent(QMouseEvent *event) {
-    Q_UNUSED(event);
-    m_dragging = false;
-  }
-
-  void enterEvent(QEvent *event) {
-    Q_UNUSED(event);
-    m_hovering = true;
-    draw_viewport_placeholder();
-  }
-
-  void leaveEvent(QEvent *event) {
-    Q_UNUSED(event);
-    if (m_hovering || m_dragging) {
-      draw_document_pixmap(); // Restore (i.e. clear placeholder)
-      m_hovering = false;
-      m_dragging = false;
-      //m_running_delta += m_last_valid_delta;
-      //qDebug() << "[SAVED RUNNING DELTA]";
+#include <cstdint>
+
+namespace { // Functions reserved for this TU's internal use
+
+  // Monokai, as the syntax highlighters used to have it. Normal text has no foreground: the
+  // palette's text colour is used
+  QTextCharFormat formatOfStyle(Style style) {
+    QTextCharFormat format;
+    switch (style) {
+      case Normal: break;
+      case Keyword: {
+        format.setForeground(QColor(102, 217, 239)); // Light blue
+        format.setFontWeight(QFont::Bold);
+      } break;
+      case KeywordInnerScope: format.setForeground(QColor(249, 38, 114)); break; // Pink-ish
+      case Comment: format.setForeground(QColor(117, 113, 94)); break; // Gray-ish
+      case MultilineComment: format.setForeground(QColor(166, 226, 46)); break; // Green-ish
+      case QuotedString: format.setForeground(QColor(230, 219, 88)); break; // Yellow-ish
+      case Identifier: {
+        format.setForeground(QColor(166, 226, 46)); // Green-ish
+        format.setFontItalic(true);
+      } break;
+      case FunctionCall: format.setForeground(QColor(166, 226, 46)); break;
+      case Literal: format.setForeground(QColor(174, 129, 255)); break; // Purple-ish
+      case CPP_include: format.setForeground(QColor(230, 219, 88)); break;
+      case CPP_QtClass: {
+        format.setForeground(QColor(166, 226, 46));
+        format.setFontWeight(QFont::Bold);
+      } break;
     }
+    return format;
   }
 
-  void draw_viewport_placeholder() {
-    if (!m_hovering)
-      return;
-    int viewport_y = m_parent->getVScrollbarPos();
-    int viewport_height = m_parent->viewport()->height();
-
-    QPixmap new_pixmap = this->pixmap()->copy();
-    QPainter paint(&new_pixmap);
-
-    auto dim = m_parent->getDocumentDimensions();
-    // dim.width() : MiniMap::WIDTH = viewport_height : scaled_viewport_height
-    float scaled_viewport_height = ((float)MiniMap::WIDTH * viewport_height) / dim.width();
-    // dim.width() : MiniMap::WIDTH = viewport_y : scaled_viewport_y
-    float scaled_viewport_y = ((float)MiniMap::WIDTH * viewport_y) / dim.width();
-
-    QPixmap rectangle(MiniMap::WIDTH, scaled_viewport_height);
-    rectangle.fill(QColor(50, 50, 50, 160));
-
-    auto offset = -m_document_pixmap_offset;
-
-    float scaled_doc_height = ((float)MiniMap::WIDTH * dim.height()) / dim.width();
-    if (scaled_doc_height < this->height())
-      offset = 0; // Do not move the pixmap if it can safely be drawn into our area
-
-    // Draw the viewport area placeholder    
-    paint.drawPixmap(0, scaled_viewport_y + offset, MiniMap::WIDTH, scaled_viewport_height, rectangle);
-    QLabel::setPixmap(new_pixmap);
-  }
-
-  void mouseMoveEvent(QMouseEvent *ev) {
-    if (!m_dragging)
-      return;
-
-    auto dim = m_parent->getDocumentDimensions();
-    auto viewport_height = m_parent->viewport()->height();
-    auto scaled_viewport_height = ((float)MiniMap::WIDTH * viewport_height) / dim.width();
-
-
-    // Delta from original mouse position
-    float delta = ev->pos().y() - m_start_dragging_pos.y();
-    float percentage = delta / (this->height() - scaled_viewport_height);
-    percentage = clamp(percentage, -1.f, 1.f);
-
-    auto line_height = QFontMetrics(m_parent->getMonospaceFont()).height();
-
-    // Add a scroll-acceleration factor if the document is very small
-    float factor = 1.f;
-    float scaled_doc_height = ((float)MiniMap::WIDTH * dim.height()) / dim.width();
-    if (scaled_doc_height < this->height())
-      factor = this->height() / scaled_doc_height; // Do not move the pixmap if it can safely be drawn into our area
-
-    auto document_delta = ((dim.height() - m_parent->viewport()->height()) / line_height) * percentage * factor;
-    // Scaled delta to minimap height
-    // dim.width() : MiniMap::WIDTH = dim.height() : scaled_delta
-    //auto scaled_delta = (MiniMap::WIDTH * dim.height()) / dim.width();
-    // Additional delta to have the document scrolled entirely in the minimap's height area
-    // delta : viewport_height = document_pos : document_height
-    //auto additional_delta = (delta * dim.height()) / viewport_height;
-\
-    int new_scrollbar_value = m_start_dragging_scrollbar_pos + document_delta;
-    if (!m_parent->verticalScrollBar()->isVisible() ||
-        new_scrollbar_value < m_parent->verticalScrollBar()->minimum() ||
-        new_scrollbar_value > m_parent->verticalScrollBar()->maximum())
-      return;
-
-    //qDebug() << new_scrollbar_value;
-
-    //qDebug() << m_parent->verticalScrollBar()->value();
-
-    //if (new_scrollbar_value < m_parent->verticalScrollBar()->minimum())
-      //m_document_pixmap_offset = 0;
-    //else if (new_scrollbar_value > m_parent->verticalScrollBar()->maximum()) {
-     // float scaled_doc_height = ((float)MiniMap::WIDTH * dim.height()) / dim.width();
-      //m_document_pixmap_offset = scaled_doc_height - this->height();
-    //} else {
-      m_parent->verticalScrollBar()->setValue(new_scrollbar_value);
-
-      updatePixmapOffsetFromScrollbar(percentage);
-      //qDebug() << "Last m_document_pixmap_offset: " << m_document_pixmap_offset << " with scaled_viewport_y = " <<
-      //            scaled_viewport_y << " and m_running_delta = "  << m_running_delta;
-   // }
-
-      //qDebug() << m_document_pixmap_offset;
-
-    draw_document_pixmap(); // Restore (i.e. clear placeholder)
-    draw_viewport_placeholder(); // Apply new placeholder at mouse position
-  }
-
-//  void reset_highlighter(QString extension) {
-//    m_highlighter = getSyntaxHighlighterFromExtension(extension);
-//    m_highlighter->setParent(this);
-//  }
-
-  void updatePixmapOffsetFromScrollbar(float percentage = 0.f /* additional percentage as supplied by a mouse offset */) {
-    // Update map and placeholder deltas
-    auto dim = m_parent->getDocumentDimensions();
-    auto viewport_height = m_parent->viewport()->height();
-    auto scaled_viewport_height = ((float)MiniMap::WIDTH * viewport_height) / dim.width();
-    float viewport_y = m_parent->getVScrollbarPos();
-    float scaled_viewport_y = ((float)MiniMap::WIDTH * viewport_y) / dim.width();
-
-    float m_running_delta = (
-                        // The percentage of the scrollbar itself (i.e. position where we were)
-                        (m_start_dragging_scrollbar_pos / m_parent->verticalScrollBar()->maximum())
-                        + percentage // Mouse delta percentage in the total scrollable area
-                       ) * (this->height() - scaled_viewport_height);
-
-//      qDebug() << "((float)m_start_dragging_scrollbar_pos / m_parent->verticalScrollBar()->maximum()): "
-//               << ((float)m_start_dragging_scrollbar_pos / m_parent->verticalScrollBar()->maximum()) << "\n"
-//               << "percentage:" << percentage << "\n"
-//               << "(this->height()- scaled_viewport_height):" << (this->height()- scaled_viewport_height) << "\n";
-
-    //int scaled_document_delta = (MiniMap::WIDTH * document_delta) / dim.width();
-    m_document_pixmap_offset = scaled_viewport_y - m_running_delta;
-
-  }
-
-  void setPixmap(const QPixmap& pixmap) {
-
-    m_document_pixmap = pixmap.copy();
-
-    draw_document_pixmap();
-  }
-
-  void draw_document_pixmap() { // Draws document pixmap with the specified offset (and no hover rectangle)
-
-    QPixmap pix(m_document_pixmap.width(), m_document_pixmap.height());
-    pix.fill(Qt::transparent);
-    QPainter paint(&pix);
-
-    // Draw the document pixmap
-    //qDebug() << "-m_document_pixmap_offset = " << -m_document_pixmap_offset;
-
-    auto offset = -m_document_pixmap_offset;
-
-    auto dim = m_parent->getDocumentDimensions();
-    float scaled_doc_height = ((float)MiniMap::WIDTH * dim.height()) / dim.width();
-    if (scaled_doc_height < this->height())
-      offset = 0; // Do not move the pixmap if it can safely be drawn into our area
-
-    paint.drawPixmap(0, offset, pix.width(), pix.height(), m_document_pixmap);
-
-    QLabel::setPixmap(pix);
-  }
-
-  void clear_document_pixmap() { // Cleanup
-    QPixmap pix(MiniMap::WIDTH, 20);
-    pix.fill(Qt::transparent);
-    QLabel::setPixmap(pix);
-    m_document_pixmap = pix;
-  }
-
-  QPixmap& map() {
-    return m_map;
-  }
-
-  QVector<QTextBlock>& blocks() {
-    return m_blocks;
-  }
-
-  QVector<QPixmap>& blocks_pixmaps() {
-    return m_blocks_pixmaps;
-  }
-
-static constexpr const int WIDTH = 150;
-
-  QPixmap m_document_pixmap; // Unmodified document pixmap without hover rectangles or translations
-  float m_document_pixmap_offset = 0.f; // Y offset for the document pixmap to be shown
-  //float m_running_delta = 0.f;
-  //float m_last_valid_delta = 0.f;
-  QPixmap m_old_pixmap_before_hovering;
-  bool m_hovering = false;
-  bool m_dragging = false;
-  QPoint m_start_dragging_pos;
-  float m_start_dragging_scrollbar_pos = 0.f;
-  QPixmap m_map;
-  QVector<QTextBlock> m_blocks;
-  QVector<QPixmap> m_blocks_pixmaps;
-
-
-  CodeTextEdit *m_parent = nullptr;
-  //QPlainTextEdit m_plain_text_edit;
-  //std::unique_ptr<QSyntaxHighlighter> m_highlighter;
-
-};
+  const QColor SELECTION_COLOR(73, 72, 62); // As the selection-background-color of the style sheet
+}
 
 CodeTextEdit::CodeTextEdit(QWidget *parent) :
-  QPlainTextEdit(parent)
+  QAbstractScrollArea(parent)
 {
 
   Q_ASSERT(parent);
@@ -291,7 +67,10 @@ CodeTextEdit::CodeTextEdit(QWidget *parent) :
   " );
   setViewportMargins(0, 0, MiniMap::WIDTH, 0); // Prevent text from going under the minimap
   setAcceptDrops(false);
-  viewport()->setAttribute(Qt::WA_KeyCompression, true);
+  setAttribute(Qt::WA_KeyCompression, true);
+  setAttribute(Qt::WA_InputMethodEnabled, true);
+  viewport()->setCursor(Qt::IBeamCursor);
+  setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff); // Lines are always wrapped
 
   // Disable highlighted text brush (i.e. use an empty brush to paint over)
   QPalette p = this->palette();
@@ -311,6 +90,9 @@ CodeTextEdit::CodeTextEdit(QWidget *parent) :
   m_monospaceFont.setStyleHint( QFont::Monospace );
 
   setFont( m_monospaceFont );
+  m_renderer.setFont( m_monospaceFont );
+  for (int style = Normal; style <= CPP_QtClass; ++style)
+    m_styleFormats.push_back(formatOfStyle(static_cast<Style>(style)));
 
   verticalScrollBar()->setStyleSheet(
 R"(
@@ -354,11 +136,8 @@ QScrollBar::add-line:vertical, QScrollBar::sub-line:vertical {
   m_minimap = new MiniMap(this);
   layout->addWidget(m_minimap);
 
-  //getScreenShot(m_minimap->map());
-
   // Handler for scrollbar scroll (i.e. update the minimap as well)
   connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [&](int) {
-    //qDebug() << "value changed";
     if (!m_minimap->m_dragging) {
       m_minimap->m_start_dragging_scrollbar_pos = verticalScrollBar()->value();
       m_minimap->updatePixmapOffsetFromScrollbar();
@@ -378,6 +157,13 @@ QScrollBar::add-line:vertical, QScrollBar::sub-line:vertical {
   });
   m_regenerate_minimap_delay.setInterval(200);
   m_regenerate_minimap_delay.setSingleShot(true);
+
+  // The cursor is shown right away when it moves, then blinks
+  connect(&m_cursor_blink, &QTimer::timeout, this, [&]() {
+    m_cursor_visible = !m_cursor_visible;
+    viewport()->update(cursorRect().adjusted(-1, 0, 1, 0));
+  });
+  restartCursorBlink();
 }
 
 bool CodeTextEdit::eventFilter(QObject *target, QEvent *event) {
@@ -399,72 +185,95 @@ bool CodeTextEdit::eventFilter(QObject *target, QEvent *event) {
     }
   }
 
-  return QPlainTextEdit::eventFilter(target, event);
+  return QAbstractScrollArea::eventFilter(target, event);
 }
 
-void CodeTextEdit::setDocument(QTextDocument *document, int scrollbar_pos) {
+void CodeTextEdit::setDocument(Document *document, int scrollbar_pos) {
 
+  if (document == nullptr) {
+    unloadDocument();
+    return;
+  }
+  if (!m_document.isNull())
+    m_document->disconnect(this);
+  m_document = document;
   this->setEnabled(true);
 
-  m_last_document_modification = QDateTime::currentDateTime();
-
-  QPlainTextEdit::setDocument(document); // Continue with base class handling
-
+  // The document lays its lines out for this viewport, the ones on screen first
+  m_document->setCharacterWidth(getCharacterWidthPixels());
+  updateVisibleLines();
+  m_document->setWrapWidth(viewport()->width() - 2 * MARGIN);
+  updateScrollBar();
   this->verticalScrollBar()->setValue(scrollbar_pos);
 
-  m_first_time_redraw = true;
-
-  connect(this->document(), &QTextDocument::contentsChanged, this, [&]() {
-
-    // TODO: this might as well be moved into another thread. For now, it isn't much of a big deal.
-    if (m_first_time_redraw == false && m_last_document_modification.msecsTo(QDateTime::currentDateTime()) < 200) {
-      // We're receiving lots of document modifications in a limited amount of time,
-      // slow down with the minimap regeneration
-      qDebug() << "SLOW DOWN!\n";
-      m_regenerate_minimap_delay.start();
-      m_last_document_modification = QDateTime::currentDateTime();
-    } else {
-      m_regenerate_minimap_delay.stop();
-      qDebug() << "Regenerating..\n";
-      this->regenerateMiniMap();
-      m_first_time_redraw = false;
-      m_last_document_modification = QDateTime::currentDateTime();
-    }
-
+  // Edits, lines wrapped in the background and lexing results all show up on the viewport and,
+  // in batches, on the minimap
+  connect(document, &Document::editorLinesChanged, this, [this]() {
+    documentChanged();
+  });
+  connect(document, &Document::linesChanged, this, [this](int, int, int) {
+    documentChanged();
   });
+  connect(document, &Document::linesRestyled, this, [this](int, int) {
+    documentChanged();
+  });
+
+  m_minimap->setDocument(document);
+  regenerateMiniMap();
+  viewport()->update();
+  restartCursorBlink();
 }
 
-void CodeTextEdit::unloadDocument() {
+Document* CodeTextEdit::document() const {
+  return m_document;
+}
 
-    //delete this->document();
-  this->document()->disconnect(this);
-  QPlainTextEdit::setDocument(nullptr);
+void CodeTextEdit::unloadDocument() {
+  if (!m_document.isNull())
+    m_document->disconnect(this);
+  m_document = nullptr;
+  m_regenerate_minimap_delay.stop();
+  m_minimap->setDocument(nullptr);
   m_minimap->clear_document_pixmap();
+  updateScrollBar();
+  viewport()->update();
   this->setEnabled(false);
 }
 
+void CodeTextEdit::documentChanged() {
+  updateScrollBar();
+  viewport()->update();
+  if (!m_regenerate_minimap_delay.isActive())
+    m_regenerate_minimap_delay.start();
+}
+
+// The scrollbar counts editor lines: the last one can be scrolled up to the bottom of the viewport
+void CodeTextEdit::updateScrollBar() {
+  const int visible = viewport()->height() / getLineHeightPixels();
+  const int lines = m_document.isNull() ? 0 : m_document->editorLineCount();
+  verticalScrollBar()->setPageStep(std::max(visible, 1));
+  verticalScrollBar()->setRange(0, std::max(lines - visible, 0));
+}
+
+// Tells the document which physical lines are on screen: these get wrapped first
+void CodeTextEdit::updateVisibleLines() {
+  if (m_document.isNull())
+    return;
+  const int first = verticalScrollBar()->value();
+  const int rows = viewport()->height() / getLineHeightPixels();
+  // Lines not wrapped yet have no editor lines: as every line takes at least a row once wrapped,
+  // at most 'rows' lines follow the first one on screen
+  const int firstLine = m_document->physicalLineOf(first);
+  m_document->setVisibleLines(firstLine, std::min(m_document->physicalLineOf(first + rows), firstLine + rows));
+}
+
+void CodeTextEdit::scrollContentsBy(int, int) {
+  updateVisibleLines();
+  viewport()->update(); // Rows are painted from the scrollbar value, nothing to move
+}
+
 void CodeTextEdit::regenerateMiniMap() {
-  QSizeF dim = getDocumentDimensions();
-  QRect rect(0, 0, dim.width(), dim.height());
-  //qDebug() << rect;
-
-  QPixmap pixmap(rect.width(), rect.height());
-  pixmap.fill(Qt::transparent);
-
-  QRegion region(rect);
-  //this->render(&pixmap, QPoint(0, 0), region);
-  renderDocument(pixmap);
-  //pixmap.save("test.png");
-
-  Qt::AspectRatioMode aspect_ratio_mode = Qt::KeepAspectRatioByExpanding;
-  // KeepAspectRatioByExpanding keeps the width scaled and expands on the height, but this only
-  // works if the document_width / minimap_width ratio is greater than document_height / minimap_height,
-  // otherwise the height is kept scaled and the width is expanded (not what we want). Therefore we
-  // switch to a KeepAspectRatio (both width and height are resized uniformly) when we're sure we can
-  // fit the width (adjusted with adjustSize anyway)
-  if (dim.height() / m_minimap->height() <= dim.width() / MiniMap::WIDTH)
-    aspect_ratio_mode = Qt::KeepAspectRatio;
-  m_minimap->setPixmap(pixmap.scaled(MiniMap::WIDTH, m_minimap->height(), aspect_ratio_mode, Qt::SmoothTransformation));
+  m_minimap->regenerate(); // Only the lines changed since the last time get rendered
 
   m_minimap->m_start_dragging_scrollbar_pos = verticalScrollBar()->value();
   m_minimap->updatePixmapOffsetFromScrollbar();
@@ -474,80 +283,294 @@ void CodeTextEdit::regenerateMiniMap() {
 }
 
 float CodeTextEdit::getVScrollbarPos() const {
-  auto line_height = QFontMetrics(getMonospaceFont()).height();
-  return ((float)this->verticalScrollBar()->value() * line_height);
+  return ((float)this->verticalScrollBar()->value() * getLineHeightPixels());
 }
 
-void CodeTextEdit::paintEvent(QPaintEvent *e) {
-  QPlainTextEdit::paintEvent(e);
+LineLayoutCache::Statistics CodeTextEdit::getLineLayoutCacheStatistics() const {
+  return m_renderer.cacheStatistics();
 }
 
-void CodeTextEdit::resizeEvent(QResizeEvent *e) {
+// Paints the editor lines intersecting the area, each one with the formats of its lexer styles
+void CodeTextEdit::paintEvent(QPaintEvent *e) {
+  if (m_document.isNull())
+    return;
+
+  QPainter painter(viewport());
+  const QRect area = e->rect();
+  const int lineHeight = getLineHeightPixels();
+  const int top = verticalScrollBar()->value();
+  const int first = top + std::max(area.top(), 0) / lineHeight;
+  const int last = std::min(top + area.bottom() / lineHeight, m_document->editorLineCount() - 1);
+  m_renderer.begin(palette().text().color(), viewport()->devicePixelRatioF() == 1.0);
+
+  // The selection goes under the text, from its start column to its end one (to the viewport's end on
+  // the lines it continues after)
+  Document::EditorPosition selectionStart{0, 0}, selectionEnd{-1, 0};
+  if (m_document->hasSelection()) {
+    selectionStart = m_document->editorPositionAt(m_document->selectionStart());
+    selectionEnd = m_document->editorPositionAt(m_document->selectionEnd());
+  }
+  const qreal characterWidth = m_renderer.characterWidth();
+  for (int line = std::max(first, selectionStart.editorLine); line <= std::min(last, selectionEnd.editorLine); ++line) {
+    const qreal left = MARGIN + ((line == selectionStart.editorLine) ? selectionStart.column * characterWidth : 0);
+    const qreal right = (line == selectionEnd.editorLine) ? MARGIN + selectionEnd.column * characterWidth : viewport()->width();
+    painter.fillRect(QRectF(left, (line - top) * lineHeight, right - left, lineHeight), SELECTION_COLOR);
+  }
 
-  QPlainTextEdit::resizeEvent(e);
+  QVector<QTextLayout::FormatRange> formats;
+  for (int line = first; line <= last; ++line) {
+    m_document->editorLineStyles(line, m_styleRuns);
+    formats.clear();
+    for (const Document::StyleRun& run : m_styleRuns) {
+      QTextLayout::FormatRange range;
+      range.start = run.start;
+      range.length = run.length;
+      range.format = getStyleFormat(run.style);
+      formats.append(range);
+    }
+    m_renderer.drawLine(painter, m_document->editorLineText(line), formats,
+                        QPointF(MARGIN, (line - top) * lineHeight));
+  }
+  m_renderer.end(painter);
+
+  // The text being composed by an input method goes over the text at the caret, underlined
+  const QRect cursor = cursorRect();
+  if (!m_preedit.isEmpty()) {
+    QFont font = m_monospaceFont;
+    font.setUnderline(true);
+    const QRect area(cursor.left(), cursor.top(), viewport()->width() - cursor.left(), cursor.height());
+    painter.fillRect(area, palette().window());
+    painter.setFont(font);
+    painter.setPen(palette().text().color());
+    painter.drawText(area, Qt::AlignLeft | Qt::AlignVCenter, m_preedit);
+  }
 
-  m_regenerate_minimap_delay.stop();
-  m_regenerate_minimap_delay.start();
+  // The cursor goes over the text
+  if (m_cursor_visible && hasFocus())
+    painter.fillRect(cursor, palette().text());
 }
 
-QFont CodeTextEdit::getMonospaceFont() const {
-  return m_monospaceFont;
+// In viewport coordinates
+QRect CodeTextEdit::cursorRect() const {
+  if (m_document.isNull())
+    return QRect();
+  const int lineHeight = getLineHeightPixels();
+  const int x = MARGIN + qRound(m_document->cursorColumn() * m_renderer.characterWidth());
+  return QRect(x, (m_document->cursorEditorLine() - verticalScrollBar()->value()) * lineHeight, 1, lineHeight);
 }
 
-QSizeF CodeTextEdit::getDocumentDimensions() const {
+void CodeTextEdit::ensureCursorVisible() {
+  const int line = m_document->cursorEditorLine();
+  const int visible = std::max(viewport()->height() / getLineHeightPixels(), 1);
+  if (line < verticalScrollBar()->value())
+    verticalScrollBar()->setValue(line);
+  else if (line >= verticalScrollBar()->value() + visible)
+    verticalScrollBar()->setValue(line - visible + 1);
+}
 
-  auto line_height = QFontMetrics(getMonospaceFont()).height();
-  //this->document()->adjustSize(); // document()->size().width() returns the viewport width (i.e. much wider than
-                                  // the actual contained text)
-  //auto ideal_width = document()->idealWidth();
-  //auto char_width = QFontMetrics(getMonospaceFont()).width("A");
-  //qDebug() << document()->size().width();
-  auto width = document()->size().width();
-  if (width < 200)
-    width = 200;
-  return QSizeF(width, document()->size().height() * line_height);
+// Caret movements, selection, clipboard, undo and typing. Every edit goes through the document,
+// which keeps its lines wrapped and lexed
+void CodeTextEdit::keyPressEvent(QKeyEvent *e) {
+  if (m_document.isNull()) {
+    QAbstractScrollArea::keyPressEvent(e);
+    return;
+  }
+
+  if (e->matches(QKeySequence::SelectAll)) {
+    m_document->selectAll();
+  } else if (e->matches(QKeySequence::Copy)) {
+    copy();
+    return;
+  } else if (e->matches(QKeySequence::Cut)) {
+    copy();
+    m_document->eraseSelection();
+  } else if (e->matches(QKeySequence::Paste)) {
+    m_document->typeAtCursor(QApplication::clipboard()->text());
+  } else if (e->matches(QKeySequence::Undo)) {
+    m_document->undo();
+  } else if (e->matches(QKeySequence::Redo)) {
+    m_document->redo();
+  } else if (!moveCursor(e)) {
+    switch (e->key()) {
+      case Qt::Key_Return:
+      case Qt::Key_Enter: m_document->typeNewlineAtCursor(); break;
+      case Qt::Key_Backspace: m_document->eraseBeforeCursor(); break;
+      case Qt::Key_Delete: m_document->eraseAfterCursor(); break;
+      default: {
+        const QString text = e->text();
+        if (text.isEmpty() || !text.at(0).isPrint() || (e->modifiers() & Qt::ControlModifier)) {
+          QAbstractScrollArea::keyPressEvent(e);
+          return;
+        }
+        m_document->typeAtCursor(text);
+      }
+    }
+  }
+  ensureCursorVisible();
+  restartCursorBlink();
+  viewport()->update();
 }
 
-// Expensive - renders the entire document on the given pixmap
-void CodeTextEdit::renderDocument(QPixmap& map) const
-{
-    QPainter painter(&map);
+// Moves the caret for the navigation keys, extending the selection while Shift is held. Returns
+// false for the other keys
+bool CodeTextEdit::moveCursor(QKeyEvent *e) {
+  const bool selecting = (e->modifiers() & Qt::ShiftModifier) != 0;
+  const bool words = (e->modifiers() & Qt::ControlModifier) != 0;
+  const int x = m_document->cursorColumn();
+  const int y = m_document->cursorEditorLine();
+  const int page = verticalScrollBar()->pageStep();
+  const size_t offset = m_document->cursorOffset();
+  switch (e->key()) {
+    case Qt::Key_Left: words ? m_document->moveCursorWordLeft() : m_document->moveCursorLeft(); break;
+    case Qt::Key_Right: words ? m_document->moveCursorWordRight() : m_document->moveCursorRight(); break;
+    case Qt::Key_Up: m_document->setCursorPos(x, std::max(y - 1, 0)); break;
+    case Qt::Key_Down: m_document->setCursorPos(x, y + 1); break;
+    case Qt::Key_PageUp: m_document->setCursorPos(x, std::max(y - page, 0)); break;
+    case Qt::Key_PageDown: m_document->setCursorPos(x, y + page); break;
+    case Qt::Key_Home: words ? m_document->setCursorOffset(0) : m_document->setCursorPos(0, y); break;
+    case Qt::Key_End: words ? m_document->setCursorOffset(SIZE_MAX) : m_document->setCursorPos(-1, y); break; // Before the newline
+    default: return false;
+  }
+  if (!selecting)
+    m_document->clearSelection();
+  else if (!m_document->hasSelection() && m_document->cursorOffset() != offset)
+    m_document->setSelectionAnchor(offset);
+  return true;
+}
 
-    int offset = 0;
-    document()->adjustSize();
-    auto block = document()->firstBlock();
+void CodeTextEdit::copy() {
+  if (m_document->hasSelection())
+    QApplication::clipboard()->setText(m_document->selectedText());
+}
 
-    while (block.isValid()) {
+// The caret goes to the column boundary closest to a point of the viewport
+void CodeTextEdit::setCursorAt(const QPoint& pos) {
+  const int column = std::max(qRound((pos.x() - MARGIN) / m_renderer.characterWidth()), 0);
+  const int line = verticalScrollBar()->value() + std::max(pos.y(), 0) / getLineHeightPixels();
+  m_document->setCursorPos(column, std::min(line, std::max(m_document->editorLineCount() - 1, 0)));
+}
 
-        QRectF r = blockBoundingRect(block);
-        QTextLayout *layout = block.layout();
+// A click moves the caret (extending the selection with Shift), dragging selects
+void CodeTextEdit::mousePressEvent(QMouseEvent *e) {
+  if (m_document.isNull() || e->button() != Qt::LeftButton) {
+    QAbstractScrollArea::mousePressEvent(e);
+    return;
+  }
+  const size_t cursor = m_document->cursorOffset();
+  const bool extending = (e->modifiers() & Qt::ShiftModifier) != 0;
+  if (extending && !m_document->hasSelection())
+    m_document->setSelectionAnchor(cursor);
+  setCursorAt(e->pos());
+  if (!extending)
+    m_document->setSelectionAnchor(m_document->cursorOffset());
+  restartCursorBlink();
+  viewport()->update();
+}
 
-        if (!block.isVisible()) {
+void CodeTextEdit::mouseMoveEvent(QMouseEvent *e) {
+  if (m_document.isNull() || !(e->buttons() & Qt::LeftButton)) {
+    QAbstractScrollArea::mouseMoveEvent(e);
+    return;
+  }
+  setCursorAt(e->pos());
+  ensureCursorVisible(); // Dragging past the viewport scrolls
+  restartCursorBlink();
+  viewport()->update();
+}
 
-            offset += r.height();
-            block = block.next();
-            continue;
+void CodeTextEdit::mouseDoubleClickEvent(QMouseEvent *e) {
+  if (m_document.isNull() || e->button() != Qt::LeftButton) {
+    QAbstractScrollArea::mouseDoubleClickEvent(e);
+    return;
+  }
+  setCursorAt(e->pos());
+  m_document->selectWordAt(m_document->cursorOffset());
+  restartCursorBlink();
+  viewport()->update();
+}
 
-        } else {
-            layout->draw(&painter, QPoint(0, offset));
-        }
+// Input methods (e.g. for CJK text) compose text before committing it: the text being composed is
+// shown at the caret, the committed one is typed
+void CodeTextEdit::inputMethodEvent(QInputMethodEvent *e) {
+  if (m_document.isNull()) {
+    e->ignore();
+    return;
+  }
+  if (!e->commitString().isEmpty())
+    m_document->typeAtCursor(e->commitString());
+  m_preedit = e->preeditString();
+  ensureCursorVisible();
+  restartCursorBlink();
+  viewport()->update();
+  e->accept();
+}
 
-        offset += r.height();
+QVariant CodeTextEdit::inputMethodQuery(Qt::InputMethodQuery query) const {
+  if (m_document.isNull())
+    return QAbstractScrollArea::inputMethodQuery(query);
+  switch (query) {
+    case Qt::ImEnabled: return true;
+    case Qt::ImFont: return m_monospaceFont;
+    case Qt::ImCursorRectangle: return cursorRect().translated(viewport()->pos());
+    case Qt::ImCursorPosition: return m_document->cursorColumn();
+    case Qt::ImAnchorPosition: return m_document->cursorColumn();
+    case Qt::ImSurroundingText: return m_document->editorLineText(m_document->cursorEditorLine());
+    case Qt::ImCurrentSelection: return m_document->selectedText();
+    default: return QAbstractScrollArea::inputMethodQuery(query);
+  }
+}
 
-        block = block.next();
-    }
+// The cursor is only drawn (and blinked) while the editor has the focus
+void CodeTextEdit::restartCursorBlink() {
+  m_cursor_visible = true;
+  viewport()->update(cursorRect().adjusted(-1, 0, 1, 0));
+  if (hasFocus() && QApplication::cursorFlashTime() > 0)
+    m_cursor_blink.start(QApplication::cursorFlashTime() / 2);
+  else
+    m_cursor_blink.stop();
 }
 
-void CodeTextEdit::renderBlock(QPainter& painter, const QTextBlock& block) const
-{
-  if (block.isValid()) {
+void CodeTextEdit::focusInEvent(QFocusEvent *e) {
+  QAbstractScrollArea::focusInEvent(e);
+  restartCursorBlink();
+}
 
-      QRectF r = blockBoundingRect(block);
-      QTextLayout *layout = block.layout();
+void CodeTextEdit::focusOutEvent(QFocusEvent *e) {
+  QAbstractScrollArea::focusOutEvent(e);
+  m_cursor_blink.stop();
+  viewport()->update(cursorRect().adjusted(-1, 0, 1, 0)); // Erase the cursor
+}
 
-      if (block.isVisible()) {
+void CodeTextEdit::resizeEvent(QResizeEvent *e) {
 
-          layout->draw(&painter, QPoint(0, 0));
-      }
+  QAbstractScrollArea::resizeEvent(e);
+  if (!m_document.isNull()) {
+    updateVisibleLines();
+    m_document->setWrapWidth(viewport()->width() - 2 * MARGIN); // Lines on screen are wrapped right away
   }
+  updateScrollBar();
+
+  m_regenerate_minimap_delay.stop();
+  m_regenerate_minimap_delay.start();
+}
+
+QFont CodeTextEdit::getMonospaceFont() const {
+  return m_monospaceFont;
+}
+
+int CodeTextEdit::getCharacterWidthPixels() const {
+  return QFontMetrics(getMonospaceFont()).horizontalAdvance(QLatin1Char('A'));
+}
+
+int CodeTextEdit::getLineHeightPixels() const {
+  return QFontMetrics(getMonospaceFont()).height();
+}
+
+const QTextCharFormat& CodeTextEdit::getStyleFormat(Style style) const {
+  return m_styleFormats[style];
+}
+
+QSizeF CodeTextEdit::getDocumentDimensions() const {
+  const int lines = m_document.isNull() ? 0 : m_document->editorLineCount();
+  return QSizeF(std::max(viewport()->width(), 200), static_cast<qreal>(lines) * getLineHeightPixels());
 }
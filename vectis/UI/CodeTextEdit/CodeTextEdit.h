@@ -1,36 +1,71 @@
 #ifndef CUSTOMCODEEDIT_H
 #define CUSTOMCODEEDIT_H
 #include <UI/CodeTextEdit/Document.h>
+#include <UI/CodeTextEdit/MonospaceRenderer.h>
 #include <UI/ScrollBar/ScrollBar.h>
-#include <QPlainTextEdit>
-#include <QDateTime>
+#include <QAbstractScrollArea>
+#include <QPointer>
+#include <QTextCharFormat>
 #include <QTimer>
+#include <vector>
 
 class MiniMap;
 
-// The code and text edit control (everything gets rendered to it)
-class CodeTextEdit : public QPlainTextEdit {
+// The code and text edit control (everything gets rendered to it). It shows a Document: its
+// editor lines are painted a line per row of the viewport and the scrollbar counts editor lines
+class CodeTextEdit : public QAbstractScrollArea {
     Q_OBJECT
 public:
     explicit CodeTextEdit(QWidget *parent = 0);
 
+    static constexpr const int MARGIN = 4; // Pixels between the viewport border and the text
+
     QFont getMonospaceFont() const;
-    void renderDocument(QPixmap& map) const;
-    QSizeF getDocumentDimensions() const;    
-    void renderBlock(QPainter &painter, const QTextBlock &block) const;
-    void setDocument(QTextDocument *document, int scrollbar_pos = 0);
+    int getCharacterWidthPixels() const;
+    int getLineHeightPixels() const;
+    QSizeF getDocumentDimensions() const;
+    // How text of a lexer style looks like
+    const QTextCharFormat& getStyleFormat(Style style) const;
+    // The editor doesn't own the document: it has to outlive it or be unloaded first
+    void setDocument(Document *document, int scrollbar_pos = 0);
+    Document* document() const;
     void unloadDocument();
 
     float getVScrollbarPos() const;
+    // Hits and misses of the lines drawn on the viewport (see LineLayoutCache)
+    LineLayoutCache::Statistics getLineLayoutCacheStatistics() const;
     void paintEvent(QPaintEvent *e);
     void resizeEvent(QResizeEvent *e);
+    void keyPressEvent(QKeyEvent *e);
+    void mousePressEvent(QMouseEvent *e);
+    void mouseMoveEvent(QMouseEvent *e);
+    void mouseDoubleClickEvent(QMouseEvent *e);
+    void inputMethodEvent(QInputMethodEvent *e);
+    QVariant inputMethodQuery(Qt::InputMethodQuery query) const;
+    void focusInEvent(QFocusEvent *e);
+    void focusOutEvent(QFocusEvent *e);
+    void scrollContentsBy(int dx, int dy);
 private:
     QFont m_monospaceFont;
     MiniMap *m_minimap = nullptr;
-    bool m_first_time_redraw = true;
+    QPointer<Document> m_document;
+    std::vector<QTextCharFormat> m_styleFormats; // Indexed by Style
+    std::vector<Document::StyleRun> m_styleRuns; // Scratch space for painting
+    MonospaceRenderer m_renderer;
+    QTimer m_cursor_blink;
+    bool m_cursor_visible = true;
+    QString m_preedit; // Being composed by an input method
+    QRect cursorRect() const;
+    bool moveCursor(QKeyEvent *e);
+    void copy();
+    void setCursorAt(const QPoint& pos);
+    void ensureCursorVisible();
+    void restartCursorBlink();
+    void documentChanged();
+    void updateScrollBar();
+    void updateVisibleLines();
     void regenerateMiniMap();
     bool eventFilter(QObject *target, QEvent *event);
-    QDateTime m_last_document_modification;
     QTimer m_regenerate_minimap_delay;
 };
 
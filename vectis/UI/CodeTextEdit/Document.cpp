@@ -1,564 +1,1312 @@
-//#include <UI/CodeTextEdit/Document.h>
-//#include <UI/CodeTextEdit/CodeTextEdit.h>
-//#include <UI/CodeTextEdit/Lexers/Lexer.h>
-//#include <QFile>
-//#include <QTextStream>
-//#include <QRegExp>
-//#include <QtConcurrent>
-//#include <functional>
-//#include <algorithm>
-//#include <fstream>
-//#include <sstream>
-//#include <string>
-
-//#include <QDebug>
-//#include <QElapsedTimer>
-
-//Document::Document(const CodeTextEdit& codeTextEdit) :
-//  m_codeTextEdit(codeTextEdit),
-//  m_wrapWidth(-1),
-//  m_needReLexing(false)
-//{
-//  // A document has always at least one physical line and an editorline
-//  m_physicalLines.resize(1);
-//  m_physicalLines.back().m_editorLines.emplace_back(QString());
-//  setCursorPos(0, 0);
-//}
-
-//// The following function loads the contents of a text file into memory.
-//// This is a memory-expensive operation but documents need to be available at any time
-//// Returns true on success
-//bool Document::loadFromFile(QString file) {
-
-//  std::ifstream f(file.toStdString(), std::ios::binary /* Necessary to preserve e.g. \r on Windows */);
-//  if (!f)
-//    return false;
-
-//  // Load the entire file into memory (memory-expensive but necessary)
-//  std::stringstream strStream;
-//  strStream << f.rdbuf();
-//  std::string str = strStream.str();
-
-//  f.close();
-
-//  // Separate lines into different chunks when \n or \r\n is found
-//  m_plainTextLines.clear();
-//  QString line;
-//  for(auto ch : str) {
-//    line += ch;
-//    if (ch == '\n') {
-
-//      QRegExp tabs("\t");
-//      line.replace(tabs, QString(4, 0x07)); // Use the 0x07 BELL ascii char as tabulation marker
-
-//      m_plainTextLines.push_back(std::move(line));
-//      line.clear();
-//    }
-//  }
-//  // Add an extra empty line if the last line ended with a \n
-//  if (!m_plainTextLines.empty()) {
-//    auto& lastLine = m_plainTextLines.back();
-//    if (!lastLine.isEmpty() && lastLine.endsWith('\n'))
-//      m_plainTextLines.emplace_back();
-//  }
-
-//  return true;
-//}
-
-//void Document::applySyntaxHighlight(SyntaxHighlight s) {
-//  m_needReLexing = false;
-//  switch(s) {
-//    case NONE: {
-//      if (m_lexer) { // Check if there were a lexer before (i.e. the smart pointer was set)
-//        m_lexer.release();
-//        m_needReLexing = true; // Syntax has been changed, re-lex the document at the next recalculate
-//      }
-//    } break;
-//    case CPP: {
-//      if (!m_lexer || isLexer(m_lexer.get()).ofType(CPPLexerType) == false) {
-//        m_lexer.reset( LexerBase::createLexerOfType(CPPLexerType) );
-//        m_needReLexing = true; // Syntax has been changed, re-lex the document at the next recalculate
-//      }
-//    } break;
-//  }
-
-
-//  // If the document was already recalculated, just recalculate and apply the new syntax highlight
-//  if (m_firstDocumentRecalculate == false)
-//    recalculateDocumentLines ();
-//}
-
-//// Triggers a lines/breakpoints recalculation for the entire document. -1 means
-//// "no wrap" and it's the default
-//void Document::setWrapWidth(int width) {
-//  m_wrapWidth = width;
-//  // qDebug() << "setWrapWidth() to " << width;
-//  recalculateDocumentLines (); // Recalculate the editor lines with this wrap value
-//}
-
-
-//namespace {
-
-//  struct VecAccumulator {
-//    VecAccumulator() = default;
-//    std::vector<PhysicalLine> m_physicalLines;
-//  };
-
-//}
-
-//// A complex multithreaded function which performs wrap-around calculations and, if necessary, triggers
-//// a complete relexing of the document
-//void Document::recalculateDocumentLines () {
-
-//  //QElapsedTimer timer;
-//  //timer.start();
-
-//  m_firstDocumentRecalculate = false;
-
-//  if (m_needReLexing) {
-//    QString m_plainText;
-//    for(auto& line : m_plainTextLines) // Expensive, hopefully this doesn't happen too often - LEX DIRECTLY FROM VECTOR
-//      m_plainText.append(line);
-//    m_lexer->lexInput(std::move(m_plainText.toStdString()), m_styleDb);
-//    m_needReLexing = false;
-//  }
-
-//  // Store how many lines
-
-//  // Drop previous lines
-//  m_physicalLines.clear();
-//  m_numberOfEditorLines = 0;
-//  // m_maximumCharactersLine = 0;
-
-
-//  std::function<std::vector<PhysicalLine> (const QString&)> mapFn = [&,this](const QString& line) {
-
-//    std::vector<PhysicalLine> phLineVec;
-//    QString restOfLine;
-//    std::vector<EditorLine> edLines;
-//    edLines.reserve(10); // Should be enough for every splitting
-//    if (m_wrapWidth != -1 && // Also check if the monospace'd width isn't exceeding the viewport
-//        line.count() * m_codeTextEdit.getCharacterWidthPixels() > m_wrapWidth) {
-//      // We have a wrap and the line is too big - WRAP IT
-
-//      edLines.clear();
-//      restOfLine = line;
-
-//      // Calculate the allowed number of characters per editor line
-//      int maxChars = static_cast<int>( m_wrapWidth / m_codeTextEdit.getCharacterWidthPixels() );
-//      if (maxChars < 10)
-//        maxChars = 10; // Keep it to a minimum
-
-//      // Start the wrap-splitting algorithm or resort to a brute-force character splitting one if
-//      // no suitable spaces could be found to split the line
-//      while(restOfLine.size() > maxChars) {
-
-//        int bestSplittingPointFound = -1;
-//        for(int i = 0; i < restOfLine.count(); ++i) {
-//          if (i > maxChars)
-//            break; // We couldn't find a suitable space split point for restOfLine
-//          if ( restOfLine[i] == ' ' && i != 0 /* Doesn't make sense to split at 0 pos */)
-//            bestSplittingPointFound = i;
-//        }
-
-//        if (bestSplittingPointFound != -1) { // We found a suitable space point to split this line
-//          edLines.push_back( restOfLine.left( bestSplittingPointFound ));
-//          restOfLine = restOfLine.right( restOfLine.size() - bestSplittingPointFound );
-//        } else {
-//          // No space found, brutally split characters
-//          edLines.push_back( restOfLine.left( maxChars ));
-//          restOfLine = restOfLine.right( restOfLine.size() - maxChars );
-//          //qDebug() << "BRUTAL SPLIT" << bestSplittingPointFound;
-//        }
-//      }
-//      edLines.push_back( restOfLine ); // Insert the last part and proceed
+#include <UI/CodeTextEdit/Document.h>
+#include <UI/CodeTextEdit/Lexers/Lexer.h>
+#include <QtConcurrent>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <numeric>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+namespace {
+
+  const size_t LEXING_WINDOW = 64 * 1024; // Text past an edit copied for the lexing job, to begin with
+  const int VISIBLE_LINES_GUESS = 128; // Wrapped and lexed first when the lines on screen aren't known yet
+
+}
+
+Document::Document(QObject *parent) :
+  QObject(parent),
+  m_characterWidthPixels(1),
+  m_wrapWidth(-1),
+  m_numberOfEditorLines(1),
+  m_needReLexing(false),
+  m_lexingWindow(LEXING_WINDOW)
+{
+  // A document has always at least one physical line and an editorline
+  PhysicalLine line;
+  line.m_stale = false;
+  m_physicalLines.assign({line});
+  m_editorLineIndex.build({1});
+  setCursorPos(0, 0);
+
+  // Lines off screen are wrapped a slice at a time, letting the event loop run in between
+  m_wrapTimer.setSingleShot(true);
+  m_wrapTimer.setInterval(0);
+  connect(&m_wrapTimer, &QTimer::timeout, this, [this]() {
+    wrapSlice();
+  });
+  connect(&m_lexingWatcher, &QFutureWatcher<LexingResult>::finished, this, [this]() {
+    lexingFinished();
+  });
+}
+
+// The following function loads the contents of a text file into the document buffer, all at once.
+// The file is memory-mapped and, unless its text has to be converted, the piece table uses the
+// mapping directly as its read-only original buffer (see FileText). Returns true on success
+bool Document::loadFromFile(QString file) {
+  std::shared_ptr<FileText> text = std::make_shared<FileText>();
+  const bool opened = text->open(file);
+  beginLoading(opened ? text : nullptr);
+  if (!opened)
+    return false;
+  std::vector<uint64_t> lineStarts;
+  const size_t size = text->readChunk(text->fileSize(), lineStarts);
+  appendLoadedText(size, lineStarts);
+  return true;
+}
+
+void Document::beginLoading(std::shared_ptr<FileText> text) {
+  m_buffer.clear(); // Might be pointing into the previous text
+  m_text = std::move(text);
+  if (m_text)
+    m_buffer.resetGrowing(m_text->data(), m_text->maximumSize());
+  m_physicalLines.clear(); // Nothing to reuse: every line gets wrapped at the next recalculate
+  m_lineArenas.clear();
+  m_freeLineArenas.clear();
+  m_editorLineIndex.build({});
+  m_editedSinceLexing.clear();
+  m_lexingDocument = false;
+  ++m_generation;
+  m_needReLexing = static_cast<bool>(m_lexer); // Previous lexing results are meaningless now
+  m_selecting = false;
+  m_undoSteps.clear();
+  m_redoSteps.clear();
+  m_undoMergeable = false;
+  m_unmodifiedSteps = 0;
+}
+
+// The next chunk of the text being loaded is ready: it's appended as if typed at the end of the
+// document, but its lines are wrapped as the ones of a document just loaded, i.e. the ones on screen
+// right away and the others in the background
+void Document::appendLoadedText(size_t length, const std::vector<uint64_t>& lineStarts) {
+  const size_t offset = m_buffer.size();
+  const int oldCount = m_physicalLines.size();
+  m_buffer.appendOriginal(length, lineStarts);
+  if (length == 0 || m_firstDocumentRecalculate)
+    return; // Nothing to lay out yet, the first recalculate does it (and lexes everything)
+  noteEdit(offset, 0, length);
+  if (offset == 0) { // The first text of a document shown empty
+    recalculateDocumentLines();
+    emit linesChanged(0, oldCount, m_physicalLines.size());
+    return;
+  }
+
+  const int last = oldCount - 1; // Gets the first line of the chunk
+  const int added = static_cast<int>(lineStarts.size());
+  markEdited(last);
+  m_physicalLines.append(added, PhysicalLine());
+  m_editorLineIndex.append(std::vector<int>(added, 0));
+  for (int line = last + 1; line <= last + added; ++line)
+    m_staleLines.push_back(line);
+  m_staleCount += added;
+
+  std::vector<int> lines;
+  for (int line = std::max(last, m_firstVisibleLine); line <= std::min(last + added, m_lastVisibleLine); ++line)
+    lines.push_back(line);
+  wrapLines(lines);
+  m_wrapTimer.start();
+  updateCursorAfterWrap();
+  emit linesChanged(last, 1, 1 + added);
+  relex();
+}
+
+void Document::applySyntaxHighlight(SyntaxHighlight s) {
+  ++m_generation;
+  m_needReLexing = false;
+  switch(s) {
+    case NONE: {
+      if (m_lexer) { // Check if there were a lexer before (i.e. the smart pointer was set)
+        m_lexer.reset();
+        m_needReLexing = true; // Syntax has been changed, re-lex the document at the next recalculate
+      }
+    } break;
+    case CPP: {
+      if (!m_lexer || isLexer(m_lexer.get()).ofType(CPPLexerType) == false) {
+        m_lexer.reset( LexerBase::createLexerOfType(CPPLexerType) );
+        m_needReLexing = true; // Syntax has been changed, re-lex the document at the next recalculate
+      }
+    } break;
+  }
+
+
+  // If the document was already recalculated, just recalculate and apply the new syntax highlight
+  if (m_firstDocumentRecalculate == false)
+    recalculateDocumentLines ();
+}
+
+// Triggers a lines/breakpoints recalculation for the entire document. -1 means
+// "no wrap" and it's the default
+void Document::setWrapWidth(int width) {
+  m_wrapWidth = width;
+  recalculateDocumentLines (); // Recalculate the editor lines with this wrap value
+}
+
+// Wrap widths are in pixels: the document keeps the character width of the font it's shown with
+void Document::setCharacterWidth(int pixels) {
+  m_characterWidthPixels = std::max(pixels, 1);
+}
+
+void Document::setVisibleLines(int first, int last) {
+  m_firstVisibleLine = first;
+  m_lastVisibleLine = last;
+
+  // Stale lines scrolled into view don't wait for the background wrapping
+  std::vector<int> lines;
+  for (int line = std::max(first, 0); line <= std::min(last, physicalLineCount() - 1); ++line) {
+    if (m_physicalLines[line].m_stale)
+      lines.push_back(line);
+  }
+  if (!lines.empty()) {
+    wrapLines(lines);
+    updateCursorAfterWrap();
+    emit editorLinesChanged();
+  }
+  lexVisibleLines();
+}
+
+
+namespace {
+
+  const int SYNC_WRAP_LINES = 1024; // Stale lines wrapped right away even if off screen
+  const int PARALLEL_WRAP_LINES = 256; // Fewer lines than this are wrapped on the calling thread
+  const size_t WRAP_BATCH_LINES = 4096;
+  const size_t LINE_ARENA_BLOCK_SIZE = 64 * 1024; // At most, passes wrapping a few lines get less
+  const size_t LINE_ARENA_SLACK = 256; // The arena keeps some bookkeeping in its blocks
+  const qint64 WRAP_SLICE_BUDGET_NS = 4000000;
+
+}
+
+// Triggers a relexing of the document (incremental if possible) and wraps the stale lines: the ones
+// on screen right away, the others in the background unless there are just a few of them
+void Document::recalculateDocumentLines () {
+
+  m_firstDocumentRecalculate = false;
+  relex();
+
+  const int lineCount = m_buffer.isEmpty() ? 0 : static_cast<int>(m_buffer.lineCount());
+  const int columns = wrapColumns(m_wrapWidth);
+  std::vector<int> lines; // To be wrapped right away
+
+  if (m_physicalLines.size() != lineCount) { // Just loaded
+    m_physicalLines.clear();
+    m_physicalLines.append(lineCount, PhysicalLine());
+    m_lineArenas.clear(); // The breaks of the previous lines all go away at once
+    m_freeLineArenas.clear();
+    m_editorLineIndex.build(std::vector<int>(lineCount, 0));
+    m_numberOfEditorLines = 0;
+    m_staleLines.resize(lineCount); // Every line is stale, the ones on screen are wrapped below
+    std::iota(m_staleLines.begin(), m_staleLines.end(), 0);
+    m_staleCount = lineCount;
+  } else if (columns != m_wrappedColumns) {
+    // The lines fitting both the old and the new width stay as they are
+    const int oldColumns = m_wrappedColumns;
+    const int fitting = (oldColumns == 0) ? columns : (columns == 0) ? oldColumns : std::min(columns, oldColumns);
+    std::vector<int> notFitting;
+    int line = 0;
+    m_physicalLines.forEach(0, lineCount, [&](const PhysicalLine& pl) {
+      if (pl.m_length > fitting)
+        notFitting.push_back(line);
+      ++line;
+    });
+    for (int line : notFitting)
+      markStale(line);
+  }
+  m_wrappedColumns = columns;
+
+  if (m_staleCount > 0) {
+    const bool all = (m_staleCount <= SYNC_WRAP_LINES);
+    const int firstVisible = std::max(m_firstVisibleLine, 0);
+    const int lastVisible = (m_lastVisibleLine >= firstVisible) ? m_lastVisibleLine : firstVisible + VISIBLE_LINES_GUESS;
+    if (all) {
+      lines = m_staleLines;
+    } else {
+      for (int line = firstVisible; line <= std::min(lastVisible, lineCount - 1); ++line)
+        lines.push_back(line);
+    }
+    lines.erase(std::remove_if(lines.begin(), lines.end(), [this](int line) { return !m_physicalLines[line].m_stale; }), lines.end());
+    std::sort(lines.begin(), lines.end());
+    lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+  }
+  wrapLines(lines);
+  if (m_staleCount > 0)
+    m_wrapTimer.start();
+  else
+    m_staleLines.clear();
+
+  updateCursorAfterWrap();
+  emit editorLinesChanged();
+}
+
+// Lexes the document again if the syntax changed (or it was just loaded), otherwise has the lexing
+// job relex every edit point until the lexer state converges again
+void Document::relex() {
+  if (m_needReLexing || (m_lexer && m_styleDb.lineCount() == 0)) {
+    ++m_generation; // A running job is relexing results which are going away
+    m_needReLexing = false;
+    m_editedSinceLexing.clear();
+    m_lexingDocument = false;
+    if (!m_lexer) {
+      m_styleDb.clear();
+      return;
+    }
+    // Nothing is lexed, the whole document is an edited region: no lexing converges within it
+    m_styleDb.reset(LexerInput(m_buffer));
+    m_editedSinceLexing.push_back(EditedRegion{0, m_buffer.size()});
+    m_lexingDocument = true;
+    emit linesRestyled(0, static_cast<int>(m_styleDb.lineCount()) - 1);
+    lexVisibleLines();
+    startLexing();
+  } else if (m_lexer) {
+    startLexing();
+  } else {
+    m_editedSinceLexing.clear();
+  }
+}
+
+// Sets up the lexing of an edited region: a copy of the text from the region's resume point to a
+// window past its end (or past its start, for a long one), checkpoints of the previous lexing included
+Document::LexingJob Document::lexingJob(const EditedRegion& region, size_t window) const {
+  LexingJob job;
+  job.type = m_lexer->getLexerType();
+  job.start = m_styleDb.resumePoint(LexerInput(m_buffer), region.offset, region.length);
+  // The copy ends with a line: a checkpoint is only kept if the whole line it's in was lexed
+  const size_t from = m_buffer.lineStart(job.start.line);
+  const size_t windowEnd = std::min(job.start.convergeFrom, region.offset + window) + window;
+  const size_t lastLine = m_buffer.lineAt(std::min(m_buffer.size(), windowEnd));
+  const size_t to = m_buffer.lineStart(lastLine + 1);
+  job.toEnd = (to == m_buffer.size());
+  m_styleDb.copyCheckpoints(job.start.line, lastLine, job.previous);
+  job.text = m_buffer.text(from, to - from);
+  job.start.position -= from;
+  job.start.convergeFrom -= from;
+  return job;
+}
+
+// Runs on any thread: uses nothing but the job
+Document::LexingResult Document::lex(const LexingJob& job) {
+  std::unique_ptr<LexerBase> lexer(LexerBase::createLexerOfType(job.type));
+  LexingResult result;
+  lexer->lex(LexerInput(job.text.data(), job.text.size()), job.start, &job.previous, result.patch);
+  result.complete = job.toEnd || result.patch.endsAtCheckpoint();
+  if (!result.complete)
+    result.progress = result.patch.cutAtLastCheckpoint();
+  return result;
+}
+
+// Applies the result of lexing the first edited region, which is then either done or left to be
+// lexed from where the result ends. Returns false if there's nothing to apply: the window was too
+// short to get past the start of the region
+bool Document::applyLexing(LexingResult& result) {
+  const EditedRegion edit = m_editedSinceLexing.front();
+  size_t resumeAt = 0;
+  if (!result.complete && result.progress)
+    resumeAt = m_buffer.lineStart(result.patch.lastLine()) + result.patch.lastColumn();
+  if (!result.complete && (!result.progress || resumeAt <= edit.offset))
+    return false;
+
+  m_editedSinceLexing.erase(m_editedSinceLexing.begin());
+  if (!result.complete) {
+    // The rest of the region is relexed from the checkpoint the patch ends at, which is the only
+    // one past the region not matching the styles after it: lexing can't converge there
+    const size_t end = std::max(edit.offset + edit.length, resumeAt + 1);
+    addEditedRegion(resumeAt, end - resumeAt, end - resumeAt);
+  } else if (edit.offset + edit.length == m_buffer.size()) {
+    m_lexingDocument = false;
+  }
+  m_styleDb.apply(result.patch);
+  emit linesRestyled(static_cast<int>(m_styleDb.restyledFrom), static_cast<int>(m_styleDb.restyledTo));
+  return true;
+}
+
+// Lexes the lines on screen the lexing of the whole document hasn't got to yet right away. If they're
+// close to where it got, it goes on up to them. Otherwise they're lexed from a guessed state (no
+// scope open) at the first of them, until the job gets to them
+void Document::lexVisibleLines() {
+  if (!m_lexer || m_needReLexing || !m_lexingDocument || m_editedSinceLexing.empty())
+    return;
+  const size_t unlexed = m_editedSinceLexing.back().offset;
+  const size_t lineCount = m_buffer.lineCount();
+  const int firstVisible = std::max(m_firstVisibleLine, 0);
+  const int lastVisible = (m_lastVisibleLine >= firstVisible) ? m_lastVisibleLine : firstVisible + VISIBLE_LINES_GUESS;
+  const size_t first = static_cast<size_t>(firstVisible);
+  const size_t last = std::min(static_cast<size_t>(lastVisible), lineCount - 1);
+  const size_t end = m_buffer.lineStart(last + 1);
+  if (first > last || end <= unlexed)
+    return; // Already lexed
+
+  if (m_editedSinceLexing.size() == 1 && end - unlexed <= LEXING_WINDOW) {
+    ++m_generation; // A running job would lex the same
+    LexingResult result = lex(lexingJob(m_editedSinceLexing.front(), end - unlexed));
+    applyLexing(result);
+    return;
+  }
+  const size_t from = std::max(first, m_buffer.lineAt(unlexed) + 1);
+  if (from > last)
+    return;
+  LexingJob job;
+  job.type = m_lexer->getLexerType();
+  job.start.line = from;
+  job.start.checkpoint.column = 0;
+  // One more line: the patch gets cut at its last checkpoint
+  job.text = m_buffer.text(m_buffer.lineStart(from), m_buffer.lineStart(std::min(last + 2, lineCount)) -
+                                                    m_buffer.lineStart(from));
+  job.start.convergeFrom = job.text.size(); // Never (the copy has no checkpoints anyway)
+  job.toEnd = (last + 2 >= lineCount);
+  LexingResult result = lex(job);
+  if (result.progress) {
+    m_styleDb.apply(result.patch);
+    emit linesRestyled(static_cast<int>(m_styleDb.restyledFrom), static_cast<int>(m_styleDb.restyledTo));
+  }
+}
+
+// Starts a job relexing the first edited region, unless one is running already
+void Document::startLexing() {
+  if (m_lexing || !m_lexer || m_editedSinceLexing.empty())
+    return;
+  LexingJob job = lexingJob(m_editedSinceLexing.front(), m_lexingWindow);
+  m_lexingCopyEnd = job.toEnd ? SIZE_MAX : m_buffer.lineStart(job.start.line) + job.text.size();
+  m_lexing = true;
+  m_lexingGeneration = m_generation;
+  m_lexingWatcher.setFuture(QtConcurrent::run([job = std::move(job)]() {
+    return lex(job);
+  }));
+}
+
+// The lexing job is done: applies its results, unless the document changed in the meantime, and
+// goes on with what is left
+void Document::lexingFinished() {
+  m_lexing = false;
+  if (m_lexingGeneration == m_generation) { // Otherwise the edited regions are up to date, start again
+    LexingResult result = m_lexingWatcher.result();
+    if (applyLexing(result))
+      m_lexingWindow = LEXING_WINDOW;
+    else
+      m_lexingWindow *= 2; // Not a checkpoint past the start of the region, e.g. a long comment
+  }
+  startLexing();
+}
+
+Document::EditorPosition Document::editorPositionAt(size_t offset) const {
+  const int pl = static_cast<int>(m_buffer.lineAt(offset));
+  if (pl >= m_physicalLines.size())
+    return EditorPosition{editorLineCount(), 0};
+  const int ch = static_cast<int>(offset - m_buffer.lineStart(pl));
+  const PhysicalLine& physicalLine = m_physicalLines[pl];
+  int relativeEL = 0;
+  while (relativeEL + 1 < physicalLine.editorLineCount() && ch >= physicalLine.editorLine(relativeEL + 1).m_offset)
+    ++relativeEL;
+  return EditorPosition{m_editorLineIndex.firstEditorLine(pl) + relativeEL,
+                        columnsBetween(pl, physicalLine.editorLine(relativeEL).m_offset, ch)};
+}
+
+size_t Document::offsetAt(int editorLine, int column) const {
+  const int pl = m_editorLineIndex.lineAt(editorLine);
+  if (pl >= m_physicalLines.size())
+    return m_buffer.size();
+  const int relativeEL = editorLine - m_editorLineIndex.firstEditorLine(pl);
+  const EditorLine el = m_physicalLines[pl].editorLine(relativeEL);
+  return m_buffer.lineStart(pl) + offsetAfterColumns(pl, el.m_offset, column, el.m_offset + el.m_length);
+}
+
+// Lines are stored as bytes: they're widened to UTF-16 only when asked for, e.g. to be painted
+QString Document::lineText(int physicalLine) const {
+  const std::string text = m_buffer.lineText(physicalLine);
+  if (lineEncoding(physicalLine) == LineEncoding::Utf8)
+    return QString::fromUtf8(text.data(), static_cast<int>(text.size()));
+  return QString::fromLatin1(text.data(), static_cast<int>(text.size())); // Also fine for ASCII
+}
+
+QString Document::editorLineText(int editorLine) const {
+  const int pl = m_editorLineIndex.lineAt(editorLine);
+  if (pl >= m_physicalLines.size())
+    return QString();
+  const PhysicalLine& physicalLine = m_physicalLines[pl];
+  const EditorLine el = physicalLine.editorLine(editorLine - m_editorLineIndex.firstEditorLine(pl));
+  const std::string text = m_buffer.text(m_buffer.lineStart(pl) + el.m_offset, el.m_length);
+  if (lineEncoding(pl) == LineEncoding::Utf8)
+    return QString::fromUtf8(text.data(), static_cast<int>(text.size()));
+  return QString::fromLatin1(text.data(), static_cast<int>(text.size()));
+}
+
+// The encoding of a line, found again if it was edited since it was last wrapped
+LineEncoding Document::lineEncoding(int line) const {
+  const PhysicalLine& pl = m_physicalLines[line];
+  if (!pl.m_edited)
+    return pl.m_encoding;
+  const std::string text = m_buffer.lineText(line);
+  return detectLineEncoding(text.data(), text.size());
+}
+
+// Characters in [from; to) of a line: every byte is one, unless the line is UTF-8
+int Document::columnsBetween(int line, int from, int to) const {
+  if (to <= from)
+    return 0;
+  if (lineEncoding(line) != LineEncoding::Utf8)
+    return to - from;
+  int columns = 0;
+  m_buffer.forEachChunk(m_buffer.lineStart(line) + from, to - from, [&columns](const PieceTable::Chunk& chunk) {
+    for (size_t i = 0; i < chunk.size; ++i)
+      columns += isCharacterBoundary(chunk.data, i) ? 1 : 0;
+  });
+  return columns;
+}
+
+// Offset in a line 'columns' characters after from (a character boundary), limit at most
+int Document::offsetAfterColumns(int line, int from, int columns, int limit) const {
+  if (columns <= 0 || from >= limit)
+    return std::min(from, limit);
+  if (lineEncoding(line) != LineEncoding::Utf8)
+    return std::min(from + columns, limit);
+  int offset = from;
+  bool found = false;
+  m_buffer.forEachChunk(m_buffer.lineStart(line) + from, limit - from, [&](const PieceTable::Chunk& chunk) {
+    for (size_t i = 0; i < chunk.size && !found; ++i, ++offset) {
+      if (isCharacterBoundary(chunk.data, i) && columns-- == 0)
+        found = true;
+    }
+  });
+  return found ? offset - 1 : limit;
+}
+
+// Characters per editor line at the given wrap width, 0 if lines aren't wrapped
+int Document::wrapColumns(int wrapWidth) const {
+  if (wrapWidth == -1)
+    return 0;
+  int maxChars = static_cast<int>( wrapWidth / m_characterWidthPixels );
+  if (maxChars < 10)
+    maxChars = 10; // Keep it to a minimum
+  return maxChars;
+}
+
+// The text of the line changed, not just the width it's wrapped at
+void Document::markEdited(int line) {
+  m_physicalLines[line].m_edited = true;
+  markStale(line);
+}
+
+void Document::markStale(int line) {
+  PhysicalLine& pl = m_physicalLines[line];
+  if (pl.m_stale)
+    return;
+  pl.m_stale = true;
+  m_staleLines.push_back(line);
+  ++m_staleCount;
+}
+
+// Wraps the given (stale, distinct) lines at the current wrap width, in parallel if there are many
+void Document::wrapLines(const std::vector<int>& lines) {
+  if (lines.empty())
+    return;
+  const int maxChars = wrapColumns(m_wrapWidth);
+
+  // The edited lines get their breaks from a new arena, sized for them: the previous ones might
+  // be freed. A line has fewer breaks than characters
+  int arenaSlot = -1;
+  size_t breakBytes = 0;
+  for (int line : lines) {
+    PhysicalLine& pl = m_physicalLines[line];
+    if (!pl.m_edited)
+      continue;
+    if (arenaSlot < 0)
+      arenaSlot = newLineArena();
+    releaseBreaks(pl);
+    pl.m_arena = arenaSlot;
+    ++m_lineArenas[arenaSlot].lines;
+    const size_t length = m_buffer.lineLength(line);
+    breakBytes += length * ((length > UINT16_MAX) ? sizeof(uint32_t) : sizeof(uint16_t)) + sizeof(uint32_t);
+  }
+  Arena *arena = nullptr;
+  if (arenaSlot >= 0) {
+    m_lineArenas[arenaSlot].arena.reset(new Arena(std::min(breakBytes + LINE_ARENA_SLACK, LINE_ARENA_BLOCK_SIZE)));
+    arena = m_lineArenas[arenaSlot].arena.get();
+  }
+
+  std::function<void (const int&)> wrap = [this, maxChars, arena](const int& lineNumber) {
+    PhysicalLine& pl = m_physicalLines[lineNumber];
+
+    // Every byte is a character (tabs have already been expanded to tabulation markers)
+    const size_t lineStart = m_buffer.lineStart(lineNumber);
+    const int length = static_cast<int>(m_buffer.lineLength(lineNumber));
+    if (pl.m_edited) { // Breaks don't depend on the width: only looked for when the text changes
+      const PieceTable::Chunk chunk = m_buffer.chunkAt(lineStart);
+      std::string lineText;
+      const char *text;
+      if (chunk.offset + chunk.size >= lineStart + length) { // The whole line is in one piece
+        text = chunk.data + (lineStart - chunk.offset);
+      } else {
+        lineText = m_buffer.lineText(lineNumber);
+        text = lineText.data();
+      }
+      pl.m_encoding = detectLineEncoding(text, length);
+      pl.m_breaks.build(text, length, pl.m_encoding, *arena);
+      pl.m_edited = false;
+    }
+    pl.m_length = length;
+    pl.clearBreaks();
+    pl.m_stale = false;
+
+    if (maxChars == 0 || length <= maxChars) // No wrap or the line fits within the wrap limits
+      return;
+    // Break at the last opportunity fitting in an editor line, or brutally split characters if
+    // there's none. No need to do anything special for tabs - they're automatically converted
+    // into spaces
+    auto addBreak = [&pl](int start, int) {
+      if (start > 0)
+        pl.addBreak(start);
+    };
+    if (pl.m_encoding != LineEncoding::Utf8) {
+      pl.m_breaks.wrap(length, maxChars, addBreak);
+      return;
+    }
+    // UTF-8: the width counts characters, the breaks stay byte offsets
+    thread_local std::vector<int> starts; // Offset of every character, then the length
+    starts.clear();
+    m_buffer.forEachChunk(lineStart, length, [lineStart](const PieceTable::Chunk& chunk) {
+      for (size_t i = 0; i < chunk.size; ++i) {
+        if (isCharacterBoundary(chunk.data, i))
+          starts.push_back(static_cast<int>(chunk.offset + i - lineStart));
+      }
+    });
+    starts.push_back(length);
+    if (static_cast<int>(starts.size()) - 1 <= maxChars)
+      return;
+    pl.m_breaks.wrap(length, maxChars, addBreak, [](int offset) {
+      return static_cast<int>(std::lower_bound(starts.begin(), starts.end(), offset) - starts.begin());
+    }, [](int column) {
+      return starts[std::min<size_t>(column, starts.size() - 1)];
+    });
+  };
+
+  // Every line is wrapped in place (the piece table is safe for concurrent reads): no reduce step
+  if (lines.size() >= static_cast<size_t>(PARALLEL_WRAP_LINES))
+    QtConcurrent::blockingMap(lines.begin(), lines.end(), wrap);
+  else
+    std::for_each(lines.begin(), lines.end(), wrap);
+
+  if (static_cast<int>(lines.size()) == m_physicalLines.size()) { // Cheaper to build it again than to update every line
+    std::vector<int> counts;
+    counts.reserve(lines.size());
+    m_physicalLines.forEach(0, m_physicalLines.size(), [&counts](const PhysicalLine& pl) {
+      counts.push_back(pl.editorLineCount());
+    });
+    m_editorLineIndex.build(std::move(counts));
+  } else {
+    for (int line : lines)
+      m_editorLineIndex.set(line, m_physicalLines[line].editorLineCount());
+  }
+  m_numberOfEditorLines = m_editorLineIndex.editorLineCount();
+  m_staleCount -= static_cast<int>(lines.size());
+}
+
+int Document::newLineArena() {
+  int slot;
+  if (!m_freeLineArenas.empty()) {
+    slot = m_freeLineArenas.back();
+    m_freeLineArenas.pop_back();
+  } else {
+    slot = static_cast<int>(m_lineArenas.size());
+    m_lineArenas.emplace_back();
+  }
+  m_lineArenas[slot].lines = 0; // The arena is created once its size is known
+  return slot;
+}
+
+// The line stops using its breaks: their arena is freed if no other line uses it
+void Document::releaseBreaks(PhysicalLine& line) {
+  if (line.m_arena >= 0) {
+    LineArena& lineArena = m_lineArenas[line.m_arena];
+    if (--lineArena.lines == 0) {
+      lineArena.arena.reset();
+      m_freeLineArenas.push_back(line.m_arena);
+    }
+  }
+  line.m_arena = -1;
+  line.m_breaks = LineBreaks();
+}
+
+Arena::Statistics Document::lineArenaStatistics() const {
+  Arena::Statistics total;
+  for (const LineArena& lineArena : m_lineArenas) {
+    if (!lineArena.arena)
+      continue;
+    const Arena::Statistics statistics = lineArena.arena->statistics();
+    total.allocations += statistics.allocations;
+    total.bytesUsed += statistics.bytesUsed;
+    total.bytesReserved += statistics.bytesReserved;
+    total.blocks += statistics.blocks;
+  }
+  return total;
+}
+
+// Wraps stale lines in batches for a few milliseconds, then lets the event loop run
+void Document::wrapSlice() {
+  QElapsedTimer timer;
+  timer.start();
+  std::vector<int> batch;
+  size_t next = 0;
+  while (next < m_staleLines.size() && timer.nsecsElapsed() < WRAP_SLICE_BUDGET_NS) {
+    batch.clear();
+    for (; next < m_staleLines.size() && batch.size() < WRAP_BATCH_LINES; ++next) {
+      const int line = m_staleLines[next];
+      if (m_physicalLines[line].m_stale)
+        batch.push_back(line);
+    }
+    std::sort(batch.begin(), batch.end());
+    batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+    wrapLines(batch);
+  }
+  m_staleLines.erase(m_staleLines.begin(), m_staleLines.begin() + next);
+  if (!m_staleLines.empty())
+    m_wrapTimer.start();
+
+  updateCursorAfterWrap();
+  emit editorLinesChanged();
+}
+
+// Update the cursor position according to the new wrapping
+// Invariant: m_documentCursorPos.pl and m_documentCursorPos.ch shouldn't change here. The Els might change.
+void Document::updateCursorAfterWrap() {
+  if(!m_buffer.isEmpty() && m_documentCursorPos.pl < m_physicalLines.size()) {
+    int countPL = m_documentCursorPos.pl;
+    int countEL = m_editorLineIndex.firstEditorLine(countPL);
+
+    // Find the EL where the character requested is now stored
+    const PhysicalLine& physicalLine = m_physicalLines[countPL];
+    int ELrelativeCH = 0; // Character position relative to the beginning of the EL
+    int relativeEL = 0; // EL inside this PL till the cursor position
+    for(int i = 0; i < physicalLine.editorLineCount(); ++i) {
+      const EditorLine el = physicalLine.editorLine(relativeEL);
+      // >, because being equal (caret blinking at the end of the line) also works
+      if (m_documentCursorPos.ch > el.m_offset + el.m_length) {
+        // Explore another EL inside this PL
+        ++relativeEL;
+      } else {
+        // Found the EL where the cursor position was before the wrap
+        ELrelativeCH = columnsBetween(countPL, el.m_offset, m_documentCursorPos.ch);
+        break;
+      }
+    }
+    countEL += relativeEL;
+
+
+    m_documentCursorPos.el = countEL;
+    m_documentCursorPos.relativeEl = relativeEL;
+    m_documentCursorPos.relativeCh = ELrelativeCH;
+
+    // Set the correct position within the viewport
+    m_viewportCursorPos.y = countEL;
+    m_viewportCursorPos.x = ELrelativeCH;
+  }
+}
+
+void Document::setCursorPos(int x, int y) {
+  // This code needs to find, given a position into the document, a valid point where to set
+  // the caret at
+
+  if (m_buffer.isEmpty() || m_physicalLines.isEmpty()) {
+
+    // Empty doc
+    m_viewportCursorPos.y = 0;
+    m_viewportCursorPos.x = 0;
+
+    m_documentCursorPos.pl = 0;
+    m_documentCursorPos.el = 0;
+    m_documentCursorPos.relativeEl = 0;
+    m_documentCursorPos.ch = 0;
+    m_documentCursorPos.relativeCh = 0;
+
+    return;
+  }
+
+  // Find the editorLine this position corresponds to
+  const PhysicalLine *pl = nullptr;
+  int currentPL = m_editorLineIndex.lineAt(std::max(y, 0));
+  int currentEL = m_editorLineIndex.firstEditorLine(currentPL);
+  int relativeEL = 0;
+  if (currentPL < m_physicalLines.size()) {
+    // We'll arrive at the requested EL in this PL
+    relativeEL = std::max(y, 0) - currentEL;
+    pl = &m_physicalLines[currentPL];
+  }
+
+  if (!pl) {
+    --currentPL; // Past the end: the last PL (and EL)
+    --currentEL;
+    // Cannot validate or out of the document, set it to the last possible position
+    m_viewportCursorPos.y = currentEL;
+    const PhysicalLine& last = m_physicalLines[currentPL];
+    const EditorLine lastEL = last.editorLine(last.editorLineCount() - 1);
+    m_viewportCursorPos.x = columnsBetween(currentPL, lastEL.m_offset, lastEL.m_offset + lastEL.m_length);
+
+    m_documentCursorPos.pl = currentPL;
+    m_documentCursorPos.el = currentEL;
+    m_documentCursorPos.relativeEl = last.editorLineCount() - 1;
+
+    // The ch count from the beginning of the Pl is the whole line
+    m_documentCursorPos.ch = last.m_length;
+
+    m_documentCursorPos.relativeCh = m_viewportCursorPos.x;
+    return;
+  }
+
+  // We found a valid EL, y is fine
+  m_viewportCursorPos.y = y;
+
+  // x counts characters: find where each of them starts in the EL (every byte is one, unless the
+  // line is UTF-8)
+  const EditorLine el = pl->editorLine(relativeEL);
+  const std::string elText = m_buffer.text(m_buffer.lineStart(currentPL) + el.m_offset, el.m_length);
+  const bool utf8 = lineEncoding(currentPL) == LineEncoding::Utf8;
+  std::vector<int> starts;
+  for (int i = 0; i < el.m_length; ++i) {
+    if (!utf8 || isCharacterBoundary(elText.data(), i))
+      starts.push_back(i);
+  }
+  const int columns = static_cast<int>(starts.size());
+  starts.push_back(el.m_length);
+  auto vec = [&elText, &starts](int column) { return elText[starts[column]]; };
+
+  // If the X coordinate is longer than the EL line itself, grab the minimum and drop the EOLs
+  int newXCoord = x;
+  int EOLs = 0;
+  if (columns >= 1 && vec(columns - 1) == '\n') {
+    ++EOLs;
+    if (columns >= 2 && vec(columns - 2) == '\r')
+      ++EOLs;
+  }
+  if (x < 0 || x >= columns - EOLs)
+    newXCoord = columns - EOLs; // Put the caret before the EOLs if we clicked where the EL can't reach
+  else {
+    // Into the EL, mind the tab-adjustment if we're right into one
+    if (vec(x) == 0x07) {
+      // Find the first tab of the series
+      int first = x;
+      while(first >= 0 && vec(first) == 0x07)
+        --first;
+      ++first;
+      // Find the last tab of the series
+      int last = x;
+      while(last < columns && vec(last) == 0x07)
+        ++last;
+      --last;
+
+      int index = x - first; // index into the sequence
+
+      // |_|_|_|_|  |_|_|_|_|
+      //  ^ ^ * *
+      //  | |
+      //  these indices / 4 have decimal part less than 0.5 therefore the caret
+      //  should be aligned to first + (int)(index/4)*4
+      //  Similar reasoning for the last two (*)
+      float res = index / 4.f;
+      if (res < .5f)
+        newXCoord = first + (int)(index / 4) * 4;
+      else
+        newXCoord = first + (int)(index / 4 + 1) * 4;
+    }
+  }
+
+  // This is the position the user will see on the viewport grid
+  m_viewportCursorPos.x = newXCoord;
+
+  // Now calculate the internal position in the document (tabs and newlines will mess this up)
+  m_documentCursorPos.pl = currentPL;
+  m_documentCursorPos.el = currentEL;
+  m_documentCursorPos.relativeEl = relativeEL;
+  m_documentCursorPos.ch = el.m_offset + starts[newXCoord];
+  m_documentCursorPos.relativeCh = newXCoord;
+}
+
+// Document offset of the caret
+size_t Document::cursorOffset() const {
+  if (m_buffer.isEmpty())
+    return 0;
+  return m_buffer.lineStart(m_documentCursorPos.pl) + m_documentCursorPos.ch;
+}
+
+// Sets the caret before the character at the given document offset
+void Document::setCursorOffset(size_t offset) {
+  if (m_buffer.isEmpty() || m_physicalLines.isEmpty()) {
+    setCursorPos(0, 0);
+    return;
+  }
+  offset = std::min(offset, m_buffer.size());
+  m_documentCursorPos.pl = static_cast<int>(m_buffer.lineAt(offset));
+  m_documentCursorPos.ch = static_cast<int>(offset - m_buffer.lineStart(m_documentCursorPos.pl));
+  updateCursorAfterWrap();
+}
+
+// The caret moves by characters: a tab (its tabulation markers), a \r\n pair or a UTF-8 sequence
+// are a single one
+size_t Document::previousCharacter(size_t offset) const {
+  if (offset == 0)
+    return 0;
+  size_t previous = offset - 1;
+  const char c = m_buffer.at(previous);
+  if (c == 0x07)
+    return (offset >= 4) ? offset - 4 : 0;
+  if (c == '\n')
+    return (previous > 0 && m_buffer.at(previous - 1) == '\r') ? previous - 1 : previous;
+  if (lineEncoding(static_cast<int>(m_buffer.lineAt(previous))) == LineEncoding::Utf8) {
+    while (previous > 0 && (static_cast<unsigned char>(m_buffer.at(previous)) & 0xC0) == 0x80)
+      --previous;
+  }
+  return previous;
+}
+
+size_t Document::nextCharacter(size_t offset) const {
+  const size_t size = m_buffer.size();
+  if (offset >= size)
+    return size;
+  const char c = m_buffer.at(offset);
+  if (c == 0x07)
+    return std::min(offset + 4, size);
+  if (c == '\r' && offset + 1 < size && m_buffer.at(offset + 1) == '\n')
+    return offset + 2;
+  size_t next = offset + 1;
+  if (lineEncoding(static_cast<int>(m_buffer.lineAt(offset))) == LineEncoding::Utf8) {
+    while (next < size && (static_cast<unsigned char>(m_buffer.at(next)) & 0xC0) == 0x80)
+      ++next;
+  }
+  return next;
+}
+
+void Document::moveCursorLeft() {
+  setCursorOffset(previousCharacter(cursorOffset()));
+}
+
+void Document::moveCursorRight() {
+  setCursorOffset(nextCharacter(cursorOffset()));
+}
+
+// Letters, digits, '_' and any non ASCII character make words
+bool Document::isWordCharacter(size_t offset) const {
+  const unsigned char c = static_cast<unsigned char>(m_buffer.at(offset));
+  return std::isalnum(c) || c == '_' || c > 0x7F;
+}
+
+// To the start of the word before the caret (or of the one it's in)
+void Document::moveCursorWordLeft() {
+  size_t offset = cursorOffset();
+  while (offset > 0 && !isWordCharacter(offset - 1) && m_buffer.at(offset - 1) != '\n')
+    --offset;
+  if (offset > 0 && m_buffer.at(offset - 1) == '\n' && offset == cursorOffset())
+    --offset; // At the start of a line: to the end of the previous one
+  while (offset > 0 && isWordCharacter(offset - 1))
+    --offset;
+  setCursorOffset(offset);
+}
+
+// To the end of the word after the caret (or of the one it's in)
+void Document::moveCursorWordRight() {
+  const size_t size = m_buffer.size();
+  size_t offset = cursorOffset();
+  while (offset < size && !isWordCharacter(offset) && m_buffer.at(offset) != '\n')
+    ++offset;
+  if (offset < size && m_buffer.at(offset) == '\n' && offset == cursorOffset())
+    ++offset; // At the end of a line: to the start of the next one
+  while (offset < size && isWordCharacter(offset))
+    ++offset;
+  setCursorOffset(offset);
+}
+
+bool Document::hasSelection() const {
+  return m_selecting && m_selectionAnchor != cursorOffset();
+}
+
+size_t Document::selectionStart() const {
+  return hasSelection() ? std::min(m_selectionAnchor, cursorOffset()) : cursorOffset();
+}
+
+size_t Document::selectionEnd() const {
+  return hasSelection() ? std::max(m_selectionAnchor, cursorOffset()) : cursorOffset();
+}
+
+void Document::setSelectionAnchor(size_t offset) {
+  m_selecting = true;
+  m_selectionAnchor = std::min(offset, m_buffer.size());
+}
+
+void Document::clearSelection() {
+  m_selecting = false;
+}
+
+void Document::selectAll() {
+  setSelectionAnchor(0);
+  setCursorOffset(m_buffer.size());
+}
+
+void Document::selectWordAt(size_t offset) {
+  size_t from = std::min(offset, m_buffer.size()), to = from;
+  while (from > 0 && isWordCharacter(from - 1))
+    --from;
+  while (to < m_buffer.size() && isWordCharacter(to))
+    ++to;
+  setSelectionAnchor(from);
+  setCursorOffset(to);
+}
+
+// Decoded a line at a time (lines have encodings of their own), tabulation markers back to tabs
+QString Document::text(size_t from, size_t to) const {
+  QString text;
+  to = std::min(to, m_buffer.size());
+  for (size_t offset = from; offset < to;) {
+    const int line = static_cast<int>(m_buffer.lineAt(offset));
+    const size_t end = std::min(static_cast<size_t>(m_buffer.lineStart(line + 1)), to);
+    std::string bytes = m_buffer.text(offset, end - offset);
+    std::string::size_type marker;
+    while ((marker = bytes.find("\x07\x07\x07\x07")) != std::string::npos)
+      bytes.replace(marker, 4, 1, '\t');
+    if (line < m_physicalLines.size() && lineEncoding(line) == LineEncoding::Utf8)
+      text += QString::fromUtf8(bytes.data(), static_cast<int>(bytes.size()));
+    else
+      text += QString::fromLatin1(bytes.data(), static_cast<int>(bytes.size()));
+    offset = end;
+  }
+  return text;
+}
+
+// A user action starts: its edits go to a new undo step, unless it's typing right where the last
+// characters typed were
+void Document::beginUndoStep(bool typing) {
+  const size_t cursor = cursorOffset();
+  const bool merge = typing && m_undoMergeable && !hasSelection() && m_undoSteps.back().cursorAfter == cursor &&
+                     static_cast<int>(m_undoSteps.size()) != m_unmodifiedSteps;
+  if (!merge) {
+    if (m_unmodifiedSteps > static_cast<int>(m_undoSteps.size()))
+      m_unmodifiedSteps = -1; // The unmodified document was in the redo steps
+    m_undoSteps.push_back(UndoStep{{}, cursor, cursor});
+  }
+  m_redoSteps.clear();
+  m_recordingUndo = true;
+}
+
+void Document::endUndoStep(bool typing) {
+  m_recordingUndo = false;
+  UndoStep& step = m_undoSteps.back();
+  step.cursorAfter = cursorOffset();
+  m_undoMergeable = typing && !step.edits.empty();
+  if (step.edits.empty())
+    m_undoSteps.pop_back(); // Nothing was edited
+}
+
+void Document::undo() {
+  if (m_undoSteps.empty())
+    return;
+  UndoStep step = std::move(m_undoSteps.back());
+  m_undoSteps.pop_back();
+  for (auto edit = step.edits.rbegin(); edit != step.edits.rend(); ++edit)
+    replaceText(edit->offset, edit->offset + edit->added.size(), edit->removed);
+  clearSelection();
+  setCursorOffset(step.cursorBefore);
+  m_redoSteps.push_back(std::move(step));
+  m_undoMergeable = false;
+}
+
+void Document::redo() {
+  if (m_redoSteps.empty())
+    return;
+  UndoStep step = std::move(m_redoSteps.back());
+  m_redoSteps.pop_back();
+  for (const UndoEdit& edit : step.edits)
+    replaceText(edit.offset, edit.offset + edit.removed.size(), edit.added);
+  clearSelection();
+  setCursorOffset(step.cursorAfter);
+  m_undoSteps.push_back(std::move(step));
+  m_undoMergeable = false;
+}
+
+void Document::setModified(bool modified) {
+  m_unmodifiedSteps = modified ? -1 : static_cast<int>(m_undoSteps.size());
+  m_undoMergeable = false;
+}
+
+void Document::typeNewlineAtCursor() {
+  // The rest of the physical line becomes a new one
+  typeAtCursor(QStringLiteral("\n"));
+}
+
+void Document::typeAtCursor(QString keyStr) {
+
+  if (keyStr.isEmpty())
+    return; // Nothing to be done (unrecognized keystroke?)
+
+  // Line endings are stored as '\n' (see FileText)
+  keyStr.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+  keyStr.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+  const bool typing = !keyStr.contains(QLatin1Char('\n')) && keyStr.size() <= 4; // A character, or a tab
+  beginUndoStep(typing);
+  eraseSelectedText();
+
+  // Add text at the current caret position, encoded as the rest of the line: UTF-8, unless the
+  // line is Latin-1 and stays so with the new characters
+  const int pl = m_documentCursorPos.pl;
+  QByteArray text = keyStr.toUtf8();
+  if (pl < m_physicalLines.size() && lineEncoding(pl) == LineEncoding::Latin1) {
+    const QByteArray latin1 = keyStr.toLatin1();
+    std::string line = m_buffer.lineText(pl);
+    line.insert(static_cast<size_t>(m_documentCursorPos.ch), latin1.constData(), static_cast<size_t>(latin1.size()));
+    const bool representable = std::all_of(keyStr.begin(), keyStr.end(), [](QChar c) { return c.unicode() <= 0xFF; });
+    if (representable && detectLineEncoding(line.data(), line.size()) == LineEncoding::Latin1)
+      text = latin1;
+    else
+      reencodeLineAsUtf8(pl);
+  }
+  text.replace('\t', QByteArray(4, 0x07)); // Tabulation markers (see FileText)
+  const size_t offset = cursorOffset();
+  replaceText(offset, offset, std::string(text.constData(), static_cast<size_t>(text.size())));
+
+  // Advance the caret past the inserted characters
+  setCursorOffset(offset + static_cast<size_t>(text.size()));
+  endUndoStep(typing);
+}
+
+// Rewrites a Latin-1 line as UTF-8 (e.g. before typing a character Latin-1 can't represent),
+// keeping the caret on the same character
+void Document::reencodeLineAsUtf8(int line) {
+  const size_t start = m_buffer.lineStart(line);
+  const std::string latin1 = m_buffer.lineText(line);
+  const QByteArray utf8 = QString::fromLatin1(latin1.data(), static_cast<int>(latin1.size())).toUtf8();
+  replaceText(start, start + latin1.size(), std::string(utf8.constData(), static_cast<size_t>(utf8.size())));
+  if (line == m_documentCursorPos.pl) { // Every byte past 0x7F now takes two
+    m_documentCursorPos.ch += static_cast<int>(std::count_if(latin1.begin(), latin1.begin() + m_documentCursorPos.ch,
+                                                             [](char c) { return static_cast<unsigned char>(c) > 0x7F; }));
+  }
+}
+
+void Document::eraseBeforeCursor() {
+  beginUndoStep(false);
+  if (!eraseSelectedText()) {
+    const size_t offset = cursorOffset();
+    eraseText(previousCharacter(offset), offset);
+  }
+  endUndoStep(false);
+}
+
+void Document::eraseAfterCursor() {
+  beginUndoStep(false);
+  if (!eraseSelectedText()) {
+    const size_t offset = cursorOffset();
+    eraseText(offset, nextCharacter(offset));
+  }
+  endUndoStep(false);
+}
+
+void Document::eraseSelection() {
+  beginUndoStep(false);
+  eraseSelectedText();
+  endUndoStep(false);
+}
+
+// Returns false if there was no selection
+bool Document::eraseSelectedText() {
+  const bool selection = hasSelection();
+  if (selection)
+    eraseText(selectionStart(), selectionEnd());
+  clearSelection();
+  return selection;
+}
+
+// Removes [from; to) from the document (joining lines if a newline is removed), the caret ends up
+// where the text was
+void Document::eraseText(size_t from, size_t to) {
+  if (from >= to)
+    return;
+  replaceText(from, to, std::string());
+  setCursorOffset(from);
+}
+
+// Every edit goes through here: [from; to) is replaced with text (in the encoding of its line,
+// newlines included) and recorded in the undo step being made, if any. The caret doesn't move
+void Document::replaceText(size_t from, size_t to, const std::string& text) {
+  if (from >= to && text.empty())
+    return;
+  const int first = static_cast<int>(m_buffer.lineAt(from));
+  const int last = static_cast<int>(m_buffer.lineAt(to));
+  std::string removed = m_buffer.text(from, to - from);
+  if (to > from)
+    m_buffer.remove(from, to - from);
+  if (!text.empty())
+    m_buffer.insert(from, text.data(), text.size());
+  noteEdit(from, to - from, text.size());
+  if (m_recordingUndo)
+    m_undoSteps.back().edits.push_back(UndoEdit{from, std::move(removed), text});
+  replaceLines(first, last - first + 1, 1 + static_cast<int>(std::count(text.begin(), text.end(), '\n')));
+}
+
+// Physical lines [first; first + removed) have just been replaced by 'added' lines in the buffer.
+// The lines after them keep their wrapping (they're just renumbered), the new ones get wrapped
+// right away and the edit is lexed
+void Document::replaceLines(int first, int removed, int added) {
+  const int oldCount = m_physicalLines.size();
+  const int lineCount = m_buffer.isEmpty() ? 0 : static_cast<int>(m_buffer.lineCount());
+  if (oldCount - removed + added != lineCount) { // E.g. the first character typed in an empty document
+    m_physicalLines.clear();
+    m_editorLineIndex.build({});
+    m_numberOfEditorLines = 0;
+    m_staleLines.clear();
+    m_staleCount = 0;
+    recalculateDocumentLines();
+    emit linesChanged(0, oldCount, lineCount);
+    return;
+  }
+
+  const int kept = std::min(removed, added);
+  for (int line = first; line < first + kept; ++line)
+    markEdited(line);
+  if (removed > added) {
+    for (int i = added; i < removed; ++i) { // The next line to go is always at first + added
+      PhysicalLine& gone = m_physicalLines[first + added];
+      if (gone.m_stale)
+        --m_staleCount;
+      releaseBreaks(gone);
+      m_physicalLines.erase(first + added);
+      m_editorLineIndex.remove(first + added);
+    }
+  } else if (added > removed) {
+    for (int line = first + removed; line < first + added; ++line) {
+      m_physicalLines.insert(line, PhysicalLine());
+      m_editorLineIndex.insert(line, 0);
+    }
+    m_staleCount += added - removed; // New lines are stale
+  }
+  if (removed != added) {
+    auto gone = std::remove_if(m_staleLines.begin(), m_staleLines.end(), [=](int line) {
+      return line >= first + kept && line < first + removed;
+    });
+    m_staleLines.erase(gone, m_staleLines.end());
+    for (int& line : m_staleLines) {
+      if (line >= first + removed)
+        line += added - removed;
+    }
+  }
+
+  std::vector<int> lines(added);
+  std::iota(lines.begin(), lines.end(), first);
+  if (added > SYNC_WRAP_LINES) { // E.g. a large paste: only the lines on screen are wrapped right away
+    m_staleLines.insert(m_staleLines.end(), lines.begin(), lines.end());
+    auto offScreen = std::remove_if(lines.begin(), lines.end(), [this](int line) {
+      return line < m_firstVisibleLine || line > std::max(m_lastVisibleLine, m_firstVisibleLine + VISIBLE_LINES_GUESS);
+    });
+    lines.erase(offScreen, lines.end());
+    m_wrapTimer.start();
+  }
+  wrapLines(lines);
+  emit linesChanged(first, removed, added);
+  relex();
+}
+
+void Document::lineStyles(int physicalLine, std::vector<StyleRun>& runs) const {
+  runs.clear();
+  if (physicalLine < m_physicalLines.size())
+    styleRuns(physicalLine, 0, static_cast<int>(m_buffer.lineLength(physicalLine)), runs);
+}
+
+void Document::editorLineStyles(int editorLine, std::vector<StyleRun>& runs) const {
+  runs.clear();
+  const int pl = m_editorLineIndex.lineAt(editorLine);
+  if (pl < m_physicalLines.size()) {
+    const EditorLine el = m_physicalLines[pl].editorLine(editorLine - m_editorLineIndex.firstEditorLine(pl));
+    styleRuns(pl, el.m_offset, el.m_length, runs);
+  }
+}
+
+// Style runs of [offset; offset + length) of a physical line, clipped to it. Runs are found in bytes
+// and returned in UTF-16 code units of the text of that range
+void Document::styleRuns(int line, int offset, int length, std::vector<StyleRun>& runs) const {
+  if (static_cast<size_t>(line) >= m_styleDb.lineCount())
+    return;
+  const StyleDatabase::Line& lexed = m_styleDb.line(static_cast<size_t>(line));
+  if (lexed.runCount == 0)
+    return;
+
+  thread_local std::vector<int> units; // UTF-16 code units before every byte of a UTF-8 line
+  const bool utf8 = lineEncoding(line) == LineEncoding::Utf8;
+  if (utf8) {
+    const std::string text = m_buffer.text(m_buffer.lineStart(line) + offset, length);
+    units.assign(1, 0);
+    for (unsigned char c : text)
+      units.push_back(units.back() + (((c & 0xC0) == 0x80) ? 0 : (c >= 0xF0) ? 2 : 1));
+  }
+  auto unitsBefore = [&](int position) { return utf8 ? units[position] : position; };
+
+  for (const LexerRun *run = lexed.runs; run < lexed.runs + lexed.runCount; ++run) {
+    const int start = std::max(static_cast<int>(run->start), offset);
+    const int end = std::min(static_cast<int>(run->start + run->length), offset + length);
+    if (start >= end)
+      continue;
+    const int from = unitsBefore(start - offset);
+    runs.push_back(StyleRun{from, unitsBefore(end - offset) - from, static_cast<Style>(run->style)});
+  }
+}
+
+// Records an edit (replacing 'removed' characters at 'offset' with 'added' new ones) to be relexed.
+// The style database follows the edit right away, moving only the styles of the lines it spans
+void Document::noteEdit(size_t offset, size_t removed, size_t added) {
+  if (!m_lexing || offset < m_lexingCopyEnd)
+    ++m_generation;
+  if (!m_lexer || m_needReLexing || m_styleDb.lineCount() == 0)
+    return; // Everything is going to be lexed anyway
+  m_styleDb.applyEdit(LexerInput(m_buffer), offset, removed, added);
+  addEditedRegion(offset, removed, added);
+}
+
+// Adds an edited region, merging it with the ones it touches and shifting the ones after it (an
+// edit with removed == added marks text to be relexed without changing it)
+void Document::addEditedRegion(size_t offset, size_t removed, size_t added) {
+  EditedRegion edit{offset, added};
+  bool placed = false;
+  std::vector<EditedRegion> regions;
+  regions.reserve(m_editedSinceLexing.size() + 1);
+  for (const EditedRegion& region : m_editedSinceLexing) {
+    if (region.offset + region.length < offset) {
+      regions.push_back(region);
+    } else if (region.offset > offset + removed) { // Shifted by the edit
+      if (!placed)
+        regions.push_back(edit);
+      placed = true;
+      regions.push_back(EditedRegion{region.offset + added - removed, region.length});
+    } else { // Touches the edit: [start; end) before it becomes [start; end + added - removed)
+      const size_t start = std::min(edit.offset, region.offset);
+      const size_t end = std::max(offset + removed, region.offset + region.length);
+      edit = EditedRegion{start, end + added - removed - start};
+    }
+  }
+  if (!placed)
+    regions.push_back(edit);
+  m_editedSinceLexing.swap(regions);
+}
+
+/*
+ *
+ * The class Document represents a grid for a text file
+ *
+ * It provides a vector of PhysicalLine objects (the physical ones) that can include one or more multiple
+ * EditorLine objects (the fake ones due to wrap). A PhysicalLine has two values: an int beginValue (i.e. the
+ * starting pixel line where the line begins to be rendered in a virtual document) and an int endValue (after
+ * all the EditorLines have been rendered). fontMetrics() and m_wrapWidth are the values necessary to calculate
+ * this grid.
+ *
+ * document_is_loaded()
+ *  1) From its extension (e.g. cpp) a Lexer is chosen (or no lexer at all). If chosen it is lexed.
+ *
+ *  2) PhysicalLine objects are created, each one with ONE or MORE EditorLine. An EditorLine contains a list of words
+ *     and their associated style (bold/italic/color/etc..) due to how the Lexer interpreted this.
+ *
+ *  3) PhysicalLine objects also have a beginValue and endValue (to facilitate queries when something is clicked inside
+ *     the rendered region). After a click was received, a search for the character (or no-character in the line) is issued
+ *     so the Document must have something like
+ *       clickOnPoint(Point, hint LinesFrom, hint LinesTo (these hints are given since the viewport displays only a few lines) ->
+ *         return the new click position
+ *       doubleClickOnPoint (..) -> return the start-end positions for a selection (or a list of words in the entire document for
+ *                                  similar selections)
+ *       startDragSelection ().. etc.
+ *
+ *
+ */
 
-//      // No need to do anything special for tabs - they're automatically converted into spaces
-
-//      std::vector<EditorLine> edVector;
-//      std::copy( edLines.begin(), edLines.end(), std::back_inserter(edVector) );
-//      phLineVec.resize(1);
-//      phLineVec[0].m_editorLines = std::move(edVector);
-
-//    } else { // No wrap or the line fits perfectly within the wrap limits
-
-//      EditorLine el(line);
-//      phLineVec.emplace_back( std::move(el) );
-//    }
-//    return phLineVec;
-//  };
-
-
-//  std::function<void (std::vector<PhysicalLine>&, const std::vector<PhysicalLine>&)> reduceFn =
-//      [&,this](std::vector<PhysicalLine>& accumulator, const std::vector<PhysicalLine>& pl) {
-
-//    accumulator.insert(accumulator.end(), pl.begin(), pl.end());
-
-//    m_numberOfEditorLines += static_cast<int>(pl[0].m_editorLines.size()); // Some more EditorLine
-////    std::for_each(pl[0].m_editorLines.begin(), pl[0].m_editorLines.end(), [this](const EditorLine& eline) {
-////      int lineLength = static_cast<int>(eline.m_characters.size());
-////      if (lineLength > m_maximumCharactersLine) // Check if this is the longest line found ever
-////        m_maximumCharactersLine = lineLength;
-////    });
-
-//  };
-
-//  // >> Launch the workload <<
-//  m_physicalLines =
-//      QtConcurrent::blockingMappedReduced<std::vector<PhysicalLine>>(m_plainTextLines.begin(), m_plainTextLines.end(),
-//                                                                     mapFn, reduceFn, QtConcurrent::SequentialReduce );
-
-
-//  // Update the cursor position according to the new wrapping
-//  // Invariant: m_documentCursorPos.pl and m_documentCursorPos.ch shouldn't change here. The Els might change.
-//  if(!m_plainTextLines.empty()) {
-//    int countPL = 0;
-//    int countEL = 0;
-//    for(auto& pl : m_physicalLines) {
-//      if (m_documentCursorPos.pl == countPL)
-//        break;
-//      countEL += (int)pl.m_editorLines.size();
-//      ++countPL;
-//    }
-
-//    Q_ASSERT (countPL < m_physicalLines.size()); // Should never be fired
-
-//    // Find the EL where the character requested is now stored
-//    int countCH = 0;
-//    int ELrelativeCH = 0; // Character position relative to the beginning of the EL
-//    int relativeEL = 0; // EL inside this PL till the cursor position
-//    for(int i = 0; i < m_physicalLines[countPL].m_editorLines.size(); ++i) {
-//      // >, because being equal (caret blinking at the end of the line) also works
-//      if (m_documentCursorPos.ch > countCH + m_physicalLines[countPL].m_editorLines[relativeEL].m_characters.size()) {
-//        // Explore another EL inside this PL
-//        countCH += (int)m_physicalLines[countPL].m_editorLines[relativeEL].m_characters.size();
-//        ++relativeEL;
-//      } else {
-//        // Found the EL where the cursor position was before the wrap
-//        ELrelativeCH = m_documentCursorPos.ch - countCH;
-//        break;
-//      }
-//    }
-//    countEL += relativeEL;
-
-
-//    m_documentCursorPos.el = countEL;
-//    m_documentCursorPos.relativeEl = relativeEL;
-//    m_documentCursorPos.relativeCh = ELrelativeCH;
-
-//    // Set the correct position within the viewport
-//    m_viewportCursorPos.y = countEL;
-//    m_viewportCursorPos.x = ELrelativeCH;
-//  }
-
-
-////qDebug() << "done";
-
-
-
-////qDebug() << "Done recalculating document lines in " << timer.elapsed() << " milliseconds";
-
-
-
-
-
-
-
-////  // Drop previous lines
-////  m_physicalLines.clear();
-////  m_numberOfEditorLines = 0;
-////  m_maximumCharactersLine = 0;
-////  // Reset temporary buffers
-////  std::vector<EditorLine> edLines;
-////  QString restOfLine;
-////  edLines.reserve(10); // Should be enough for every splitting
-
-////  // Scan each line (until a newline is found)
-////  QString m_plainText;
-////  for(auto& line : m_plainTextLines) { // Expensive, hopefully this doesn't happen too often - LEX DIRECTLY FROM VECTOR
-////    m_plainText.append(line);
-////    m_plainText += '\n';
-////  }
-////  QTextStream ss(&m_plainText);
-////  QString line;
-////  do {
-////    line = ss.readLine();
-////    if (line.isNull())
-////      continue;
-
-////    if (m_wrapWidth != -1 && // Also check if the monospace'd width isn't exceeding the viewport
-////        line.count() * m_codeTextEdit.getCharacterWidthPixels() > m_wrapWidth) {
-////      // We have a wrap and the line is too big - WRAP IT
-
-////      edLines.clear();
-////      restOfLine = line;
-
-////      // Calculate the allowed number of characters per editor line
-////      int maxChars = static_cast<int>( m_wrapWidth / m_codeTextEdit.getCharacterWidthPixels() );
-////      if (maxChars < 10)
-////        maxChars = 10; // Keep it to a minimum
-
-////      // Start the wrap-splitting algorithm or resort to a brute-force character splitting one if
-////      // no suitable spaces could be found to split the line
-////      while(restOfLine.size() > maxChars) {
-
-////        int bestSplittingPointFound = -1;
-////        for(int i = 0; i < restOfLine.count(); ++i) {
-////          if (i > maxChars)
-////            break; // We couldn't find a suitable space split point for restOfLine
-////          if ( restOfLine[i] == ' ' && i != 0 /* Doesn't make sense to split at 0 pos */)
-////            bestSplittingPointFound = i;
-////        }
-
-////        if (bestSplittingPointFound != -1) { // We found a suitable space point to split this line
-////          edLines.push_back( restOfLine.left( bestSplittingPointFound ));
-////          restOfLine = restOfLine.right( restOfLine.size() - bestSplittingPointFound );
-////        } else {
-////          // No space found, brutally split characters
-////          edLines.push_back( restOfLine.left( maxChars ));
-////          restOfLine = restOfLine.right( restOfLine.size() - maxChars );
-////          qDebug() << "BRUTAL SPLIT" << bestSplittingPointFound;
-////        }
-////      }
-////      edLines.push_back( restOfLine ); // Insert the last part and proceed
-
-////      for(auto& ll : edLines)
-////        if (ll.m_characters.size() > m_maximumCharactersLine) // Update if this is the longest line ever found
-////          m_maximumCharactersLine = static_cast<int>(ll.m_characters.size());
-
-////      // No need to do anything special for tabs - they're automatically converted into spaces
-////      PhysicalLine phLine;
-////      std::vector<EditorLine> edVector;
-////      std::copy( edLines.begin(), edLines.end(), std::back_inserter(edVector) );
-////      phLine.m_editorLines = std::move(edVector);
-////      m_physicalLines.emplace_back( std::move(phLine) );
-
-////      m_numberOfEditorLines += static_cast<int>(edLines.size()); // Some more EditorLine
-
-////    } else { // No wrap or the line fits perfectly within the wrap limits
-
-////      EditorLine el(line);
-////      PhysicalLine phLine(std::move(el));
-////      m_physicalLines.emplace_back( std::move(phLine) );
-
-////      ++m_numberOfEditorLines; // One more EditorLine
-////      if (line.size() > m_maximumCharactersLine) // Check if this is the longest line found ever
-////        m_maximumCharactersLine = line.size();
-////    }
-
-////  } while(line.isNull() == false);
-
-////  qDebug() << "done";
-
-//  // At this point the PhysicalLines vector has been populated (or is still empty)
-//  // and the document structure is stored in memory
-
-//  //qDebug() << "Done recalculating document lines in " << timer.elapsed() << " milliseconds";
-//}
-
-//void Document::setCursorPos(int x, int y) {
-//  // This code needs to find, given a position into the document, a valid point where to set
-//  // the caret at
-
-//  if (m_plainTextLines.empty()) {
-
-//    // Empty doc
-//    m_viewportCursorPos.y = 0;
-//    m_viewportCursorPos.x = 0;
-
-//    m_documentCursorPos.pl = 0;
-//    m_documentCursorPos.el = 0;
-//    m_documentCursorPos.relativeEl = 0;
-//    m_documentCursorPos.ch = 0;
-//    m_documentCursorPos.relativeCh = 0;
-
-//    return;
-//  }
-
-//  // Find the editorLine this position corresponds to
-//  EditorLine *el = nullptr;
-//  int currentEL = 0;
-//  int currentPL = 0;
-//  int relativeEL = 0;
-//  for(auto& pl : m_physicalLines) {
-//    int elCount = (int)pl.m_editorLines.size();
-//    if (y >= currentEL + elCount) // Still not in the requested EL
-//      currentEL += elCount;
-//    else {
-//      // We'll arrive at the requested EL in this PL
-//      relativeEL = y - currentEL;
-//      el = &pl.m_editorLines[relativeEL];
-//      break;
-//    }
-//    ++currentPL;
-//  }
-
-//  if (!el) {
-//    --currentPL; // Fix out-of-loop values
-//    --currentEL;
-//    // Cannot validate or out of the document, set it to the last possible position
-//    m_viewportCursorPos.y = currentEL;
-//    m_viewportCursorPos.x = (int)m_physicalLines.back().m_editorLines.back().m_characters.size();
-
-//    m_documentCursorPos.pl = currentPL;
-//    m_documentCursorPos.el = currentEL;
-//    m_documentCursorPos.relativeEl = (int)(m_physicalLines.back().m_editorLines.size() - 1);
-
-//    // Calculate the ch count from the beginning of the Pl
-//    m_documentCursorPos.ch = std::accumulate( m_physicalLines.back().m_editorLines.begin(),
-//                                              m_physicalLines.back().m_editorLines.end(), 0,
-//        [](const int tot, EditorLine& edl) {
-//          return tot + (int)edl.m_characters.size();
-//    });
-
-//    m_documentCursorPos.relativeCh = m_viewportCursorPos.x;
-//    return;
-//  }
-
-//  // We found a valid EL, y is fine
-//  m_viewportCursorPos.y = y;
-
-//  // If the X coordinate is longer than the EL line itself, grab the minimum and drop the EOLs
-//  auto& vec = el->m_characters;
-//  int newXCoord = x;
-//  int EOLs = 0;
-//  if (vec.size() >= 1 && vec.back() == '\n') {
-//    ++EOLs;
-//    if (vec.size() >= 2 && vec[vec.size() - 2] == '\r')
-//      ++EOLs;
-//  }
-//  if (x >= vec.size() - EOLs)
-//    newXCoord = (int)vec.size() - EOLs; // Put the caret before the EOLs if we clicked where the EL can't reach
-//  else {
-//    // Into the EL, mind the tab-adjustment if we're right into one
-//    if (vec[x] == 0x07) {
-//      // Find the first tab of the series
-//      int first = x;
-//      while(first >= 0 && vec[first] == 0x07)
-//        --first;
-//      ++first;
-//      // Find the last tab of the series
-//      int last = x;
-//      while(last < vec.size() && vec[last] == 0x07)
-//        ++last;
-//      --last;
-
-//      int index = x - first; // index into the sequence
-
-//      // |_|_|_|_|  |_|_|_|_|
-//      //  ^ ^ * *
-//      //  | |
-//      //  these indices / 4 have decimal part less than 0.5 therefore the caret
-//      //  should be aligned to first + (int)(index/4)*4
-//      //  Similar reasoning for the last two (*)
-//      float res = index / 4.f;
-//      if (res < .5f)
-//        newXCoord = first + (int)(index / 4) * 4;
-//      else
-//        newXCoord = first + (int)(index / 4 + 1) * 4;
-//    }
-//  }
-
-//  // This is the position the user will see on the viewport grid
-//  m_viewportCursorPos.x = newXCoord;
-
-//  // Now calculate the internal position in the document (tabs and newlines will mess this up)
-//  m_documentCursorPos.pl = currentPL;
-//  m_documentCursorPos.el = currentEL;
-//  m_documentCursorPos.relativeEl = relativeEL;
-//  m_documentCursorPos.ch = std::accumulate( m_physicalLines[currentPL].m_editorLines.begin(),
-//                                            m_physicalLines[currentPL].m_editorLines.begin() + relativeEL, 0,
-//                            [](const int tot, EditorLine& edl) {
-//                              return tot + (int)edl.m_characters.size();
-//                        }) + newXCoord;
-//  m_documentCursorPos.relativeCh = newXCoord;
-//}
-
-//void Document::typeNewlineAtCursor() {
-//  if (m_plainTextLines.empty()) {
-//    // First digits, create a line we can write into
-//    m_plainTextLines.resize(1);
-//  }
-
-//  // Add newline at the current caret position
-//  QString& line = m_plainTextLines[m_documentCursorPos.pl];
-//  QString restOfLine = line.right(line.length() - m_documentCursorPos.ch);
-
-//  // Remove the rest from the physical line
-//  line.remove(m_documentCursorPos.ch, restOfLine.size());
-//  line += '\n';
-
-//  // Add another PL and stitch the rest of the split in there
-//  m_plainTextLines.insert(m_plainTextLines.begin() + m_documentCursorPos.pl + 1, std::move(restOfLine));
-
-//  // Advance the caret to the next PL
-//  ++(m_viewportCursorPos.y);
-//  m_viewportCursorPos.x = 0;
-//  ++(m_documentCursorPos.pl);
-//  ++(m_documentCursorPos.el);
-//  m_documentCursorPos.relativeEl = 0; // Obviously if the line did fit with the current wrap, a split will create
-//                                      // another line which fits the wrap
-//  m_documentCursorPos.ch = 0;
-//  m_documentCursorPos.relativeCh = 0;
-
-//  ++m_numberOfEditorLines;
-//}
-
-//void Document::typeAtCursor(QString keyStr) {
-
-//  if (keyStr.isEmpty())
-//    return; // Nothing to be done (unrecognized keystroke?)
-
-//  if (m_plainTextLines.empty()) {
-//    // First digits, create a line we can write into
-//    m_plainTextLines.resize(1);
-//  }
-
-//  // Add text at the current caret position
-//  QString& line = m_plainTextLines[m_documentCursorPos.pl];
-
-//  line.insert(m_documentCursorPos.ch, keyStr);
-
-//  // Advance the caret since we inserted text
-//  ++(m_viewportCursorPos.x);
-//  ++(m_documentCursorPos.ch);
-//  ++(m_documentCursorPos.relativeCh);
-//}
-
-
-///*
-// *
-// * The class Document represents a grid for a text file
-// *
-// * It provides a vector of PhysicalLine objects (the physical ones) that can include one or more multiple
-// * EditorLine objects (the fake ones due to wrap). A PhysicalLine has two values: an int beginValue (i.e. the
-// * starting pixel line where the line begins to be rendered in a virtual document) and an int endValue (after
-// * all the EditorLines have been rendered). fontMetrics() and m_wrapWidth are the values necessary to calculate
-// * this grid.
-// *
-// * document_is_loaded()
-// *  1) From its extension (e.g. cpp) a Lexer is chosen (or no lexer at all). If chosen it is lexed.
-// *
-// *  2) PhysicalLine objects are created, each one with ONE or MORE EditorLine. An EditorLine contains a list of words
-// *     and their associated style (bold/italic/color/etc..) due to how the Lexer interpreted this.
-// *
-// *  3) PhysicalLine objects also have a beginValue and endValue (to facilitate queries when something is clicked inside
-// *     the rendered region). After a click was received, a search for the character (or no-character in the line) is issued
-// *     so the Document must have something like
-// *       clickOnPoint(Point, hint LinesFrom, hint LinesTo (these hints are given since the viewport displays only a few lines) ->
-// *         return the new click position
-// *       doubleClickOnPoint (..) -> return the start-end positions for a selection (or a list of words in the entire document for
-// *                                  similar selections)
-// *       startDragSelection ().. etc.
-// *
-// *
-// */
-
-
-//// Copy the characters for this editor line into our characters vector
-//EditorLine::EditorLine(QString str) {
-//  if (str.isEmpty())
-//    return;
-//  m_characters.resize(str.length());
-//  std::copy(str.begin(), str.end(), m_characters.begin());
-//}
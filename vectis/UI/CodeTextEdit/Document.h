@@ -2,7 +2,15 @@
 #define DOCUMENT_H
 
 #include <UI/CodeTextEdit/Lexers/Lexer.h>
+#include <UI/CodeTextEdit/ChunkedSequence.h>
+#include <UI/CodeTextEdit/EditorLineIndex.h>
+#include <UI/CodeTextEdit/LineBreaks.h>
+#include <UI/CodeTextEdit/Buffer/FileText.h>
+#include <UI/CodeTextEdit/Buffer/PieceTable.h>
+#include <UI/CodeTextEdit/Buffer/TextEncoding.h>
 #include <QObject>
+#include <QTimer>
+#include <QFutureWatcher>
 #include <utility>
 #include <memory>
 #include <vector>
@@ -18,23 +26,54 @@ class CodeTextEdit;
 //
 //   EditorLine {
 //     An editor line is a line for the editor, i.e. a line that might be the result
-//     of wrapping or be equivalent to a physical line. EditorLine stores the characters
+//     of wrapping or be equivalent to a physical line. EditorLine is just a view of part of
+//     its physical line: the characters stay in the document buffer
 //   }
 // }
 
 struct EditorLine {
-  EditorLine (QString str);
-
-  std::vector<QChar> m_characters;
+  int m_offset = 0; // From the beginning of the physical line
+  int m_length = 0;
 };
 
+// The editor lines of a physical line are stored as the offsets where it was broken: a few of
+// them fit in the line itself, longer lines keep the rest in a vector whose capacity is reused
+// when they're wrapped again. Wrapping doesn't allocate per editor line
 struct PhysicalLine {
-  PhysicalLine (EditorLine&& editorLine) {
-    m_editorLines.emplace_back(std::forward<EditorLine>(editorLine));
+  int editorLineCount() const { return m_breakCount + 1; }
+  EditorLine editorLine(int index) const {
+    const int begin = (index == 0) ? 0 : breakAt(index - 1);
+    const int end = (index == m_breakCount) ? m_length : breakAt(index);
+    return EditorLine{begin, end - begin};
+  }
+  void clearBreaks() {
+    m_breakCount = 0;
+    m_moreBreaks.clear();
+  }
+  void addBreak(int offset) {
+    if (m_breakCount < INLINE_BREAKS)
+      m_inlineBreaks[m_breakCount] = offset;
+    else
+      m_moreBreaks.push_back(offset);
+    ++m_breakCount;
+  }
+
+  int m_length = 0; // Characters (including the newline) when the line was last wrapped
+  bool m_stale = true; // Has to be wrapped (again)
+  bool m_edited = true; // m_breaks and m_encoding have to be found (again)
+  LineEncoding m_encoding = LineEncoding::Ascii;
+  LineBreaks m_breaks;
+  int m_arena = -1; // The Document line arena m_breaks are allocated from, if any
+
+private:
+  int breakAt(int i) const {
+    return (i < INLINE_BREAKS) ? m_inlineBreaks[i] : m_moreBreaks[i - INLINE_BREAKS];
   }
-  PhysicalLine () = default;
 
-  std::vector<EditorLine> m_editorLines;
+  static const int INLINE_BREAKS = 3;
+  int m_breakCount = 0; // Editor lines after the first one
+  int m_inlineBreaks[INLINE_BREAKS] = {};
+  std::vector<int> m_moreBreaks;
 };
 
 // This class represents document loaded from the CodeTextEdit control.
@@ -44,38 +83,196 @@ struct PhysicalLine {
 class Document : public QObject {
     Q_OBJECT
 public:
-    explicit Document(const CodeTextEdit& codeTextEdit);
+    explicit Document(QObject *parent = 0);
 
     bool loadFromFile (QString file);
+    // Loading a file a chunk at a time (see DocumentLoader): the document starts empty and every
+    // chunk read is appended to its end, wherever edits made in the meantime left it
+    void beginLoading(std::shared_ptr<FileText> text);
+    void appendLoadedText(size_t length, const std::vector<uint64_t>& lineStarts);
     void applySyntaxHighlight(SyntaxHighlight s);
+    // Lexes what was edited since the last lexing (everything after a load or a syntax change,
+    // the lines on screen first) in the background
+    void relex();
+    void setCharacterWidth(int pixels);
     void setWrapWidth(int width);
+    // Characters per editor line, 0 if lines aren't wrapped
+    int wrapColumns() const { return wrapColumns(m_wrapWidth); }
+    // The range of physical lines on screen: these are wrapped and lexed first
+    void setVisibleLines(int first, int last);
+
+    int physicalLineCount() const { return m_physicalLines.size(); }
+    // Editor lines <-> physical lines, in O(log n)
+    int editorLineCount() const { return m_editorLineIndex.editorLineCount(); }
+    int physicalLineOf(int editorLine) const { return m_editorLineIndex.lineAt(editorLine); }
+    int firstEditorLineOf(int physicalLine) const { return m_editorLineIndex.firstEditorLine(physicalLine); }
+    // Document offsets <-> (editor line, column), in O(log n) plus the editor lines of a physical line
+    struct EditorPosition {
+      int editorLine;
+      int column;
+    };
+    EditorPosition editorPositionAt(size_t offset) const;
+    size_t offsetAt(int editorLine, int column) const;
+    // The text of a physical or of an editor line, decoded from the bytes in the buffer
+    QString lineText(int physicalLine) const;
+    QString editorLineText(int editorLine) const;
+    // Lexer styles of a physical or of an editor line, in UTF-16 code units of its text
+    struct StyleRun {
+      int start;
+      int length;
+      Style style;
+    };
+    void lineStyles(int physicalLine, std::vector<StyleRun>& runs) const;
+    void editorLineStyles(int editorLine, std::vector<StyleRun>& runs) const;
+
+    // The caret is at a column (in characters) of an editor line
+    int cursorEditorLine() const { return m_viewportCursorPos.y; }
+    int cursorColumn() const { return m_viewportCursorPos.x; }
+    size_t cursorOffset() const;
+    // Asks the document to set the cursor elsewhere. The document will validate the position in the viewport
+    // asked, possibly fix/correct the coordinates, and then set the m_viewportCursorPos variable
+    void setCursorPos(int x, int y);
+    void setCursorOffset(size_t offset);
+    void moveCursorLeft();
+    void moveCursorRight();
+
+    void moveCursorWordLeft();
+    void moveCursorWordRight();
+
+    // The selection is the text between an anchor and the caret. Edits replace it
+    bool hasSelection() const;
+    size_t selectionStart() const;
+    size_t selectionEnd() const;
+    void setSelectionAnchor(size_t offset);
+    void clearSelection();
+    void selectAll();
+    void selectWordAt(size_t offset);
+    // Text as typed, i.e. with tabs rather than their tabulation markers
+    QString text(size_t from, size_t to) const;
+    QString selectedText() const { return text(selectionStart(), selectionEnd()); }
+
+    // Typed or pasted text (it might span several lines) replaces the selection
+    void typeNewlineAtCursor();
+    void typeAtCursor(QString keyStr);
+    void eraseBeforeCursor();
+    void eraseAfterCursor();
+    void eraseSelection();
+
+    // Every edit above is undoable. Consecutive characters typed are undone together
+    bool canUndo() const { return !m_undoSteps.empty(); }
+    bool canRedo() const { return !m_redoSteps.empty(); }
+    void undo();
+    void redo();
+    // Whether the document was edited since it was loaded (or saved): appending the text being
+    // loaded doesn't count, edits made while it's loading do. Undoing them all makes it unmodified
+    bool isModified() const { return static_cast<int>(m_undoSteps.size()) != m_unmodifiedSteps; }
+    void setModified(bool modified);
+
+    // Memory taken by the line breaks (see Arena) and by the lexing results
+    Arena::Statistics lineArenaStatistics() const;
+    StyleDatabase::Statistics styleStatistics() const { return m_styleDb.statistics(); }
+
+signals:
+    // Lines got wrapped differently (lines off screen are wrapped in the background)
+    void editorLinesChanged();
+    // An edit replaced physical lines [first; first + removed) with [first; first + added)
+    void linesChanged(int first, int removed, int added);
+    // The styles of physical lines [first; last] might have changed
+    void linesRestyled(int first, int last);
 
 private:
     friend class CodeTextEdit;
     friend class RenderingThread;
 
     void recalculateDocumentLines();
+    // Wrap results are kept per physical line: only the stale ones get wrapped again (i.e. the
+    // edited ones and, after a wrap width change, the ones not fitting either the old or the new
+    // width). The ones on screen are wrapped right away, the rest in time-budgeted slices
+    int wrapColumns(int wrapWidth) const;
+    void markStale(int line);
+    void markEdited(int line);
+    void wrapLines(const std::vector<int>& lines);
+    void wrapSlice();
+    void updateCursorAfterWrap();
+    void replaceLines(int first, int removed, int added);
+    // Lines are stored as bytes while the caret and the wrap width count characters: these only
+    // differ in UTF-8 lines. Offsets are relative to the start of the physical line
+    LineEncoding lineEncoding(int line) const;
+    int columnsBetween(int line, int from, int to) const;
+    int offsetAfterColumns(int line, int from, int columns, int limit) const;
+    void styleRuns(int line, int offset, int length, std::vector<StyleRun>& runs) const;
     // Qt hasn't a reliable way to detect whether all widgets have reached their stable
     // dimension (i.e. all resize() have been triggered), thus we delay syntax highlighting
     // and other expensive operations until the last resize() has been triggered
     bool m_firstDocumentRecalculate = true;
 
-    std::vector<QString> m_plainTextLines;
-    const CodeTextEdit& m_codeTextEdit;
+    std::shared_ptr<FileText> m_text; // Of the file the document was loaded from (the buffer points into it)
+    PieceTable m_buffer; // The document text
 
     // Variables related to how the control renders lines
     int m_characterWidthPixels; // A document has an internal copy of the character width since this
                                 // might differ from the code editor (perhaps this document is cached
                                 // and it hasn't been rendered with the new char width yet)
-    int m_characterDescentPixels; // Ditto
 
     int m_wrapWidth;
+    int m_wrappedColumns = 0; // The columns the lines which aren't stale were wrapped at
     int m_numberOfEditorLines;
-    // int m_maximumCharactersLine; // According to wrapWidth
 
     std::unique_ptr<LexerBase> m_lexer;
     bool m_needReLexing; // Whether the document needs re-lexing
-    std::vector<PhysicalLine> m_physicalLines;
+    struct EditedRegion {
+      size_t offset;
+      size_t length;
+    };
+    std::vector<EditedRegion> m_editedSinceLexing; // In the current text, sorted and disjoint: only these
+                                                   // parts of the document need to be lexed again
+    void noteEdit(size_t offset, size_t removed, size_t added);
+    void addEditedRegion(size_t offset, size_t removed, size_t added);
+    // Edited regions are relexed by a worker thread, one at a time, with a lexer of its own and on a
+    // copy of the text around the region. Results of a job started before the last edit are dropped.
+    // Lexing a whole document is lexing a region spanning all of it: its lines are plain until the
+    // job gets to them, but the ones on screen are lexed right away
+    struct LexingJob {
+      LexerType type;
+      LexingStart start; // In the copy, lines are the document ones
+      std::string text;
+      CheckpointCopy previous;
+      bool toEnd; // The copy reaches the end of the document
+    };
+    struct LexingResult {
+      StylePatch patch;
+      bool complete = true; // Otherwise the patch stops at a checkpoint before the end of the copy
+      bool progress = true; // False if the copy didn't even get past a checkpoint
+    };
+    LexingJob lexingJob(const EditedRegion& region, size_t window) const;
+    static LexingResult lex(const LexingJob& job);
+    bool applyLexing(LexingResult& result);
+    void lexVisibleLines();
+    void startLexing();
+    void lexingFinished();
+    QFutureWatcher<LexingResult> m_lexingWatcher;
+    bool m_lexing = false;
+    int m_generation = 0; // Bumped by the edits and lexer changes making the running job stale
+    int m_lexingGeneration = 0;
+    size_t m_lexingCopyEnd = 0; // Edits past the copy the job lexes don't make its results stale
+    size_t m_lexingWindow; // Characters past the region the job copies
+    bool m_lexingDocument = false; // The last edited region is the part of the document never lexed
+    // The breaks found by a wrap pass are allocated from an arena of its own, freed as soon as none
+    // of its lines uses it anymore (they were edited and wrapped again, or removed)
+    struct LineArena {
+      std::unique_ptr<Arena> arena;
+      int lines = 0;
+    };
+    std::vector<LineArena> m_lineArenas; // The slots of the freed ones are reused
+    std::vector<int> m_freeLineArenas;
+    int newLineArena();
+    void releaseBreaks(PhysicalLine& line);
+    ChunkedSequence<PhysicalLine> m_physicalLines; // Lines are inserted and erased anywhere in O(log n)
+    EditorLineIndex m_editorLineIndex; // Editor lines of every physical line, kept in sync by wrapLines()
+    std::vector<int> m_staleLines; // Might also contain lines which aren't stale anymore
+    int m_staleCount = 0;
+    int m_firstVisibleLine = 0, m_lastVisibleLine = -1;
+    QTimer m_wrapTimer;
     StyleDatabase m_styleDb; // Style database. Contains any style segment from a successful lexing
 
     // Variable document-specific
@@ -93,12 +290,36 @@ private:
       int relativeCh = 0; // Relative to the start of the EditorLine
     } m_documentCursorPos; // Latest known cursor position expressed in PhysicalLine - EditorLine - CharacterIndex
 
-    // Asks the document to set the cursor elsewhere. The document will validate the position in the viewport
-    // asked, possibly fix/correct the coordinates, and then set the m_viewportCursorPos variable
-    void setCursorPos(int x, int y);
+    bool m_selecting = false; // Whether there's a selection anchor
+    size_t m_selectionAnchor = 0;
 
-    void typeNewlineAtCursor();
-    void typeAtCursor(QString keyStr);
+    // An undo step is the edits made by a user action, undone in reverse order. Offsets and text are
+    // the ones of the buffer at the time of each edit
+    struct UndoEdit {
+      size_t offset;
+      std::string removed;
+      std::string added;
+    };
+    struct UndoStep {
+      std::vector<UndoEdit> edits;
+      size_t cursorBefore;
+      size_t cursorAfter;
+    };
+    std::vector<UndoStep> m_undoSteps;
+    std::vector<UndoStep> m_redoSteps;
+    bool m_recordingUndo = false; // Edits go to the last undo step
+    bool m_undoMergeable = false; // The last undo step is characters typed, more can be added to it
+    int m_unmodifiedSteps = 0; // Undo steps of the unmodified document, -1 if they're gone
+    void beginUndoStep(bool typing);
+    void endUndoStep(bool typing);
+
+    size_t previousCharacter(size_t offset) const;
+    size_t nextCharacter(size_t offset) const;
+    bool isWordCharacter(size_t offset) const;
+    void replaceText(size_t from, size_t to, const std::string& text);
+    bool eraseSelectedText();
+    void eraseText(size_t from, size_t to);
+    void reencodeLineAsUtf8(int line);
 
     int m_storeSliderPos = -1; // This variable is used to store the slider position when this document
                                // is either switched off or put on hold
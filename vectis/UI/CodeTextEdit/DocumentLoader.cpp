@@ -0,0 +1,140 @@
+#include <UI/CodeTextEdit/DocumentLoader.h>
+#include <UI/CodeTextEdit/Document.h>
+#include <UI/CodeTextEdit/Buffer/FileText.h>
+#include <QtConcurrent>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace { // Functions reserved for this TU's internal use
+
+  // The first chunk is about a screenful (so it can be shown right away), the next ones are larger
+  const size_t FIRST_CHUNK_SIZE = 256 * 1024;
+  const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+  const int POLL_INTERVAL_MS = 15;
+
+}
+
+// What the job read so far, taken by the GUI thread at every poll
+struct DocumentLoader::Loading {
+  QString path;
+  std::atomic<bool> cancelled{false};
+  std::shared_ptr<FileText> text = std::make_shared<FileText>();
+
+  std::mutex mutex; // Protects the following
+  bool opened = false;
+  bool failed = false;
+  bool done = false;
+  size_t size = 0; // Of the text read so far
+  size_t fileRead = 0;
+  std::vector<uint64_t> lineStarts; // Of the lines read since the last poll
+};
+
+DocumentLoader::DocumentLoader(QObject *parent) :
+  QObject(parent)
+{
+  m_pollTimer.setInterval(POLL_INTERVAL_MS);
+  connect(&m_pollTimer, &QTimer::timeout, this, [this]() {
+    appendReadChunks();
+  });
+}
+
+DocumentLoader::~DocumentLoader() {
+  if (m_loading)
+    m_loading->cancelled = true; // The job quits on its own, nothing to wait for
+}
+
+void DocumentLoader::loadInto(Document *document, const QString& path) {
+  Q_ASSERT(document);
+  m_document = document;
+  m_loading = std::make_shared<Loading>();
+  m_loading->path = path;
+  emit progressChanged(0);
+
+  // The job only shares the loading state: the document is only touched by the GUI thread
+  std::shared_ptr<Loading> loading = m_loading;
+  QtConcurrent::run([loading]() {
+    FileText& text = *loading->text;
+    const bool opened = text.open(loading->path);
+    {
+      std::lock_guard<std::mutex> lock(loading->mutex);
+      loading->opened = opened;
+      loading->failed = !opened;
+      loading->done = !opened || text.atEnd();
+    }
+    size_t chunkSize = FIRST_CHUNK_SIZE;
+    std::vector<uint64_t> lineStarts;
+    while (opened && !text.atEnd() && !loading->cancelled) {
+      lineStarts.clear();
+      const size_t size = text.readChunk(chunkSize, lineStarts);
+      chunkSize = CHUNK_SIZE;
+      std::lock_guard<std::mutex> lock(loading->mutex);
+      loading->size = size;
+      loading->fileRead = text.fileRead();
+      loading->lineStarts.insert(loading->lineStarts.end(), lineStarts.begin(), lineStarts.end());
+      loading->done = text.atEnd();
+    }
+  });
+  m_pollTimer.start();
+}
+
+// Appends to the document whatever the job read since the last poll
+void DocumentLoader::appendReadChunks() {
+  bool opened, failed, done;
+  size_t size, fileRead;
+  std::vector<uint64_t> lineStarts;
+  {
+    std::lock_guard<std::mutex> lock(m_loading->mutex);
+    opened = m_loading->opened;
+    failed = m_loading->failed;
+    done = m_loading->done;
+    size = m_loading->size;
+    fileRead = m_loading->fileRead;
+    lineStarts.swap(m_loading->lineStarts);
+  }
+  if (!opened && !failed)
+    return; // Still opening the file
+
+  if (m_document.isNull()) { // Deleted without cancelling us
+    cancel();
+    return;
+  }
+  if (failed) {
+    m_pollTimer.stop();
+    emit finished(false);
+    deleteLater();
+    return;
+  }
+
+  if (!m_begun) {
+    m_document->beginLoading(m_loading->text);
+    m_begun = true;
+  }
+  if (size > m_appended) {
+    m_document->appendLoadedText(size - m_appended, lineStarts);
+    m_appended = size;
+  }
+
+  const size_t fileSize = m_loading->text->fileSize();
+  const int progress = (fileSize > 0) ? static_cast<int>(fileRead * 100 / fileSize) : 100;
+  if (progress != m_lastProgress) {
+    m_lastProgress = progress;
+    emit progressChanged(progress);
+  }
+  if (!m_started && (size > 0 || done)) {
+    m_started = true;
+    emit started();
+  }
+  if (done) {
+    m_pollTimer.stop();
+    emit finished(true);
+    deleteLater();
+  }
+}
+
+void DocumentLoader::cancel() {
+  m_loading->cancelled = true;
+  m_pollTimer.stop();
+  disconnect(this, nullptr, nullptr, nullptr);
+  deleteLater();
+}
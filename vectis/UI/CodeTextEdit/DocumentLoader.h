@@ -0,0 +1,47 @@
+#ifndef DOCUMENTLOADER_H
+#define DOCUMENTLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QPointer>
+#include <memory>
+
+class Document;
+
+// Streams a file into a Document: a background job reads the file a chunk at a time (see FileText)
+// while the GUI thread appends every chunk read to the document. The first chunk is small so that
+// the document can be shown (see started()) and edited while the rest of the file is read.
+//
+// The loader deletes itself once it has finished (or has been cancelled).
+class DocumentLoader : public QObject {
+    Q_OBJECT
+public:
+    explicit DocumentLoader(QObject *parent = 0);
+    ~DocumentLoader();
+
+    // Starts loading the file into the given document (with its syntax highlighting already set)
+    void loadInto(Document *document, const QString& path);
+    // Stops loading right away: the job reads at most the chunk it's reading and then quits on its
+    // own, the document keeps the text appended so far and can be deleted afterwards
+    void cancel();
+
+signals:
+    void started(); // The document has its first lines and can be shown
+    void progressChanged(int percentage);
+    void finished(bool loaded); // False if the file couldn't be opened
+
+private:
+    void appendReadChunks();
+
+    struct Loading; // Shared with the job, which outlives the loader if cancelled
+    std::shared_ptr<Loading> m_loading;
+    QPointer<Document> m_document;
+    QTimer m_pollTimer;
+    bool m_begun = false; // The document was emptied and its buffer points into the text
+    size_t m_appended = 0; // Text appended to the document so far
+    bool m_started = false;
+    int m_lastProgress = -1;
+};
+
+#endif // DOCUMENTLOADER_H
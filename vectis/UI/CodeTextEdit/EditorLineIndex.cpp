@@ -0,0 +1,14 @@
+#include <UI/CodeTextEdit/EditorLineIndex.h>
+
+void EditorLineIndex::set(int line, int count) {
+  if (m_counts[line] != count)
+    m_counts.set(line, count);
+}
+
+// The editor line belongs to the last physical line preceded by no more than editorLine editor
+// lines: lines without editor lines (not wrapped yet) are skipped
+int EditorLineIndex::lineAt(int editorLine) const {
+  if (editorLine < 0)
+    return 0;
+  return m_counts.indexAtWeight(editorLine);
+}
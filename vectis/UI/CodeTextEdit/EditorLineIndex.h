@@ -0,0 +1,37 @@
+#ifndef EDITORLINEINDEX_H
+#define EDITORLINEINDEX_H
+
+#include <UI/CodeTextEdit/ChunkedSequence.h>
+#include <utility>
+#include <vector>
+
+// Number of editor lines of every physical line, weighted by themselves in a ChunkedSequence: the
+// first editor line of a physical line, the physical line an editor line belongs to, updating the
+// count of a line after it's wrapped again and inserting or removing a line are all O(log n)
+class EditorLineIndex {
+public:
+  // Every physical line with the given count of editor lines
+  void build(std::vector<int> counts) { m_counts.assign(std::move(counts)); }
+
+  int lineCount() const { return m_counts.size(); }
+  int editorLineCount() const { return m_counts.totalWeight(); }
+  int count(int line) const { return m_counts[line]; }
+
+  void set(int line, int count);
+  void insert(int line, int count) { m_counts.insert(line, count); }
+  void append(std::vector<int> counts) { m_counts.append(std::move(counts)); }
+  void remove(int line) { m_counts.erase(line); }
+
+  // First editor line of a physical line. firstEditorLine(lineCount()) is editorLineCount()
+  int firstEditorLine(int line) const { return m_counts.weightBefore(line); }
+  // Physical line an editor line belongs to (lineCount() if it's past the end)
+  int lineAt(int editorLine) const;
+
+private:
+  struct Count {
+    int operator()(int count) const { return count; }
+  };
+  ChunkedSequence<int, Count> m_counts;
+};
+
+#endif // EDITORLINEINDEX_H
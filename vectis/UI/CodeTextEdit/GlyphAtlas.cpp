@@ -0,0 +1,92 @@
+#include <UI/CodeTextEdit/GlyphAtlas.h>
+#include <QFontMetrics>
+#include <QFontMetricsF>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+
+namespace { // Functions reserved for this TU's internal use
+
+  const int ATLAS_COLUMNS = 32; // Cells per row of the atlas
+  const int INITIAL_ROWS = 8; // Doubled whenever the atlas is full
+  const int MAX_CELLS = 4096;
+
+  quint64 glyphKey(QChar character, bool bold, bool italic, QRgb color) {
+    return (quint64(color) << 32) | (quint64(bold) << 17) | (quint64(italic) << 16) | character.unicode();
+  }
+}
+
+void GlyphAtlas::setFont(const QFont& font) {
+  for (int i = 0; i < 4; ++i) {
+    m_fonts[i] = font;
+    m_fonts[i].setBold((i & 1) != 0);
+    m_fonts[i].setItalic((i & 2) != 0);
+  }
+  QFontMetrics metrics(font);
+  m_characterWidth = QFontMetricsF(font).horizontalAdvance(QLatin1Char('A'));
+  m_padding = static_cast<int>(std::ceil(m_characterWidth / 2));
+  m_ascent = metrics.ascent();
+  m_cellSize = QSize(static_cast<int>(std::ceil(m_characterWidth)) + 2 * m_padding, metrics.height());
+  m_cells.clear();
+  m_cellCount = 0;
+  m_image = QImage();
+  m_pixmap = QPixmap();
+  m_pixmapStale = false;
+}
+
+QRect GlyphAtlas::cell(QChar character, bool bold, bool italic, QRgb color) {
+  const quint64 key = glyphKey(character, bold, italic, color);
+  auto it = m_cells.constFind(key);
+  int index = (it != m_cells.constEnd()) ? *it : m_cellCount;
+
+  if (it == m_cells.constEnd()) { // First time: rasterize it, unless it doesn't fit the grid
+    const QFont& font = m_fonts[(bold ? 1 : 0) | (italic ? 2 : 0)];
+    QFontMetricsF metrics(font);
+    if (!metrics.inFont(character) || std::abs(metrics.horizontalAdvance(character) - m_characterWidth) > 0.01) {
+      m_cells.insert(key, -1);
+      return QRect();
+    }
+
+    const int rows = m_image.isNull() ? 0 : m_image.height() / m_cellSize.height();
+    if (index >= rows * ATLAS_COLUMNS) { // Full
+      QImage image(ATLAS_COLUMNS * m_cellSize.width(), std::max(rows * 2, INITIAL_ROWS) * m_cellSize.height(),
+                   QImage::Format_ARGB32_Premultiplied);
+      image.fill(Qt::transparent);
+      if (!m_image.isNull()) {
+        QPainter painter(&image);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(0, 0, m_image);
+      }
+      m_image = image;
+    }
+
+    QPainter painter(&m_image);
+    painter.setFont(font);
+    painter.setPen(QColor::fromRgba(color));
+    painter.drawText(QPointF((index % ATLAS_COLUMNS) * m_cellSize.width() + m_padding,
+                             (index / ATLAS_COLUMNS) * m_cellSize.height() + m_ascent), QString(character));
+    m_cells.insert(key, index);
+    ++m_cellCount;
+    m_pixmapStale = true;
+  }
+
+  if (index < 0)
+    return QRect();
+  return QRect(QPoint((index % ATLAS_COLUMNS) * m_cellSize.width(), (index / ATLAS_COLUMNS) * m_cellSize.height()),
+               m_cellSize);
+}
+
+const QPixmap& GlyphAtlas::pixmap() {
+  if (m_pixmapStale) { // Converted once per batch of new glyphs, not per draw
+    m_pixmap = QPixmap::fromImage(m_image);
+    m_pixmapStale = false;
+  }
+  return m_pixmap;
+}
+
+bool GlyphAtlas::trim() {
+  if (m_cells.size() <= MAX_CELLS)
+    return false;
+  setFont(m_fonts[0]);
+  return true;
+}
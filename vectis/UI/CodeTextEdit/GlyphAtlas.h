@@ -0,0 +1,46 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <QChar>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QRect>
+
+// Glyphs of a fixed-pitch font, rasterized once per (character, bold, italic, colour) into the
+// cells of a single pixmap: text is then drawn as a batch of blits out of it (see
+// MonospaceRenderer). A cell is a line tall and a character wide, plus some room on both sides for
+// the glyphs overhanging their advance (e.g. italic ones); the baseline is ascent() rows down
+class GlyphAtlas {
+public:
+  void setFont(const QFont& font);
+
+  // The cell of a glyph in pixmap(), rasterized the first time it's asked for. Null if the
+  // character can't be drawn on the monospace grid (missing from the font, or with an advance
+  // other than characterWidth())
+  QRect cell(QChar character, bool bold, bool italic, QRgb color);
+  // Every glyph rasterized so far. Cells stay where they are until trim()
+  const QPixmap& pixmap();
+  // Starts over if too many glyphs were rasterized (e.g. lots of colours), returning true if it
+  // did: cells handed out before aren't valid anymore
+  bool trim();
+
+  qreal characterWidth() const { return m_characterWidth; }
+  int padding() const { return m_padding; }
+  int ascent() const { return m_ascent; }
+
+private:
+  QFont m_fonts[4]; // Regular, bold, italic, bold italic
+  qreal m_characterWidth = 0;
+  int m_padding = 0;
+  int m_ascent = 0;
+  QSize m_cellSize;
+  QHash<quint64, int> m_cells; // Cell index of every glyph asked for, -1 if it can't be drawn
+  int m_cellCount = 0;
+  QImage m_image;
+  QPixmap m_pixmap;
+  bool m_pixmapStale = false;
+};
+
+#endif // GLYPHATLAS_H
@@ -0,0 +1,127 @@
+#ifndef CPPKEYWORDS_H
+#define CPPKEYWORDS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The C++ reserved keywords, shared by the C++ lexer and highlighter. A word is classified with
+// a perfect hash whose table is generated at compile time: a few character loads, a multiply and
+// a single comparison against the only keyword the word could be
+
+enum class CPPKeywordClass : uint8_t {
+  None,
+  Type,           // Declarations and types, e.g. 'int' or 'static'
+  Statement,      // Control flow, operators and qualifiers, e.g. 'for' or 'const'
+  AccessSpecifier // 'private', 'protected' and 'public'
+};
+
+namespace CPPKeywords {
+
+  struct Keyword {
+    const char *text;
+    CPPKeywordClass keywordClass;
+  };
+
+  constexpr Keyword keywords[] = {
+    {"alignas", CPPKeywordClass::Type}, {"alignof", CPPKeywordClass::Type}, {"asm", CPPKeywordClass::Type},
+    {"auto", CPPKeywordClass::Type}, {"bitand", CPPKeywordClass::Type}, {"bitor", CPPKeywordClass::Type},
+    {"bool", CPPKeywordClass::Type}, {"char", CPPKeywordClass::Type}, {"char16_t", CPPKeywordClass::Type},
+    {"char32_t", CPPKeywordClass::Type}, {"class", CPPKeywordClass::Type}, {"compl", CPPKeywordClass::Type},
+    {"concept", CPPKeywordClass::Type}, {"decltype", CPPKeywordClass::Type}, {"default", CPPKeywordClass::Type},
+    {"delete", CPPKeywordClass::Type}, {"double", CPPKeywordClass::Type}, {"dynamic_cast", CPPKeywordClass::Type},
+    {"enum", CPPKeywordClass::Type}, {"explicit", CPPKeywordClass::Type}, {"export", CPPKeywordClass::Type},
+    {"extern", CPPKeywordClass::Type}, {"false", CPPKeywordClass::Type}, {"float", CPPKeywordClass::Type},
+    {"friend", CPPKeywordClass::Type}, {"goto", CPPKeywordClass::Type}, {"inline", CPPKeywordClass::Type},
+    {"int", CPPKeywordClass::Type}, {"long", CPPKeywordClass::Type}, {"mutable", CPPKeywordClass::Type},
+    {"namespace", CPPKeywordClass::Type}, {"new", CPPKeywordClass::Type}, {"noexcept", CPPKeywordClass::Type},
+    {"nullptr", CPPKeywordClass::Type}, {"operator", CPPKeywordClass::Type}, {"register", CPPKeywordClass::Type},
+    {"reinterpret_cast", CPPKeywordClass::Type}, {"requires", CPPKeywordClass::Type},
+    {"return", CPPKeywordClass::Type}, {"short", CPPKeywordClass::Type}, {"signed", CPPKeywordClass::Type},
+    {"sizeof", CPPKeywordClass::Type}, {"static", CPPKeywordClass::Type}, {"static_assert", CPPKeywordClass::Type},
+    {"static_cast", CPPKeywordClass::Type}, {"struct", CPPKeywordClass::Type}, {"template", CPPKeywordClass::Type},
+    {"this", CPPKeywordClass::Type}, {"thread_local", CPPKeywordClass::Type}, {"throw", CPPKeywordClass::Type},
+    {"true", CPPKeywordClass::Type}, {"typedef", CPPKeywordClass::Type}, {"typeid", CPPKeywordClass::Type},
+    {"typename", CPPKeywordClass::Type}, {"union", CPPKeywordClass::Type}, {"unsigned", CPPKeywordClass::Type},
+    {"using", CPPKeywordClass::Type}, {"virtual", CPPKeywordClass::Type}, {"void", CPPKeywordClass::Type},
+    {"volatile", CPPKeywordClass::Type}, {"wchar_t", CPPKeywordClass::Type},
+
+    {"if", CPPKeywordClass::Statement}, {"for", CPPKeywordClass::Statement}, {"switch", CPPKeywordClass::Statement},
+    {"do", CPPKeywordClass::Statement}, {"while", CPPKeywordClass::Statement}, {"else", CPPKeywordClass::Statement},
+    {"and", CPPKeywordClass::Statement}, {"and_eq", CPPKeywordClass::Statement}, {"xor", CPPKeywordClass::Statement},
+    {"xor_eq", CPPKeywordClass::Statement}, {"or", CPPKeywordClass::Statement}, {"or_eq", CPPKeywordClass::Statement},
+    {"not", CPPKeywordClass::Statement}, {"not_eq", CPPKeywordClass::Statement}, {"break", CPPKeywordClass::Statement},
+    {"case", CPPKeywordClass::Statement}, {"catch", CPPKeywordClass::Statement}, {"try", CPPKeywordClass::Statement},
+    {"const", CPPKeywordClass::Statement}, {"constexpr", CPPKeywordClass::Statement},
+    {"const_cast", CPPKeywordClass::Statement}, {"continue", CPPKeywordClass::Statement},
+
+    {"private", CPPKeywordClass::AccessSpecifier}, {"protected", CPPKeywordClass::AccessSpecifier},
+    {"public", CPPKeywordClass::AccessSpecifier}
+  };
+
+  constexpr size_t KEYWORD_COUNT = sizeof(keywords) / sizeof(keywords[0]);
+  constexpr size_t MIN_LENGTH = 2;
+  constexpr size_t MAX_LENGTH = 16;
+
+  // Mixes the length and five characters of a word. The multiplier was picked (by trying them in
+  // order) as the first one giving no collisions among the keywords: the static_assert below
+  // verifies it, a new keyword might require a different one
+  constexpr uint32_t HASH_MULTIPLIER = 1940;
+  constexpr unsigned HASH_BITS = 9;
+
+  constexpr uint32_t hash(const char *text, size_t length) {
+    uint32_t h = static_cast<uint32_t>(length);
+    h = h * HASH_MULTIPLIER + static_cast<unsigned char>(text[0]);
+    h = h * HASH_MULTIPLIER + static_cast<unsigned char>(text[1]);
+    h = h * HASH_MULTIPLIER + static_cast<unsigned char>(text[length / 2]);
+    h = h * HASH_MULTIPLIER + static_cast<unsigned char>(text[length - 2]);
+    h = h * HASH_MULTIPLIER + static_cast<unsigned char>(text[length - 1]);
+    return (h * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  constexpr size_t length(const char *text) {
+    size_t n = 0;
+    while (text[n] != '\0')
+      ++n;
+    return n;
+  }
+
+  struct Table {
+    uint8_t buckets[1u << HASH_BITS]; // Index + 1 of the keyword hashing to a bucket, 0 if none
+    uint8_t lengths[KEYWORD_COUNT];
+    bool collisions;
+  };
+
+  constexpr Table makeTable() {
+    Table t{};
+    for (size_t i = 0; i < KEYWORD_COUNT; ++i) {
+      size_t n = length(keywords[i].text);
+      t.lengths[i] = static_cast<uint8_t>(n);
+      uint32_t slot = hash(keywords[i].text, n);
+      if (t.buckets[slot] != 0 || n < MIN_LENGTH || n > MAX_LENGTH)
+        t.collisions = true;
+      t.buckets[slot] = static_cast<uint8_t>(i + 1);
+    }
+    return t;
+  }
+
+  constexpr Table table = makeTable();
+  static_assert(!table.collisions, "The keywords hash isn't perfect anymore, change HASH_MULTIPLIER");
+
+} // namespace CPPKeywords
+
+inline CPPKeywordClass classifyCPPKeyword(const char *text, size_t length) {
+  using namespace CPPKeywords;
+  if (length < MIN_LENGTH || length > MAX_LENGTH)
+    return CPPKeywordClass::None;
+  uint8_t slot = table.buckets[hash(text, length)];
+  if (slot == 0 || table.lengths[slot - 1] != length)
+    return CPPKeywordClass::None;
+  const char *keyword = keywords[slot - 1].text;
+  for (size_t i = 0; i < length; ++i) {
+    if (text[i] != keyword[i])
+      return CPPKeywordClass::None;
+  }
+  return keywords[slot - 1].keywordClass;
+}
+
+#endif // CPPKEYWORDS_H
@@ -1,9 +1,25 @@
 #include <UI/CodeTextEdit/Lexers/CPPLexer.h>
-#include <regex>
+#include <UI/CodeTextEdit/Lexers/NumericLiteral.h>
+#include <UI/CodeTextEdit/Lexers/CPPKeywords.h>
+#include <algorithm>
+#include <cstring>
 #include <QDebug>
 
 namespace { // Functions reserved for this TU's internal use
 
+  bool isIdentifierCharacter(const char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+  }
+
+  // Matches \bQ[A-Za-z]+\b, as the regular expression the highlighter used to have
+  bool isQtClassName(const std::string& identifier) {
+    if (identifier.size() < 2 || identifier[0] != 'Q')
+      return false;
+    return std::all_of(identifier.begin() + 1, identifier.end(), [](char c) {
+      return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+    });
+  }
+
   // Detects if a token is a whitespace or newline character
   bool isWhitespace(const QChar c) {
     if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
@@ -12,104 +28,11 @@ namespace { // Functions reserved for this TU's internal use
       return false;
   }
 
-  void populateReservedKeywords (std::unordered_set<std::string>& set) {
-    set.emplace( "alignas" );
-    set.emplace( "alignof" );
-    set.emplace( "and" );
-    set.emplace( "and_eq" );
-    set.emplace( "asm" );
-    set.emplace( "auto" );
-    set.emplace( "bitand" );
-    set.emplace( "bitor" );
-    set.emplace( "bool" );
-    set.emplace( "break" );
-    set.emplace( "case" );
-    set.emplace( "catch" );
-    set.emplace( "char" );
-    set.emplace( "char16_t" );
-    set.emplace( "char32_t" );
-    set.emplace( "class" );
-    set.emplace( "compl" );
-    set.emplace( "concept" );
-    set.emplace( "const" );
-    set.emplace( "constexpr" );
-    set.emplace( "const_cast" );
-    set.emplace( "continue" );
-    set.emplace( "decltype" );
-    set.emplace( "default" );
-    set.emplace( "delete" );
-    set.emplace( "do" );
-    set.emplace( "double" );
-    set.emplace( "dynamic_cast" );
-    set.emplace( "else" );
-    set.emplace( "enum" );
-    set.emplace( "explicit" );
-    set.emplace( "export" );
-    set.emplace( "extern" );
-    set.emplace( "false" );
-    set.emplace( "float" );
-    set.emplace( "for" );
-    set.emplace( "friend" );
-    set.emplace( "goto" );
-    set.emplace( "if" );
-    set.emplace( "inline" );
-    set.emplace( "int" );
-    set.emplace( "long" );
-    set.emplace( "mutable" );
-    set.emplace( "namespace" );
-    set.emplace( "new" );
-    set.emplace( "noexcept" );
-    set.emplace( "not" );
-    set.emplace( "not_eq" );
-    set.emplace( "nullptr" );
-    set.emplace( "operator" );
-    set.emplace( "or" );
-    set.emplace( "or_eq" );
-    set.emplace( "private" );
-    set.emplace( "protected" );
-    set.emplace( "public" );
-    set.emplace( "register" );
-    set.emplace( "reinterpret_cast" );
-    set.emplace( "requires" );
-    set.emplace( "return" );
-    set.emplace( "short" );
-    set.emplace( "signed" );
-    set.emplace( "sizeof" );
-    set.emplace( "static" );
-    set.emplace( "static_assert" );
-    set.emplace( "static_cast" );
-    set.emplace( "struct" );
-    set.emplace( "switch" );
-    set.emplace( "template" );
-    set.emplace( "this" );
-    set.emplace( "thread_local" );
-    set.emplace( "throw" );
-    set.emplace( "true" );
-    set.emplace( "try" );
-    set.emplace( "typedef" );
-    set.emplace( "typeid" );
-    set.emplace( "typename" );
-    set.emplace( "union" );
-    set.emplace( "unsigned" );
-    set.emplace( "using" );
-    set.emplace( "virtual" );
-    set.emplace( "void" );
-    set.emplace( "volatile" );
-    set.emplace( "wchar_t" );
-    set.emplace( "while" );
-    set.emplace( "xor" );
-    set.emplace( "xor_eq" );
-    set.emplace( "nullptr" );
-  }
-
-
-
 }
 
 CPPLexer::CPPLexer() :
   LexerBase(CPPLexerType)
 {
-  populateReservedKeywords (m_reservedKeywords);
   m_classKeywordActiveOnScope = -2;
 }
 
@@ -121,12 +44,15 @@ void CPPLexer::reset() {
   m_adaptPreviousSegments.clear();
 }
 
-void CPPLexer::lexInput(std::string input, StyleDatabase& sdb) {
+void CPPLexer::lex(const LexerInput& input, const LexingStart& start, const CheckpointSource *previous,
+                   StylePatch& patch) {
 
   str = &input;
-  sdb.styleSegment.clear(); // Relex everything // TODO - lex from a position forward?
-  styleDb = &sdb;
-  pos = 0;
+  styles = &patch;
+  m_previous = previous;
+  m_convergeFrom = start.convergeFrom;
+  patch.begin(input, start);
+  restoreCheckpoint(start);
 
   try {
     globalScope();
@@ -134,6 +60,53 @@ void CPPLexer::lexInput(std::string input, StyleDatabase& sdb) {
   catch (std::out_of_range&) {
     // qDebug() << "Parsing terminated!";
   }
+
+  if (!patch.endsAtCheckpoint())
+    patch.finish(input); // Reached EOF: everything after the start has been lexed
+}
+
+
+//==---------------------------------------------------------------------------==//
+//                        Incremental lexing support                             //
+//==---------------------------------------------------------------------------==//
+
+
+void CPPLexer::restoreCheckpoint(const LexingStart& start) {
+  reset();
+  // Scopes are numbered after their depth, the stack can be rebuilt from its size alone
+  for (int i = 0; i < start.checkpoint.scopeDepth; ++i)
+    m_scopesStack.push(i);
+  m_classKeywordActiveOnScope = start.checkpoint.classScope;
+  pos = start.position;
+  m_scannedForNewlinesUpTo = pos;
+  m_runsAtCheckpoint = 0;
+}
+
+// Called at every token boundary in the global scope: if a newline was crossed since the last
+// call, stores the lexer state. Returns true if lexing can stop since the rest of the previous
+// lexing results are still valid
+bool CPPLexer::recordCheckpoint() {
+  const size_t from = m_scannedForNewlinesUpTo;
+  m_scannedForNewlinesUpTo = pos;
+  if (pos <= from || !str->contains('\n', from, pos))
+    return false; // Still on the same line
+
+  // Segments linked by '::' might still be restyled and a leading '::' links to the previous line
+  if (!m_adaptPreviousSegments.empty() || str->at(pos) == ':')
+    return false;
+
+  const size_t line = styles->lineAt(*str, pos);
+  LexerCheckpoint checkpoint;
+  checkpoint.column = static_cast<uint32_t>(pos - styles->lineStart());
+  checkpoint.scopeDepth = static_cast<int>(m_scopesStack.size());
+  checkpoint.classScope = m_classKeywordActiveOnScope;
+  styles->setCheckpoint(checkpoint);
+  m_runsAtCheckpoint = styles->runCount();
+  if (m_previous != nullptr && pos >= m_convergeFrom && m_previous->checkpoint(line) == checkpoint) {
+    styles->converge();
+    return true;
+  }
+  return false;
 }
 
 
@@ -142,9 +115,9 @@ void CPPLexer::lexInput(std::string input, StyleDatabase& sdb) {
 //==---------------------------------------------------------------------------==//
 
 
-// Utility function: adds a segment to the style database
+// Utility function: adds a segment to the styles being found
 void CPPLexer::addSegment(size_t pos, size_t len, Style style) {
-  styleDb->styleSegment.emplace_back(pos, len, style);
+  styles->addSegment(*str, pos, len, style);
 }
 
 void CPPLexer::classDeclarationOrDefinition() {
@@ -159,48 +132,51 @@ void CPPLexer::declarationOrDefinition() { // A scope declaration or definition
     pos++;
   }
 
-  // Handle any keyword or identifier until a terminator character
+  // Handle any keyword, identifier or literal until a terminator character
   bool foundSegment = false;
   size_t startSegment = pos;
-  while (    (str->at(pos) >= '0' && str->at(pos) <= '9')
-          || (str->at(pos) >= 'A' && str->at(pos) <= 'Z')
-          || (str->at(pos) >= 'a' && str->at(pos) <= 'z')
-          ||  str->at(pos) == '_') {
-    pos++;
-  }
-  if (pos > startSegment) { // We found something
-    Style s = Normal;
-
-    // It might be a reserved keyword
-    std::string segment = str->substr(startSegment, pos - startSegment);
-    if (m_reservedKeywords.find(segment) != m_reservedKeywords.end()) {
-      // For purely aesthetic reasons, style the keywords which aren't private/protected/public
-      // in an inner scope with a different style
-      if (m_scopesStack.size() > 0 && segment.compare("protected") != 0
-          && segment.compare("private") != 0 && segment.compare("public") != 0)
-        s = KeywordInnerScope;
-      else
-        s = Keyword;
-      if ( (segment.compare("class") == 0 || segment.compare("struct") == 0) &&
-           m_classKeywordActiveOnScope == -2 /* No inner class support for now */)
-        m_classKeywordActiveOnScope = -1; // We keep track of this since a class scope is *not* a local
-        // scope, but rather should be treated as the global scope. If we encounter a ';' before any '{', this
-        // value gets back to -2, i.e. 'no class keyword active'. If we join a scope, this gets set to the
-        // scope number and from that point forward whenever we're in that scope, no function call can be
-        // used (only declarations). If we pop out of that function scope, it returns to -2.
-    } else {
+  if (str->at(pos) >= '0' && str->at(pos) <= '9') {
 
-      // Or perhaps a literal (e.g. 11)
-      std::regex lit("\\d+[uUlL]?[ull]?[ULL]?[UL]?[ul]?[ll]?[LL]?");
-      std::regex lit2("0[xbX][\\da-fA-F]+");
-      if(std::regex_match(segment, lit) || std::regex_match(segment, lit2))
-        s = Literal;
-
-    }
+    // A numeric literal (e.g. 11, 0x1F or 1.5e3f). Malformed ones are given a regular style
+    Style s = Literal;
+    if (scanNumericLiteral(*str, pos) == NumericLiteralKind::Invalid)
+      s = Normal;
 
-    // Assign a Keyword or Normal style and later, if we find (, make it a function declaration
     addSegment(startSegment, pos - startSegment, s);
     foundSegment = true;
+  } else {
+
+    std::string& segment = m_token;
+    segment.clear();
+    for (char c = str->at(pos); isIdentifierCharacter(c); c = str->at(++pos))
+      segment.push_back(c);
+    if (pos > startSegment) { // We found something
+      Style s = Normal;
+
+      // It might be a reserved keyword
+      CPPKeywordClass keywordClass = classifyCPPKeyword(segment.data(), segment.size());
+      if (keywordClass != CPPKeywordClass::None) {
+        // For purely aesthetic reasons, style the keywords which aren't private/protected/public
+        // in an inner scope with a different style
+        if (m_scopesStack.size() > 0 && keywordClass != CPPKeywordClass::AccessSpecifier)
+          s = KeywordInnerScope;
+        else
+          s = Keyword;
+        if ( (segment.compare("class") == 0 || segment.compare("struct") == 0) &&
+             m_classKeywordActiveOnScope == -2 /* No inner class support for now */)
+          m_classKeywordActiveOnScope = -1; // We keep track of this since a class scope is *not* a local
+          // scope, but rather should be treated as the global scope. If we encounter a ';' before any '{', this
+          // value gets back to -2, i.e. 'no class keyword active'. If we join a scope, this gets set to the
+          // scope number and from that point forward whenever we're in that scope, no function call can be
+          // used (only declarations). If we pop out of that function scope, it returns to -2.
+      } else if (isQtClassName(segment)) {
+        s = CPP_QtClass;
+      }
+
+      // Assign a Keyword or Normal style and later, if we find (, make it a function declaration
+      addSegment(startSegment, pos - startSegment, s);
+      foundSegment = true;
+    }
   }
   // Skip whitespaces and stuff that we're not interested in
   while (str->at(pos) == ' ' || str->at(pos) == '\t' || str->at(pos) == '\r' || str->at(pos) == '\n') {
@@ -212,23 +188,23 @@ void CPPLexer::declarationOrDefinition() { // A scope declaration or definition
     // Check for the scopes stack and, if we're not in a global scope, mark this as function call.
     // Notice that class member functions aren't marked as function calls but rather as identifiers.
     if (foundSegment && !m_scopesStack.empty() && m_classKeywordActiveOnScope != m_scopesStack.top() &&
-        styleDb->styleSegment[styleDb->styleSegment.size()-1].style != Keyword) {
+        styles->style(styles->runCount()-1) != Keyword) {
 
-      styleDb->styleSegment[styleDb->styleSegment.size()-1].style = FunctionCall;
+      styles->setStyle(styles->runCount()-1, FunctionCall);
 
       // Also set the same style for all the linked previous segments
       for(auto i : m_adaptPreviousSegments)
-        styleDb->styleSegment[i].style = FunctionCall;
+        styles->setStyle(i, FunctionCall);
       m_adaptPreviousSegments.clear();
 
     } else if (foundSegment && (m_scopesStack.empty() || m_classKeywordActiveOnScope == m_scopesStack.top() ) &&
-             styleDb->styleSegment[styleDb->styleSegment.size()-1].style != Keyword) {
+             styles->style(styles->runCount()-1) != Keyword) {
 
-      styleDb->styleSegment[styleDb->styleSegment.size()-1].style = Identifier;
+      styles->setStyle(styles->runCount()-1, Identifier);
 
       // Also set the same style for all the linked previous segments
       for(auto i : m_adaptPreviousSegments)
-        styleDb->styleSegment[i].style = Identifier;
+        styles->setStyle(i, Identifier);
       m_adaptPreviousSegments.clear();
     }
 
@@ -236,8 +212,8 @@ void CPPLexer::declarationOrDefinition() { // A scope declaration or definition
   }
 
   if (str->at(pos) == ':' && str->at(pos+1) == ':') { // :: makes the previous segment part of the new one
-    if (styleDb->styleSegment.size() > 0)
-      m_adaptPreviousSegments.push_back(static_cast<int>(styleDb->styleSegment.size())-1);
+    if (styles->runCount() > m_runsAtCheckpoint) // Never a segment before the last checkpoint
+      m_adaptPreviousSegments.push_back(static_cast<int>(styles->runCount())-1);
   }
 
   if (foundSegment == false) { // We couldn't find a normal identifier
@@ -263,8 +239,8 @@ void CPPLexer::declarationOrDefinition() { // A scope declaration or definition
       // A quoted string
       char startCharacter = str->at(pos);
       startSegment = pos++;
-      while(str->at(pos) != startCharacter)
-        ++pos;
+      pos = str->find(startCharacter, pos);
+      str->at(pos); // Throws at EOF
       pos++; // Include the terminal character
 
       addSegment(startSegment, pos - startSegment, QuotedString);
@@ -350,9 +326,9 @@ void CPPLexer::declarationOrDefinition() { // A scope declaration or definition
 
 //      // This also means the previous segment was a declaration or a function call (if we're inside a function)
 //      if (foundSegment && m_scopesStack.empty())
-//        styleDb->styleSegment[styleDb->styleSegment.size()-1].style = Identifier;
+//        styles->styleSegment[styles->styleSegment.size()-1].style = Identifier;
 //      else if (foundSegment) // We're in an inner scope
-//        styleDb->styleSegment[styleDb->styleSegment.size()-1].style = FunctionCall;
+//        styles->styleSegment[styles->styleSegment.size()-1].style = FunctionCall;
 
 //      while (str->at(pos) != ')' && str->at(pos) != ';') {
 
@@ -441,7 +417,7 @@ void CPPLexer::defineStatement() {
 
 void CPPLexer::nondefinePreprocessorStatement() {
 
-    std::vector<std::string> preprocessorTokens = {
+    static const char *preprocessorTokens[] = {
       "if",
       "ifdef",
       "ifndef",
@@ -455,10 +431,11 @@ void CPPLexer::nondefinePreprocessorStatement() {
     ++pos;
 
     // Find a preprocessor keyword after the #
-    for (auto& token : preprocessorTokens) {
-      if (str->size() > pos + token.length() && (str->substr(pos, token.length()).compare(token) == 0)) {
-        addSegment(startSharp, 1 + token.length(), Keyword);
-        pos += token.length();
+    for (auto token : preprocessorTokens) {
+      size_t length = std::strlen(token);
+      if (str->size() > pos + length && str->compare(pos, token, length)) {
+        addSegment(startSharp, 1 + length, Keyword);
+        pos += length;
         break;
       }
     }
@@ -470,9 +447,8 @@ void CPPLexer::lineCommentStatement() {
   size_t startSegment = pos;
 
   // Skip everything until \n
-  while (str->at(pos) != '\n') {
-    pos++;
-  }
+  pos = str->find('\n', pos);
+  str->at(pos); // Throws at EOF
   ++pos; // Also add the newline
 
   addSegment(startSegment, pos - startSegment, Comment);
@@ -490,7 +466,7 @@ void CPPLexer::usingStatement() {
     pos++;
   }
 
-  if (str->substr(pos, 9).compare("namespace") == 0) {
+  if (str->compare(pos, "namespace")) {
     addSegment(pos, 9, Keyword); // namespace
     pos += 9;
   }
@@ -555,13 +531,14 @@ void CPPLexer::multilineComment() {
   pos += 2; // Add the '/*' characters
 
   // Ignore everything until a */ sequence
+  pos = str->find('*', pos);
   while (!(str->at(pos) == '*' && str->at(pos+1) == '/'))
-    pos++;
+    pos = str->find('*', pos + 1);
 
   // Add '*/'
   pos += 2;
 
-  addSegment(segmentStart, pos - segmentStart, Comment);
+  addSegment(segmentStart, pos - segmentStart, MultilineComment);
 
   return; // Return to whatever scope we were in
 }
@@ -577,6 +554,9 @@ void CPPLexer::globalScope() {
       pos++;
     }
 
+    if (recordCheckpoint())
+      return; // Converged with the previous lexing, nothing else changed
+
     if (str->at(pos) == '/' && str->at(pos + 1) == '*') { // Multiline C-style string
       multilineComment();
       continue;
@@ -587,12 +567,12 @@ void CPPLexer::globalScope() {
       continue;
     }
 
-    if (str->at(pos) == '#' && str->substr(pos + 1, 7).compare("include") == 0) { // #include
+    if (str->at(pos) == '#' && str->compare(pos + 1, "include")) { // #include
       includeStatement();
       continue;
     }
 
-    if (str->at(pos) == '#' && str->substr(pos + 1, 6).compare("define") == 0) { // #define
+    if (str->at(pos) == '#' && str->compare(pos + 1, "define")) { // #define
       defineStatement();
       continue;
     }
@@ -602,7 +582,7 @@ void CPPLexer::globalScope() {
       continue;
     }
 
-    if (str->substr(pos, 5).compare("using") == 0) { // using
+    if (str->compare(pos, "using")) { // using
       usingStatement();
       continue;
     }
@@ -2,33 +2,42 @@
 #define CPPLEXER_H
 
 #include <UI/CodeTextEdit/Lexers/Lexer.h>
-#include <unordered_set>
 #include <string>
 #include <stack>
+#include <cstddef>
 
 class CPPLexer : public LexerBase {
 public:
   CPPLexer();
 
   void reset() override;
-  void lexInput(std::string input, StyleDatabase& sdb) override;
+  void lex(const LexerInput& input, const LexingStart& start, const CheckpointSource *previous,
+           StylePatch& patch) override;
 
 private:
   //// States the lexer can find itself into
   //enum LexerStates {CODE, STRING, COMMENT, MULTILINECOMMENT, INCLUDE};
   //LexerStates m_state;
-  std::unordered_set<std::string> m_reservedKeywords;
   std::stack<int> m_scopesStack;
   int m_classKeywordActiveOnScope; // This signals that there's a 'class' keyword pending
   std::vector<int> m_adaptPreviousSegments;
+  std::string m_token; // Scratch storage for the identifier being lexed (reused to avoid allocations)
 
   // The contents of the document and the position we're lexing at
-  std::string *str;
+  const LexerInput *str;
   size_t pos;
-  StyleDatabase *styleDb;
+  StylePatch *styles;
 
   void addSegment(size_t pos, size_t len, Style style);
 
+  // Incremental lexing support
+  void restoreCheckpoint(const LexingStart& start);
+  bool recordCheckpoint();
+  size_t m_scannedForNewlinesUpTo; // Newlines before this offset have already been noticed
+  size_t m_runsAtCheckpoint; // Runs found before the last checkpoint: these are never restyled
+  const CheckpointSource *m_previous = nullptr; // The lexing to converge with, if any
+  size_t m_convergeFrom = 0;
+
   void classDeclarationOrDefinition();
   void declarationOrDefinition();
   void defineStatement();
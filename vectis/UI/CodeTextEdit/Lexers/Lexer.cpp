@@ -1,5 +1,6 @@
 #include <UI/CodeTextEdit/Lexers/Lexer.h>
 #include <UI/CodeTextEdit/Lexers/CPPLexer.h>
+#include <algorithm>
 
 SyntaxHighlight getSuggestedSyntaxHighlightFromExtension(QString extension) {
   static std::unordered_map<std::string, SyntaxHighlight> extensionToSyntaxHighlighting = {
@@ -19,6 +20,351 @@ SyntaxHighlight getSuggestedSyntaxHighlightFromExtension(QString extension) {
     return it->second;
 }
 
+//==---------------------------------------------------------------------------==//
+//                                Style patch                                    //
+//==---------------------------------------------------------------------------==//
+
+void StylePatch::begin(const LexerInput& input, const LexingStart& start) {
+  m_firstLine = start.line;
+  m_firstColumn = start.checkpoint.isValid() ? start.checkpoint.column : 0;
+  m_runs.clear();
+  m_lineFirstRun.assign(1, 0);
+  m_lineLength.clear();
+  m_checkpoints.assign(1, start.checkpoint);
+  m_endsAtCheckpoint = false;
+  m_lineStart = start.position - m_firstColumn;
+  m_nextNewline = input.find('\n', start.position);
+}
+
+void StylePatch::reserve(size_t runs, size_t lines) {
+  m_runs.reserve(runs);
+  m_lineFirstRun.reserve(lines);
+  m_lineLength.reserve(lines);
+  m_checkpoints.reserve(lines);
+}
+
+size_t StylePatch::lineAt(const LexerInput& input, size_t position) {
+  while (m_nextNewline < position) { // Every newline is looked for once
+    m_lineLength.push_back(static_cast<uint32_t>(m_nextNewline + 1 - m_lineStart));
+    m_lineStart = m_nextNewline + 1;
+    m_nextNewline = input.find('\n', m_lineStart);
+    m_lineFirstRun.push_back(static_cast<uint32_t>(runCount()));
+    m_checkpoints.push_back(LexerCheckpoint());
+  }
+  return m_firstLine + m_lineFirstRun.size() - 1;
+}
+
+// A segment which isn't in the current line, spans lines or is longer than 64K characters (or empty)
+void StylePatch::splitSegment(const LexerInput& input, size_t position, size_t length, Style style) {
+  const size_t end = position + length;
+  while (position < end) {
+    lineAt(input, position);
+    // A run per line (the newline belongs to the line it ends) and per 64K characters
+    const size_t pieceEnd = std::min(end, m_nextNewline + 1);
+    for (size_t count; position < pieceEnd; position += count) {
+      count = std::min<size_t>(pieceEnd - position, UINT16_MAX);
+      addRun(position, count, style);
+    }
+  }
+}
+
+void StylePatch::finish(const LexerInput& input) {
+  lineAt(input, input.size());
+  m_lineLength.push_back(static_cast<uint32_t>(input.size() - m_lineStart));
+}
+
+bool StylePatch::cutAtLastCheckpoint() {
+  size_t last = lineCount() - 1;
+  while (last > 0 && !m_checkpoints[last].isValid())
+    --last;
+  if (last == 0)
+    return false;
+  size_t end = m_lineFirstRun[last]; // The runs before the checkpoint were completely lexed
+  while (end < m_runs.size() && m_runs[end].start < m_checkpoints[last].column)
+    ++end;
+  m_runs.resize(end);
+  m_lineFirstRun.resize(last + 1);
+  m_checkpoints.resize(last + 1);
+  m_lineLength.resize(last);
+  m_endsAtCheckpoint = true;
+  return true;
+}
+
+
+//==---------------------------------------------------------------------------==//
+//                               Style database                                  //
+//==---------------------------------------------------------------------------==//
+
+StyleDatabase::Statistics StyleDatabase::statistics() const {
+  Statistics statistics;
+  statistics.lines = lineCount();
+  m_lines.forEach(0, m_lines.size(), [&](const Line& line) {
+    statistics.runs += line.runCount;
+  });
+  statistics.bytesUsed = statistics.lines * sizeof(Line) + statistics.runs * sizeof(LexerRun);
+  statistics.bytesReserved = statistics.lines * sizeof(Line);
+  for (const Block& block : m_blocks) {
+    if (block.lines > 0) {
+      statistics.bytesReserved += block.runs.capacity() * sizeof(LexerRun);
+      ++statistics.blocks;
+    }
+  }
+  return statistics;
+}
+
+void StyleDatabase::copyCheckpoints(size_t first, size_t last, CheckpointCopy& copy) const {
+  copy.firstLine = first;
+  copy.checkpoints.clear();
+  if (lineCount() == 0)
+    return;
+  last = std::min(last, lineCount() - 1);
+  if (first > last)
+    return;
+  copy.checkpoints.reserve(last - first + 1);
+  m_lines.forEach(static_cast<int>(first), static_cast<int>(last + 1), [&](const Line& line) {
+    copy.checkpoints.push_back(line.checkpoint);
+  });
+}
+
+void StyleDatabase::clear() {
+  m_lines.clear();
+  m_blocks.clear();
+  m_freeBlocks.clear();
+  restyledFrom = restyledTo = 0;
+}
+
+void StyleDatabase::reset(const LexerInput& input) {
+  clear();
+  std::vector<Line> lines;
+  size_t lineStart = 0;
+  for (size_t newline; (newline = input.find('\n', lineStart)) < input.size(); lineStart = newline + 1) {
+    lines.emplace_back();
+    lines.back().length = static_cast<uint32_t>(newline + 1 - lineStart);
+  }
+  lines.emplace_back();
+  lines.back().length = static_cast<uint32_t>(input.size() - lineStart);
+  m_lines.assign(std::move(lines));
+}
+
+void StyleDatabase::reserve(StylePatch& patch, size_t inputSize) const {
+  size_t runs = inputSize / 16;
+  if (m_lexedSize > 0)
+    runs = static_cast<size_t>(m_lexedRuns * (static_cast<double>(inputSize) / m_lexedSize));
+  const size_t lines = inputSize / 32;
+  patch.reserve(runs + runs / 8 + 16, lines + 16);
+}
+
+int StyleDatabase::newBlock(std::vector<LexerRun> runs) {
+  int block;
+  if (!m_freeBlocks.empty()) {
+    block = m_freeBlocks.back();
+    m_freeBlocks.pop_back();
+  } else {
+    block = static_cast<int>(m_blocks.size());
+    m_blocks.emplace_back();
+  }
+  m_blocks[block].runs = std::move(runs);
+  m_blocks[block].lines = 0;
+  return block;
+}
+
+void StyleDatabase::freeBlock(int block) {
+  std::vector<LexerRun>().swap(m_blocks[block].runs);
+  m_freeBlocks.push_back(block);
+}
+
+void StyleDatabase::releaseRuns(const Line& line) {
+  if (line.block >= 0 && --m_blocks[line.block].lines == 0)
+    freeBlock(line.block);
+}
+
+// Replaces the records of lines [first; first + removed) with the given ones, which already count
+// as users of their blocks
+void StyleDatabase::replaceLines(size_t first, size_t removed, const std::vector<Line>& lines) {
+  const int at = static_cast<int>(first);
+  const int common = static_cast<int>(std::min(removed, lines.size()));
+  for (int i = 0; i < common; ++i) {
+    releaseRuns(m_lines[at + i]);
+    m_lines.set(at + i, lines[i]);
+  }
+  for (int i = common; i < static_cast<int>(removed); ++i) {
+    releaseRuns(m_lines[at + common]);
+    m_lines.erase(at + common);
+  }
+  for (int i = common; i < static_cast<int>(lines.size()); ++i)
+    m_lines.insert(at + i, lines[i]);
+}
+
+void StyleDatabase::apply(StylePatch& patch) {
+  const size_t first = patch.firstLine();
+  const size_t count = patch.lineCount();
+  std::vector<LexerRun>& runs = patch.m_runs;
+  const size_t patchRuns = runs.size();
+  const bool filling = (first == 0 && lineCount() == 0);
+
+  // Where the runs of every line are in the vector: the first line keeps its runs before the
+  // start of the patch and the last one its runs past the checkpoint the patch ends at, these
+  // get a copy of their runs at the end of the vector
+  std::vector<std::pair<size_t, size_t>> ranges(count);
+  for (size_t i = 0; i < count; ++i) {
+    const size_t end = (i + 1 < count) ? patch.m_lineFirstRun[i + 1] : patchRuns;
+    ranges[i] = {patch.m_lineFirstRun[i], end - patch.m_lineFirstRun[i]};
+  }
+  auto rebuild = [&](size_t i, const Line& old, uint32_t before, uint32_t from) {
+    std::vector<LexerRun> merged;
+    for (const LexerRun *run = old.runs; run < old.runs + old.runCount; ++run) {
+      if (run->start < before)
+        merged.push_back(*run);
+    }
+    merged.insert(merged.end(), runs.begin() + static_cast<std::ptrdiff_t>(ranges[i].first),
+                  runs.begin() + static_cast<std::ptrdiff_t>(ranges[i].first + ranges[i].second));
+    for (const LexerRun *run = old.runs; run < old.runs + old.runCount; ++run) {
+      if (run->start >= from)
+        merged.push_back(*run);
+    }
+    ranges[i] = {runs.size(), merged.size()};
+    runs.insert(runs.end(), merged.begin(), merged.end());
+  };
+  if (!filling && patch.m_firstColumn > 0)
+    rebuild(0, line(first), patch.m_firstColumn, UINT32_MAX);
+  if (patch.endsAtCheckpoint())
+    rebuild(count - 1, line(first + count - 1), 0, patch.m_checkpoints.back().column);
+
+  std::vector<Line> lines(count);
+  const int block = newBlock(std::move(runs));
+  for (size_t i = 0; i < count; ++i) {
+    Line& lexed = lines[i];
+    if (ranges[i].second > 0) {
+      lexed.runs = m_blocks[block].runs.data() + ranges[i].first;
+      lexed.runCount = static_cast<uint32_t>(ranges[i].second);
+      lexed.block = block;
+      ++m_blocks[block].lines;
+    }
+    lexed.length = (i < patch.m_lineLength.size()) ? patch.m_lineLength[i] : line(first + i).length;
+    lexed.checkpoint = patch.m_checkpoints[i];
+  }
+  if (m_blocks[block].lines == 0) // Not even one run
+    freeBlock(block);
+
+  if (filling) {
+    m_lexedRuns = patchRuns;
+    m_lexedSize = 0;
+    for (const Line& lexed : lines)
+      m_lexedSize += lexed.length;
+    m_lines.assign(std::move(lines));
+  } else {
+    replaceLines(first, std::min(count, lineCount() - std::min(first, lineCount())), lines);
+  }
+  restyledFrom = first;
+  restyledTo = first + count - 1;
+}
+
+void StyleDatabase::applyEdit(const LexerInput& input, size_t offset, size_t removed, size_t added) {
+  (void)removed; // The text after the edit is the same: the lines it removed are the ones in excess
+  const size_t first = input.lineAt(offset);
+  const size_t last = input.lineAt(offset + added);
+  const size_t oldLast = last + lineCount() - input.lineCount();
+  const uint32_t column = static_cast<uint32_t>(offset - input.lineStart(first));
+  const uint32_t endColumn = static_cast<uint32_t>(offset + added - input.lineStart(last));
+  const Line& firstLine = line(first);
+  const Line& lastLine = line(oldLast);
+  const uint32_t lastLength = static_cast<uint32_t>(input.lineLength(last));
+  const uint32_t oldEndColumn = lastLine.length - (lastLength - endColumn);
+
+  std::vector<LexerRun> runs;
+  for (const LexerRun *run = firstLine.runs; run < firstLine.runs + firstLine.runCount; ++run) {
+    if (run->start + run->length <= column)
+      runs.push_back(*run);
+  }
+  const size_t prefixRuns = runs.size();
+  for (const LexerRun *run = lastLine.runs; run < lastLine.runs + lastLine.runCount; ++run) {
+    if (run->start >= oldEndColumn)
+      runs.push_back(LexerRun{run->start - oldEndColumn + endColumn, run->length, run->style});
+  }
+  LexerCheckpoint prefixCheckpoint, suffixCheckpoint;
+  if (firstLine.checkpoint.isValid() && firstLine.checkpoint.column < column)
+    prefixCheckpoint = firstLine.checkpoint;
+  if (lastLine.checkpoint.isValid() && lastLine.checkpoint.column >= oldEndColumn) {
+    suffixCheckpoint = lastLine.checkpoint;
+    suffixCheckpoint.column = suffixCheckpoint.column - oldEndColumn + endColumn;
+  }
+
+  std::vector<Line> lines(last - first + 1);
+  for (size_t i = 0; i < lines.size(); ++i)
+    lines[i].length = static_cast<uint32_t>(input.lineLength(first + i));
+  const int block = newBlock(std::move(runs));
+  const LexerRun *blockRuns = m_blocks[block].runs.data();
+  const size_t runCount = m_blocks[block].runs.size();
+  auto setRuns = [&](Line& lexed, size_t from, size_t to) {
+    if (from == to)
+      return;
+    lexed.runs = blockRuns + from;
+    lexed.runCount = static_cast<uint32_t>(to - from);
+    lexed.block = block;
+    ++m_blocks[block].lines;
+  };
+  if (lines.size() == 1) {
+    setRuns(lines[0], 0, runCount);
+    lines[0].checkpoint = prefixCheckpoint.isValid() ? prefixCheckpoint : suffixCheckpoint;
+  } else {
+    setRuns(lines.front(), 0, prefixRuns);
+    lines.front().checkpoint = prefixCheckpoint;
+    setRuns(lines.back(), prefixRuns, runCount);
+    lines.back().checkpoint = suffixCheckpoint;
+  }
+  if (m_blocks[block].lines == 0)
+    freeBlock(block);
+  replaceLines(first, oldLast - first + 1, lines);
+}
+
+LexingStart StyleDatabase::resumePoint(const LexerInput& input, size_t offset, size_t added) const {
+  LexingStart start;
+  start.convergeFrom = offset + added;
+
+  // The last checkpoint before the edit, stepping one more back: a few tokens look ahead past
+  // their end (e.g. an identifier followed by '(' on the next line)
+  const size_t line = input.lineAt(offset);
+  const LexerCheckpoint& checkpoint = this->line(line).checkpoint;
+  int before = m_lines.weightBefore(static_cast<int>(line));
+  if (checkpoint.isValid() && checkpoint.column < offset - input.lineStart(line))
+    ++before;
+  if (before < 2)
+    return start; // From the start of the input
+  start.line = static_cast<size_t>(m_lines.indexAtWeight(before - 2));
+  start.checkpoint = this->line(start.line).checkpoint;
+  start.position = input.lineStart(start.line) + start.checkpoint.column;
+  return start;
+}
+
+
+//==---------------------------------------------------------------------------==//
+//                                   Lexers                                      //
+//==---------------------------------------------------------------------------==//
+
+void LexerBase::lexInput(const LexerInput& input, StyleDatabase& sdb) {
+  StylePatch patch;
+  sdb.reserve(patch, input.size());
+  lex(input, LexingStart(), nullptr, patch);
+  sdb.clear();
+  sdb.apply(patch);
+}
+
+void LexerBase::relexInput(const LexerInput& input, StyleDatabase& sdb, size_t offset, size_t removed, size_t added) {
+  if (sdb.lineCount() + input.lineAt(offset + added) < input.lineCount() + input.lineAt(offset)) {
+    lexInput(input, sdb); // Never lexed, or not the lexing of the input before the edit
+    return;
+  }
+  sdb.applyEdit(input, offset, removed, added);
+  relexEdit(input, sdb, offset, added);
+}
+
+void LexerBase::relexEdit(const LexerInput& input, StyleDatabase& sdb, size_t offset, size_t added) {
+  // A lexing might converge within a later edit, at a checkpoint before it: that edit is relexed next
+  StylePatch patch;
+  lex(input, sdb.resumePoint(input, offset, added), &sdb, patch);
+  sdb.apply(patch);
+}
+
 LexerBase* LexerBase::createLexerOfType(LexerType t) {
   switch(t) {
     case CPPLexerType: {
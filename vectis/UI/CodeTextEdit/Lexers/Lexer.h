@@ -1,7 +1,11 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <UI/CodeTextEdit/Lexers/LexerInput.h>
+#include <UI/CodeTextEdit/ChunkedSequence.h>
 #include <QString>
+#include <memory>
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -26,25 +30,207 @@ enum Style {
   Keyword,
   KeywordInnerScope,
   Comment,
+  MultilineComment,
   QuotedString,
   Identifier, // E.g. a function name (fully qualified or unqualified) or a macro
   FunctionCall,
   Literal,
 
   //==-- C++ specific styles --==//
-  CPP_include
+  CPP_include,
+  CPP_QtClass // A name as Qt gives its classes, e.g. QString
 };
 
-struct StyleDatabase {
-  struct StyleSegment {
-    StyleSegment(size_t s, size_t c, Style st) : start(s), count(c), style(st) {}
-    size_t start;
-    size_t count;
-    Style style;
+// A snapshot of a lexer's state taken at the first token it finds in a line. Lexing can be
+// resumed from here as if the whole input up to this point had just been lexed. Comments and
+// strings are always consumed as a whole, so a checkpoint can never be inside one of them
+struct LexerCheckpoint {
+  static const uint32_t NONE = UINT32_MAX;
+
+  uint32_t column = NONE; // Of the token in its line, NONE if the line has no checkpoint
+  int scopeDepth = 0;
+  int classScope = -2;    // Scope where a 'class' keyword is active (if any)
+
+  bool isValid() const { return column != NONE; }
+  bool operator==(const LexerCheckpoint& other) const {
+    return column == other.column && scopeDepth == other.scopeDepth && classScope == other.classScope;
+  }
+};
+
+// Characters of a line with the same style. A segment spanning several lines, or longer than 64K
+// characters, takes a run per piece
+struct LexerRun {
+  uint32_t start; // From the start of the line
+  uint16_t length;
+  uint8_t style;  // A Style
+};
+
+// Where lexing starts: the start of the input, or the checkpoint of a line
+struct LexingStart {
+  size_t line = 0;
+  size_t position = 0;        // Of the checkpoint in the input
+  LexerCheckpoint checkpoint; // Not valid at the start of the input
+  size_t convergeFrom = 0;    // Lexing can't stop before this position (the end of an edit)
+};
+
+// Checkpoints of a previous lexing: a relexing compares its own with them, once they match past
+// the edit the rest of the previous results are still valid
+class CheckpointSource {
+public:
+  virtual ~CheckpointSource() = default;
+  virtual LexerCheckpoint checkpoint(size_t line) const = 0;
+};
+
+// Checkpoints of lines [firstLine; firstLine + checkpoints.size()) copied out of a StyleDatabase,
+// for a lexer working on a copy of part of the input in another thread
+class CheckpointCopy : public CheckpointSource {
+public:
+  LexerCheckpoint checkpoint(size_t line) const override {
+    return (line >= firstLine && line - firstLine < checkpoints.size()) ? checkpoints[line - firstLine]
+                                                                         : LexerCheckpoint();
+  }
+
+  size_t firstLine = 0;
+  std::vector<LexerCheckpoint> checkpoints;
+};
+
+// The styles a lexer found from a line on, up to the end of the input or up to a checkpoint (the
+// one it converged at, or the last one before the end of a partial input): this is what a lexing
+// produces before it is applied to a StyleDatabase. Runs are stored line after line in a single vector
+class StylePatch {
+public:
+  // Empties the patch before lexing from start
+  void begin(const LexerInput& input, const LexingStart& start);
+  void reserve(size_t runs, size_t lines);
+
+  size_t firstLine() const { return m_firstLine; }
+  size_t lineCount() const { return m_lineFirstRun.size(); }
+  // Whether the runs of the last line past its checkpoint, and the lines after it, aren't in the patch
+  bool endsAtCheckpoint() const { return m_endsAtCheckpoint; }
+
+  size_t runCount() const { return m_runs.size(); }
+  Style style(size_t run) const { return static_cast<Style>(m_runs[run].style); }
+  void setStyle(size_t run, Style style) { m_runs[run].style = static_cast<uint8_t>(style); }
+
+  // Segments are added by lexers in order of position
+  void addSegment(const LexerInput& input, size_t position, size_t length, Style style) {
+    if (position <= m_nextNewline && position + length <= m_nextNewline + 1 && length - 1 < UINT16_MAX)
+      addRun(position, length, style); // Within the current line, as most are
+    else
+      splitSegment(input, position, length, style);
+  }
+  // Line of a position past every segment added so far, and where that line starts
+  size_t lineAt(const LexerInput& input, size_t position);
+  size_t lineStart() const { return m_lineStart; }
+  // Sets the checkpoint of the current line (the one of the last lineAt())
+  void setCheckpoint(const LexerCheckpoint& checkpoint) { m_checkpoints.back() = checkpoint; }
+  // The lexer got back to the state the previous lexing had at the checkpoint of the current line:
+  // the runs of that line from there on, and the lines after it, are still valid
+  void converge() { m_endsAtCheckpoint = true; }
+  // Adds the lines up to the end of the input, which the lexer reached
+  void finish(const LexerInput& input);
+  // The input was only part of the text (the rest is yet to be lexed): drops what was found after
+  // the last checkpoint past the first line, so that the patch ends there. Returns false if there
+  // is no such checkpoint (nothing would be left)
+  bool cutAtLastCheckpoint();
+  // Where the patch ends, if it ends at a checkpoint
+  size_t lastLine() const { return m_firstLine + lineCount() - 1; }
+  uint32_t lastColumn() const { return m_checkpoints.back().column; }
+
+private:
+  friend class StyleDatabase;
+
+  void addRun(size_t position, size_t length, Style style) {
+    m_runs.push_back(LexerRun{static_cast<uint32_t>(position - m_lineStart), static_cast<uint16_t>(length),
+                              static_cast<uint8_t>(style)});
+  }
+  void splitSegment(const LexerInput& input, size_t position, size_t length, Style style);
+
+  size_t m_firstLine = 0;
+  uint32_t m_firstColumn = 0; // The runs of the first line before it are the ones already in the database
+  std::vector<LexerRun> m_runs;
+  std::vector<uint32_t> m_lineFirstRun;
+  std::vector<uint32_t> m_lineLength; // Every line but the last one if the patch ends at a checkpoint
+  std::vector<LexerCheckpoint> m_checkpoints;
+  bool m_endsAtCheckpoint = false;
+  // Where the current line (the last one) begins and ends
+  size_t m_lineStart = 0;
+  size_t m_nextNewline = 0;
+};
+
+// The styles found by a lexer, as runs of characters within a line, and the checkpoints lexing can
+// be resumed from. Every line has a record pointing to its runs, kept in a ChunkedSequence: the
+// styles of the lines on screen are a direct lookup, and an edit only touches the records of the
+// lines it spans (the runs of the first and the last one are rebased) however big the document is.
+//
+// Runs stay in the vector of the StylePatch they were found in, which the database takes over
+// instead of copying them. A vector is freed as soon as none of the lines uses it anymore (they
+// were lexed again or removed)
+class StyleDatabase : public CheckpointSource {
+public:
+  struct Line {
+    const LexerRun *runs = nullptr;
+    uint32_t runCount = 0;
+    int block = -1;      // The vector runs point into
+    uint32_t length = 0; // Characters (including the newline) when the line was lexed
+    LexerCheckpoint checkpoint;
+  };
+  struct Statistics {
+    size_t lines = 0;
+    size_t runs = 0;       // Of the lines, the vectors might hold more (from lines lexed again)
+    size_t bytesUsed = 0;  // By the line records and their runs
+    size_t bytesReserved = 0;
+    size_t blocks = 0;
   };
 
-  // Stores the beginning and count of characters per each styled segment
-  std::vector<StyleSegment> styleSegment;
+  size_t lineCount() const { return static_cast<size_t>(m_lines.size()); }
+  const Line& line(size_t line) const { return m_lines[static_cast<int>(line)]; }
+  LexerCheckpoint checkpoint(size_t line) const override {
+    return (line < lineCount()) ? m_lines[static_cast<int>(line)].checkpoint : LexerCheckpoint();
+  }
+  Statistics statistics() const;
+  // Copies the checkpoints of lines [first; last]
+  void copyCheckpoints(size_t first, size_t last, CheckpointCopy& copy) const;
+
+  void clear();
+  // Every line of the input, with no runs and no checkpoints: nothing was lexed yet
+  void reset(const LexerInput& input);
+  // Reserves room in the patch of a lexing of the whole input from how dense the previous one was
+  // (or typical C++ code, the first time)
+  void reserve(StylePatch& patch, size_t inputSize) const;
+  // Replaces the lines [patch.firstLine(); patch.firstLine() + patch.lineCount()) with the ones
+  // of the patch. A patch starting at line 0 of an empty database fills it
+  void apply(StylePatch& patch);
+  // Rebases the lines spanned by an edit (in the input after it) which replaced 'removed'
+  // characters at 'offset' with 'added' new ones: the runs and the checkpoint before the edit are
+  // kept, the ones after it are shifted and the lines in between are left empty
+  void applyEdit(const LexerInput& input, size_t offset, size_t removed, size_t added);
+  // Where lexing has to be resumed from after such an edit
+  LexingStart resumePoint(const LexerInput& input, size_t offset, size_t added) const;
+
+  // The lines [restyledFrom; restyledTo] whose runs the last (re)lexing might have changed
+  size_t restyledFrom = 0;
+  size_t restyledTo = 0;
+
+private:
+  struct HasCheckpoint {
+    int operator()(const Line& line) const { return line.checkpoint.isValid() ? 1 : 0; }
+  };
+  struct Block {
+    std::vector<LexerRun> runs;
+    int lines = 0;
+  };
+
+  int newBlock(std::vector<LexerRun> runs);
+  void freeBlock(int block);
+  void releaseRuns(const Line& line);
+  void replaceLines(size_t first, size_t removed, const std::vector<Line>& lines);
+
+  ChunkedSequence<Line, HasCheckpoint> m_lines; // Checkpoints are counted to find them in O(log n)
+  std::vector<Block> m_blocks; // The slots of the freed ones are reused
+  std::vector<int> m_freeBlocks;
+  size_t m_lexedSize = 0; // Of the input and of the results of the last lexing of a whole input
+  size_t m_lexedRuns = 0;
 };
 
 // An abstract base class for all the Lexers to implement
@@ -57,7 +243,19 @@ public:
   static LexerBase *createLexerOfType(LexerType t);
 
   virtual void reset() = 0;
-  virtual void lexInput(std::string input, StyleDatabase& sdb) = 0;
+  // Lexes the input from start into patch, until its end or until the lexer gets back to a state
+  // the previous lexing had reached past start.convergeFrom (if there's a previous lexing)
+  virtual void lex(const LexerInput& input, const LexingStart& start, const CheckpointSource *previous,
+                   StylePatch& patch) = 0;
+
+  void lexInput(const LexerInput& input, StyleDatabase& sdb);
+  // Lexes the input again after an edit replaced 'removed' characters at 'offset' with 'added'
+  // new ones, from a checkpoint before the edit until the lexer converges with the previous
+  // results. sdb must contain the results of lexing the input before the edit
+  void relexInput(const LexerInput& input, StyleDatabase& sdb, size_t offset, size_t removed, size_t added);
+  // Same as above for an edit already applied to sdb (see StyleDatabase::applyEdit()): edits made
+  // since the last lexing are relexed one by one in order of offset, each costing what it touches
+  void relexEdit(const LexerInput& input, StyleDatabase& sdb, size_t offset, size_t added);
 
 private:
   LexerType m_type;
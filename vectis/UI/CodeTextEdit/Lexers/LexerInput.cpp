@@ -0,0 +1,94 @@
+#include <UI/CodeTextEdit/Lexers/LexerInput.h>
+
+LexerInput::LexerInput(const char *data, size_t size) :
+  m_buffer(nullptr),
+  m_size(size),
+  m_chunkData(data),
+  m_chunkSize(size),
+  m_chunkOffset(0)
+{
+}
+
+LexerInput::LexerInput(const PieceTable& buffer) :
+  m_buffer(&buffer),
+  m_size(buffer.size()),
+  m_chunkData(nullptr),
+  m_chunkSize(0),
+  m_chunkOffset(0)
+{
+}
+
+// Slow path of at(): moves the cached span to the piece containing pos
+char LexerInput::fetch(size_t pos) const {
+  if (pos >= m_size || m_buffer == nullptr)
+    throw std::out_of_range("LexerInput::at");
+
+  PieceTable::Chunk chunk = m_buffer->chunkAt(pos);
+  m_chunkData = chunk.data;
+  m_chunkSize = chunk.size;
+  m_chunkOffset = chunk.offset;
+  return m_chunkData[pos - m_chunkOffset];
+}
+
+bool LexerInput::compare(size_t pos, const char *literal, size_t length) const {
+  if (length > m_size || pos > m_size - length)
+    return false;
+
+  // Fast path: the whole literal is inside the cached span
+  if (pos - m_chunkOffset < m_chunkSize && m_chunkSize - (pos - m_chunkOffset) >= length)
+    return std::memcmp(m_chunkData + (pos - m_chunkOffset), literal, length) == 0;
+
+  for (size_t i = 0; i < length; ++i) {
+    if (at(pos + i) != literal[i])
+      return false;
+  }
+  return true;
+}
+
+bool LexerInput::contains(char c, size_t from, size_t to) const {
+  if (to > m_size)
+    to = m_size;
+  if (from >= to)
+    return false;
+
+  // Fast path: the range is inside the cached span (always the case for contiguous buffers)
+  if (from - m_chunkOffset < m_chunkSize && to - m_chunkOffset <= m_chunkSize)
+    return std::memchr(m_chunkData + (from - m_chunkOffset), c, to - from) != nullptr;
+
+  bool found = false;
+  m_buffer->forEachChunk(from, to - from, [&](const PieceTable::Chunk& chunk) {
+    if (!found && std::memchr(chunk.data, c, chunk.size) != nullptr)
+      found = true;
+  });
+  return found;
+}
+
+size_t LexerInput::find(char c, size_t from) const {
+  while (from < m_size) {
+    at(from); // Moves the cached span to the one containing from
+    size_t spanEnd = m_chunkOffset + m_chunkSize;
+    const char *found = static_cast<const char*>(std::memchr(m_chunkData + (from - m_chunkOffset), c, spanEnd - from));
+    if (found != nullptr)
+      return m_chunkOffset + static_cast<size_t>(found - m_chunkData);
+    from = spanEnd;
+  }
+  return m_size;
+}
+
+size_t LexerInput::lineAt(size_t pos) const {
+  if (m_buffer != nullptr)
+    return m_buffer->lineAt(pos);
+  size_t line = 0;
+  for (size_t newline = find('\n', 0); newline < pos; newline = find('\n', newline + 1))
+    ++line;
+  return line;
+}
+
+size_t LexerInput::lineStart(size_t line) const {
+  if (m_buffer != nullptr)
+    return m_buffer->lineStart(line);
+  size_t start = 0;
+  for (; line > 0 && start < m_size; --line)
+    start = find('\n', start) + 1;
+  return std::min(start, m_size);
+}
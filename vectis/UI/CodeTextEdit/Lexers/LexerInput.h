@@ -0,0 +1,55 @@
+#ifndef LEXERINPUT_H
+#define LEXERINPUT_H
+
+#include <UI/CodeTextEdit/Buffer/PieceTable.h>
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+
+// A read-only, non-owning view of the text to be lexed. It either wraps a contiguous buffer or
+// walks the pieces of a PieceTable, caching the piece the last access fell into: lexers read
+// sequentially, so almost every access is served from the cached piece without copying anything.
+// As with std::string::at, accessing past the end throws std::out_of_range (lexers rely on this
+// to stop at EOF). The viewed text must not change while the view is in use
+class LexerInput {
+public:
+  LexerInput(const char *data, size_t size);
+  explicit LexerInput(const PieceTable& buffer);
+
+  size_t size() const { return m_size; }
+
+  char at(size_t pos) const {
+    if (pos - m_chunkOffset < m_chunkSize) // Also false for pos < m_chunkOffset (wraps around)
+      return m_chunkData[pos - m_chunkOffset];
+    return fetch(pos);
+  }
+
+  // Whether the text at pos starts with the given string
+  bool compare(size_t pos, const char *literal, size_t length) const;
+  template <size_t N>
+  bool compare(size_t pos, const char (&literal)[N]) const { return compare(pos, literal, N - 1); }
+
+  // Whether c appears in [from; to)
+  bool contains(char c, size_t from, size_t to) const;
+  // Position of the first c at or after from, size() if there's none
+  size_t find(char c, size_t from) const;
+
+  // Lines of the text, as in PieceTable: O(log n) for a PieceTable, a scan of the text otherwise
+  // (contiguous buffers are meant to be lexed as a whole)
+  size_t lineCount() const { return lineAt(m_size) + 1; }
+  size_t lineAt(size_t pos) const;
+  size_t lineStart(size_t line) const;
+  size_t lineLength(size_t line) const { return lineStart(line + 1) - lineStart(line); }
+
+private:
+  char fetch(size_t pos) const;
+
+  const PieceTable *m_buffer;
+  size_t m_size;
+  // The contiguous span the last access fell into
+  mutable const char *m_chunkData;
+  mutable size_t m_chunkSize;
+  mutable size_t m_chunkOffset;
+};
+
+#endif // LEXERINPUT_H
@@ -0,0 +1,223 @@
+#ifndef NUMERICLITERAL_H
+#define NUMERICLITERAL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Recognizes C++ numeric literals (decimal, octal, hexadecimal and binary integers, decimal and
+// hexadecimal floating point numbers, digit separators and the standard suffixes) with a DFA whose
+// tables are built at compile time. Scanning allocates nothing and looks at every character once
+
+enum class NumericLiteralKind : uint8_t { Invalid, Decimal, Octal, Hexadecimal, Binary, Floating };
+
+namespace NumericLiteralDFA {
+
+  // Characters which behave the same way in every state share a class
+  enum CharClass : uint8_t {
+    Zero, One, OctalDigit /* 2-7 */, DecimalDigit /* 8-9 */,
+    X, B, E, F, HexLetter /* a, c, d */, U, LowerL, UpperL, P,
+    Dot, Quote, Sign, OtherIdentifier, Other,
+    CharClassCount
+  };
+
+  enum State : uint8_t {
+    Dead, Start,
+    LeadingZero, Decimal, DecimalSep, Octal, OctalSep, BadOctal /* 09, only valid as in 09.5 */, BadOctalSep,
+    HexPrefix, Hex, HexSep, HexDot, HexFraction, HexFractionSep,
+    BinaryPrefix, Binary, BinarySep,
+    Fraction, FractionSep, ExponentMark, ExponentSign, Exponent, ExponentSep, FloatSuffix,
+    // Integer suffixes: u, l, ll, ul, ull, lu, llu with any case for u (the l's of ll share the case)
+    SuffixU, SuffixUl, SuffixUL, Suffixl, Suffixll, SuffixL, SuffixLL, IntegerSuffixEnd,
+    StateCount
+  };
+
+  struct Tables {
+    uint8_t charClass[256];
+    uint8_t next[StateCount][CharClassCount]; // Zero-initialized: Dead
+    NumericLiteralKind kind[StateCount]; // Invalid for non-accepting states
+    bool suffix[StateCount]; // Suffix states keep the kind of the digits before them
+  };
+
+  constexpr void setTransitions(Tables& t, State from, const uint8_t *classes, int count, State to) {
+    for (int i = 0; i < count; ++i)
+      t.next[from][classes[i]] = to;
+  }
+
+  constexpr Tables makeTables() {
+    Tables t{};
+
+    for (int c = 0; c < 256; ++c)
+      t.charClass[c] = Other;
+    for (int c = 'a'; c <= 'z'; ++c)
+      t.charClass[c] = OtherIdentifier;
+    for (int c = 'A'; c <= 'Z'; ++c)
+      t.charClass[c] = OtherIdentifier;
+    t.charClass['_'] = OtherIdentifier;
+    t.charClass['0'] = Zero;
+    t.charClass['1'] = One;
+    for (int c = '2'; c <= '7'; ++c)
+      t.charClass[c] = OctalDigit;
+    t.charClass['8'] = t.charClass['9'] = DecimalDigit;
+    t.charClass['x'] = t.charClass['X'] = X;
+    t.charClass['b'] = t.charClass['B'] = B;
+    t.charClass['e'] = t.charClass['E'] = E;
+    t.charClass['f'] = t.charClass['F'] = F;
+    t.charClass['a'] = t.charClass['A'] = HexLetter;
+    t.charClass['c'] = t.charClass['C'] = HexLetter;
+    t.charClass['d'] = t.charClass['D'] = HexLetter;
+    t.charClass['u'] = t.charClass['U'] = U;
+    t.charClass['l'] = LowerL;
+    t.charClass['L'] = UpperL;
+    t.charClass['p'] = t.charClass['P'] = P;
+    t.charClass['.'] = Dot;
+    t.charClass['\''] = Quote;
+    t.charClass['+'] = t.charClass['-'] = Sign;
+
+    const uint8_t octalDigits[] = { Zero, One, OctalDigit };
+    const uint8_t decimalDigits[] = { Zero, One, OctalDigit, DecimalDigit };
+    const uint8_t hexDigits[] = { Zero, One, OctalDigit, DecimalDigit, B, E, F, HexLetter };
+    const uint8_t binaryDigits[] = { Zero, One };
+
+    // Integers
+    t.next[Start][Zero] = LeadingZero;
+    t.next[Start][One] = t.next[Start][OctalDigit] = t.next[Start][DecimalDigit] = Decimal;
+
+    setTransitions(t, LeadingZero, octalDigits, 3, Octal);
+    t.next[LeadingZero][DecimalDigit] = BadOctal;
+    t.next[LeadingZero][Quote] = OctalSep;
+    t.next[LeadingZero][X] = HexPrefix;
+    t.next[LeadingZero][B] = BinaryPrefix;
+    t.next[LeadingZero][Dot] = Fraction;
+    t.next[LeadingZero][E] = ExponentMark;
+
+    setTransitions(t, Decimal, decimalDigits, 4, Decimal);
+    setTransitions(t, DecimalSep, decimalDigits, 4, Decimal);
+    t.next[Decimal][Quote] = DecimalSep;
+    t.next[Decimal][Dot] = Fraction;
+    t.next[Decimal][E] = ExponentMark;
+
+    setTransitions(t, Octal, octalDigits, 3, Octal);
+    setTransitions(t, OctalSep, octalDigits, 3, Octal);
+    t.next[Octal][DecimalDigit] = t.next[OctalSep][DecimalDigit] = BadOctal;
+    t.next[Octal][Quote] = OctalSep;
+    t.next[Octal][Dot] = Fraction;
+    t.next[Octal][E] = ExponentMark;
+
+    setTransitions(t, BadOctal, decimalDigits, 4, BadOctal);
+    setTransitions(t, BadOctalSep, decimalDigits, 4, BadOctal);
+    t.next[BadOctal][Quote] = BadOctalSep;
+    t.next[BadOctal][Dot] = Fraction;
+    t.next[BadOctal][E] = ExponentMark;
+
+    setTransitions(t, HexPrefix, hexDigits, 8, Hex);
+    setTransitions(t, Hex, hexDigits, 8, Hex);
+    setTransitions(t, HexSep, hexDigits, 8, Hex);
+    t.next[HexPrefix][Dot] = HexDot;
+    t.next[Hex][Quote] = HexSep;
+    t.next[Hex][Dot] = HexFraction;
+    t.next[Hex][P] = ExponentMark;
+    setTransitions(t, HexDot, hexDigits, 8, HexFraction);
+    setTransitions(t, HexFraction, hexDigits, 8, HexFraction);
+    setTransitions(t, HexFractionSep, hexDigits, 8, HexFraction);
+    t.next[HexFraction][Quote] = HexFractionSep;
+    t.next[HexFraction][P] = ExponentMark; // Hexadecimal floats always have a binary exponent
+
+    setTransitions(t, BinaryPrefix, binaryDigits, 2, Binary);
+    setTransitions(t, Binary, binaryDigits, 2, Binary);
+    setTransitions(t, BinarySep, binaryDigits, 2, Binary);
+    t.next[Binary][Quote] = BinarySep;
+
+    // Floating point numbers
+    setTransitions(t, Fraction, decimalDigits, 4, Fraction);
+    setTransitions(t, FractionSep, decimalDigits, 4, Fraction);
+    t.next[Fraction][Quote] = FractionSep;
+    t.next[Fraction][E] = ExponentMark;
+    t.next[ExponentMark][Sign] = ExponentSign;
+    setTransitions(t, ExponentMark, decimalDigits, 4, Exponent);
+    setTransitions(t, ExponentSign, decimalDigits, 4, Exponent);
+    setTransitions(t, Exponent, decimalDigits, 4, Exponent);
+    setTransitions(t, ExponentSep, decimalDigits, 4, Exponent);
+    t.next[Exponent][Quote] = ExponentSep;
+    t.next[Fraction][F] = t.next[Fraction][LowerL] = t.next[Fraction][UpperL] = FloatSuffix;
+    t.next[Exponent][F] = t.next[Exponent][LowerL] = t.next[Exponent][UpperL] = FloatSuffix;
+
+    // Integer suffixes
+    const State integers[] = { LeadingZero, Decimal, Octal, Hex, Binary };
+    for (State s : integers) {
+      t.next[s][U] = SuffixU;
+      t.next[s][LowerL] = Suffixl;
+      t.next[s][UpperL] = SuffixL;
+    }
+    t.next[SuffixU][LowerL] = SuffixUl;
+    t.next[SuffixU][UpperL] = SuffixUL;
+    t.next[SuffixUl][LowerL] = IntegerSuffixEnd;
+    t.next[SuffixUL][UpperL] = IntegerSuffixEnd;
+    t.next[Suffixl][LowerL] = Suffixll;
+    t.next[SuffixL][UpperL] = SuffixLL;
+    t.next[Suffixl][U] = t.next[Suffixll][U] = IntegerSuffixEnd;
+    t.next[SuffixL][U] = t.next[SuffixLL][U] = IntegerSuffixEnd;
+
+    // Accepting states
+    t.kind[LeadingZero] = NumericLiteralKind::Decimal;
+    t.kind[Decimal] = NumericLiteralKind::Decimal;
+    t.kind[Octal] = NumericLiteralKind::Octal;
+    t.kind[Hex] = NumericLiteralKind::Hexadecimal;
+    t.kind[Binary] = NumericLiteralKind::Binary;
+    t.kind[Fraction] = t.kind[Exponent] = t.kind[FloatSuffix] = NumericLiteralKind::Floating;
+    const State suffixes[] = { SuffixU, SuffixUl, SuffixUL, Suffixl, Suffixll, SuffixL, SuffixLL, IntegerSuffixEnd };
+    for (State s : suffixes)
+      t.suffix[s] = true;
+
+    return t;
+  }
+
+  constexpr Tables tables = makeTables();
+
+  constexpr bool isIdentifierCharacter(uint8_t charClass) {
+    return charClass != Dot && charClass != Quote && charClass != Sign && charClass != Other;
+  }
+
+} // namespace NumericLiteralDFA
+
+// Scans a numeric literal starting at pos, which must be a digit, and moves pos past it.
+// Identifier characters glued to the literal (e.g. 12abc or 1_km) are consumed as well and make
+// it Invalid. Input can be anything with a char at(size_t) accessor (e.g. LexerInput); as with
+// the lexers, reaching the end of the input is signaled by at() throwing
+template <typename Input>
+NumericLiteralKind scanNumericLiteral(const Input& input, size_t& pos) {
+  using namespace NumericLiteralDFA;
+
+  uint8_t state = Start;
+  uint8_t previous = Start;
+  NumericLiteralKind kind = NumericLiteralKind::Invalid;
+  while (true) {
+    uint8_t charClass = tables.charClass[static_cast<unsigned char>(input.at(pos))];
+    uint8_t next = tables.next[state][charClass];
+    if (next == Dead) {
+      if (isIdentifierCharacter(charClass)) {
+        // Not a literal after all: swallow the rest of the token
+        while (isIdentifierCharacter(tables.charClass[static_cast<unsigned char>(input.at(++pos))]))
+          ;
+        return NumericLiteralKind::Invalid;
+      }
+      break;
+    }
+    previous = state;
+    state = next;
+    if (tables.kind[state] != NumericLiteralKind::Invalid)
+      kind = tables.kind[state];
+    ++pos;
+  }
+
+  // A trailing digit separator isn't part of the literal
+  if (state == DecimalSep || state == OctalSep || state == BadOctalSep || state == HexSep ||
+      state == HexFractionSep || state == BinarySep || state == FractionSep || state == ExponentSep) {
+    --pos;
+    state = previous;
+  }
+  if (tables.kind[state] == NumericLiteralKind::Invalid && !tables.suffix[state])
+    return NumericLiteralKind::Invalid;
+  return kind;
+}
+
+#endif // NUMERICLITERAL_H
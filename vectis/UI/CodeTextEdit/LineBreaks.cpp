@@ -0,0 +1,69 @@
+#include <UI/CodeTextEdit/LineBreaks.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace { // Functions reserved for this TU's internal use
+
+  // Lead byte of a UTF-8 sequence encoding a character in U+3000 - U+9FFF (CJK symbols,
+  // punctuation, kana and ideographs), all of them three bytes long
+  bool isCJKLeadByte(unsigned char c) {
+    return c >= 0xE3 && c <= 0xE9;
+  }
+
+  template <typename Offset>
+  void findBreaks(const char *text, size_t length, LineEncoding encoding, std::vector<Offset>& breaks) {
+    const bool utf8 = encoding == LineEncoding::Utf8; // The same bytes are accented letters in Latin-1
+    auto add = [&breaks](size_t offset) {
+      if (offset > 0 && (breaks.empty() || breaks.back() < offset)) // Sorted, no duplicates
+        breaks.push_back(static_cast<Offset>(offset));
+    };
+    for (size_t i = 0; i < length; ++i) {
+      const unsigned char c = static_cast<unsigned char>(text[i]);
+      if (c == ' ') {
+        add(i);
+      } else if (c == ',' || c == ';') {
+        add(i + 1);
+      } else if (utf8 && isCJKLeadByte(c) && i + 3 <= length) {
+        add(i);
+        add(i + 3);
+        i += 2;
+      }
+    }
+    // Breaks at the very end are never used
+    while (!breaks.empty() && breaks.back() >= length)
+      breaks.pop_back();
+  }
+
+  // Per thread scratch space the breaks are found into before being copied to the arena
+  thread_local std::vector<uint16_t> narrowScratch;
+  thread_local std::vector<uint32_t> wideScratch;
+}
+
+void LineBreaks::build(const char *text, size_t length, LineEncoding encoding, Arena& arena) {
+  m_wide = length > UINT16_MAX;
+  const void *breaks;
+  size_t bytes;
+  if (m_wide) {
+    wideScratch.clear();
+    findBreaks(text, length, encoding, wideScratch);
+    m_size = static_cast<uint32_t>(wideScratch.size());
+    breaks = wideScratch.data();
+    bytes = wideScratch.size() * sizeof(uint32_t);
+  } else {
+    narrowScratch.clear();
+    findBreaks(text, length, encoding, narrowScratch);
+    m_size = static_cast<uint32_t>(narrowScratch.size());
+    breaks = narrowScratch.data();
+    bytes = narrowScratch.size() * sizeof(uint16_t);
+  }
+  if (bytes > m_capacity) {
+    // The previous storage (if any) stays in the arena until it's reset: growing geometrically
+    // keeps what a line being typed into leaves behind to less than what it uses
+    const size_t capacity = std::max<size_t>(bytes, 2 * size_t(m_capacity));
+    m_breaks = arena.allocate(capacity, alignof(uint32_t));
+    m_capacity = static_cast<uint32_t>(capacity);
+  }
+  if (bytes > 0)
+    std::memcpy(m_breaks, breaks, bytes);
+}
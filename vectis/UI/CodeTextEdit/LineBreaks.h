@@ -0,0 +1,72 @@
+#ifndef LINEBREAKS_H
+#define LINEBREAKS_H
+
+#include <UI/CodeTextEdit/Arena.h>
+#include <UI/CodeTextEdit/Buffer/TextEncoding.h>
+#include <cstddef>
+#include <cstdint>
+
+// The offsets where a line may be broken when wrapped, whatever the wrap width: every space (which
+// then starts the next editor line), after ',' and ';', and around CJK ideographs (UTF-8
+// sequences in U+3000 - U+9FFF, in UTF-8 lines only). Built once when a line is loaded or edited:
+// wrapping at any width is then a greedy walk over these offsets, without looking at (or copying)
+// the text.
+//
+// Offsets are stored in 16 bits unless the line is 64K characters or longer, in an arena shared by
+// many lines (Document uses one per wrap pass): building the breaks of a line doesn't allocate on
+// its own. A line built again reuses its storage if the new offsets fit in it, and otherwise at
+// least doubles it
+class LineBreaks {
+public:
+  void build(const char *text, size_t length, LineEncoding encoding, Arena& arena);
+
+  size_t size() const { return m_size; }
+
+  // Splits a line of the given length in editor lines of at most maxChars characters, at the last
+  // break which fits (or after maxChars characters if there's none). Calls fn(start, length) for
+  // every editor line, in order. Every byte of the line is a character
+  template <typename Fn>
+  void wrap(int length, int maxChars, Fn&& fn) const {
+    auto identity = [](int i) { return i; };
+    wrap(length, maxChars, fn, identity, identity);
+  }
+  // Same as above for a line whose characters might take several bytes (UTF-8): the line length,
+  // the breaks and the editor lines are in bytes, maxChars is in characters. columnAt(offset) is
+  // the character starting at a byte offset (or the character count, at the end of the line) and
+  // offsetOf(column) is the reverse
+  template <typename Fn, typename ColumnAt, typename OffsetOf>
+  void wrap(int length, int maxChars, Fn&& fn, ColumnAt&& columnAt, OffsetOf&& offsetOf) const {
+    if (m_wide)
+      wrap(static_cast<const uint32_t*>(m_breaks), m_size, length, maxChars, fn, columnAt, offsetOf);
+    else
+      wrap(static_cast<const uint16_t*>(m_breaks), m_size, length, maxChars, fn, columnAt, offsetOf);
+  }
+
+private:
+  template <typename Offset, typename Fn, typename ColumnAt, typename OffsetOf>
+  static void wrap(const Offset *breaks, size_t size, int length, int maxChars, Fn& fn,
+                   ColumnAt& columnAt, OffsetOf& offsetOf) {
+    const int columns = columnAt(length);
+    int start = 0, startColumn = 0;
+    size_t next = 0; // First break after start
+    while (columns - startColumn > maxChars) {
+      while (next < size && static_cast<int>(breaks[next]) <= start)
+        ++next;
+      const int limit = offsetOf(startColumn + maxChars);
+      int end = limit; // Brutally split if there's no break to be used
+      for (size_t i = next; i < size && static_cast<int>(breaks[i]) <= limit; ++i)
+        end = static_cast<int>(breaks[i]);
+      fn(start, end - start);
+      start = end;
+      startColumn = columnAt(end);
+    }
+    fn(start, length - start);
+  }
+
+  void *m_breaks = nullptr; // uint16_t or uint32_t offsets, owned by the arena
+  uint32_t m_size = 0;
+  uint32_t m_capacity = 0; // In bytes
+  bool m_wide = false;
+};
+
+#endif // LINEBREAKS_H
@@ -0,0 +1,46 @@
+#include <UI/CodeTextEdit/LineLayoutCache.h>
+#include <utility>
+
+LineLayoutCache::LineLayoutCache(int capacity) :
+  m_capacity(capacity)
+{
+}
+
+const LineLayout* LineLayoutCache::find(quint64 key, const QString& text) {
+  auto it = m_entries.find(key);
+  if (it == m_entries.end() || it->layout.text != text) {
+    ++m_statistics.misses;
+    return nullptr;
+  }
+  ++m_statistics.hits;
+  m_uses.splice(m_uses.begin(), m_uses, it->use); // Most recently used now
+  return &it->layout;
+}
+
+const LineLayout& LineLayoutCache::insert(quint64 key, LineLayout layout) {
+  auto it = m_entries.find(key);
+  if (it != m_entries.end()) { // A collision
+    it->layout = std::move(layout);
+    m_uses.splice(m_uses.begin(), m_uses, it->use);
+    return it->layout;
+  }
+
+  if (m_entries.size() >= m_capacity) {
+    m_entries.remove(m_uses.back());
+    m_uses.pop_back();
+  }
+  m_uses.push_front(key);
+  it = m_entries.insert(key, Entry{std::move(layout), m_uses.begin()});
+  return it->layout;
+}
+
+void LineLayoutCache::clear() {
+  m_entries.clear();
+  m_uses.clear();
+}
+
+LineLayoutCache::Statistics LineLayoutCache::statistics() const {
+  Statistics statistics = m_statistics;
+  statistics.lines = m_entries.size();
+  return statistics;
+}
@@ -0,0 +1,55 @@
+#ifndef LINELAYOUTCACHE_H
+#define LINELAYOUTCACHE_H
+
+#include <QGlyphRun>
+#include <QHash>
+#include <QPainter>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <list>
+
+// How an editor line gets drawn, relative to its top left corner
+struct LineLayout {
+  QString text; // To tell hash collisions apart
+  // Glyphs blitted out of the GlyphAtlas...
+  QVector<QPainter::PixmapFragment> fragments;
+  // ...or glyphs shaped by QTextLayout, with their colour, if the atlas can't draw the line
+  QVector<QPair<QGlyphRun, QRgb>> glyphRuns;
+};
+
+// The most recently drawn line layouts, keyed by a hash of their text and formats rather than by
+// line number: lines scrolled back on screen, the ones of a document switched back to, or just
+// identical lines don't get prepared again. Bounded, the least recently used lines go first
+class LineLayoutCache {
+public:
+  struct Statistics {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    int lines = 0; // Currently cached
+  };
+
+  explicit LineLayoutCache(int capacity = 4096);
+
+  // The layout cached for a line with this key and text, nullptr if there's none (a miss)
+  const LineLayout* find(quint64 key, const QString& text);
+  // Caches the layout of a line (replacing the one with the same key, if any) and returns it.
+  // Layouts returned earlier might not be valid anymore
+  const LineLayout& insert(quint64 key, LineLayout layout);
+  void clear();
+
+  Statistics statistics() const;
+
+private:
+  struct Entry {
+    LineLayout layout;
+    std::list<quint64>::iterator use;
+  };
+
+  int m_capacity;
+  QHash<quint64, Entry> m_entries;
+  std::list<quint64> m_uses; // Most recently used first
+  Statistics m_statistics;
+};
+
+#endif // LINELAYOUTCACHE_H
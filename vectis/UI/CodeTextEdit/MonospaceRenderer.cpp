@@ -0,0 +1,185 @@
+#include <UI/CodeTextEdit/MonospaceRenderer.h>
+#include <QFontInfo>
+#include <QFontMetricsF>
+#include <QTextLayout>
+#include <utility>
+
+namespace { // Functions reserved for this TU's internal use
+
+  // Characters which are never shaped, joined or reordered: Latin, Greek and Cyrillic letters and
+  // symbols, without combining marks
+  bool isGridCharacter(ushort c) {
+    return (c > 0x20 && c < 0x7F) || (c >= 0xA0 && c < 0x0300) || (c >= 0x0370 && c < 0x0483) ||
+           (c >= 0x048A && c < 0x0530);
+  }
+
+  // Formats the atlas can reproduce: sorted, non-overlapping ranges which only change the colour,
+  // the weight or the slant of the text
+  bool isGridFormatting(const QVector<QTextLayout::FormatRange>& formats) {
+    int end = 0;
+    for (const QTextLayout::FormatRange& range : formats) {
+      const QTextCharFormat& format = range.format;
+      if (range.start < end || format.background().style() != Qt::NoBrush || format.fontUnderline() ||
+          format.fontStrikeOut() || format.fontOverline())
+        return false;
+      end = range.start + range.length;
+    }
+    return true;
+  }
+
+  // Hash of everything the way a line is drawn depends on: its text, its formats and whether it can
+  // come from the atlas
+  quint64 lineKey(const QString& text, const QVector<QTextLayout::FormatRange>& formats, QRgb textColor,
+                  bool useAtlas) {
+    quint64 hash = qHash(text);
+    auto mix = [&hash](quint64 value) {
+      hash = (hash ^ value) * 0x100000001B3ull; // FNV-1a step, a value at a time
+    };
+    for (const QTextLayout::FormatRange& range : formats) {
+      const QBrush foreground = range.format.foreground();
+      mix(static_cast<quint64>(range.start) << 32 | static_cast<quint32>(range.length));
+      mix((foreground.style() != Qt::NoBrush) ? foreground.color().rgba() : textColor);
+      mix(static_cast<quint64>(range.format.fontWeight()) << 1 | range.format.fontItalic());
+    }
+    mix(textColor);
+    mix(useAtlas);
+    return hash;
+  }
+
+  // Drawn as blanks: tabulation markers and the newline ending a physical line
+  bool isBlank(ushort c) {
+    return c == ' ' || c == 0x07 || c == '\r' || c == '\n';
+  }
+}
+
+void MonospaceRenderer::setFont(const QFont& font) {
+  m_font = font;
+  m_fixedPitch = QFontInfo(font).fixedPitch();
+  m_atlas.setFont(font);
+  m_cache.clear(); // Cached lines were laid out with the previous font's metrics and glyph cells
+}
+
+void MonospaceRenderer::begin(QColor textColor, bool useAtlas) {
+  if (m_atlas.trim())
+    m_cache.clear(); // Cached lines point to cells which are gone
+  m_textColor = textColor.rgba();
+  m_useAtlas = useAtlas && m_fixedPitch;
+  m_fragments.clear();
+}
+
+void MonospaceRenderer::drawLine(QPainter& painter, const QString& text,
+                                 const QVector<QTextLayout::FormatRange>& formats, const QPointF& position) {
+  const quint64 key = lineKey(text, formats, m_textColor, m_useAtlas);
+  const LineLayout *prepared = m_cache.find(key, text);
+  if (prepared == nullptr) {
+    LineLayout line;
+    line.text = text;
+    if (!m_useAtlas || !isGridFormatting(formats) || !prepareFromAtlas(formats, line))
+      prepareShaped(formats, line);
+    prepared = &m_cache.insert(key, std::move(line));
+  }
+
+  // Atlas glyphs are queued, shaped ones drawn right away
+  const QPointF offset(qRound(position.x()), qRound(position.y()));
+  for (QPainter::PixmapFragment fragment : prepared->fragments) {
+    fragment.x += offset.x();
+    fragment.y += offset.y();
+    m_fragments.append(fragment);
+  }
+  for (const QPair<QGlyphRun, QRgb>& run : prepared->glyphRuns) {
+    painter.setPen(QColor::fromRgba(run.second));
+    painter.drawGlyphRun(position, run.first);
+  }
+}
+
+// Lays the glyphs of the line out of the atlas, a column at a time. Returns false if the line can't
+// be drawn out of the atlas
+bool MonospaceRenderer::prepareFromAtlas(const QVector<QTextLayout::FormatRange>& formats, LineLayout& prepared) {
+  const QString& text = prepared.text;
+  const qreal width = m_atlas.characterWidth();
+  const int glyphTop = qRound(QFontMetricsF(m_font).ascent()) - m_atlas.ascent();
+
+  // Looks of the characters up to rangeEnd
+  int range = 0;
+  int rangeEnd = -1;
+  QRgb color = m_textColor;
+  bool bold = false, italic = false;
+
+  for (int i = 0; i < text.length(); ++i) {
+    const QChar c = text.at(i);
+    if (isBlank(c.unicode()))
+      continue;
+    if (!isGridCharacter(c.unicode())) {
+      prepared.fragments.clear();
+      return false;
+    }
+
+    if (i >= rangeEnd) { // Next format range, or the gap before it
+      while (range < formats.size() && formats[range].start + formats[range].length <= i)
+        ++range;
+      if (range < formats.size() && formats[range].start <= i) {
+        const QTextCharFormat& format = formats[range].format;
+        const QBrush foreground = format.foreground();
+        rangeEnd = formats[range].start + formats[range].length;
+        color = (foreground.style() != Qt::NoBrush) ? foreground.color().rgba() : m_textColor;
+        bold = format.fontWeight() > QFont::Normal;
+        italic = format.fontItalic();
+      } else {
+        rangeEnd = (range < formats.size()) ? formats[range].start : text.length();
+        color = m_textColor;
+        bold = italic = false;
+      }
+    }
+
+    const QRect cell = m_atlas.cell(c, bold, italic, color);
+    if (cell.isNull()) {
+      prepared.fragments.clear();
+      return false;
+    }
+    // Fragments are positioned by their centre
+    const QPointF centre(qRound(i * width) - m_atlas.padding() + cell.width() / 2.0, glyphTop + cell.height() / 2.0);
+    prepared.fragments.append(QPainter::PixmapFragment::create(centre, cell));
+  }
+  return true;
+}
+
+// Keeps the glyph runs a QTextLayout shapes for the line, a format range at a time (runs don't know
+// their colour)
+void MonospaceRenderer::prepareShaped(const QVector<QTextLayout::FormatRange>& formats, LineLayout& prepared) {
+  QString text = prepared.text;
+  for (QChar& c : text) {
+    if (isBlank(c.unicode()))
+      c = QLatin1Char(' ');
+  }
+  QTextLayout layout(text, m_font);
+  QTextOption option;
+  option.setWrapMode(QTextOption::NoWrap); // Already wrapped by the document
+  layout.setTextOption(option);
+  layout.setFormats(formats);
+  layout.beginLayout();
+  QTextLine line = layout.createLine();
+  if (line.isValid())
+    line.setPosition(QPointF(0, 0));
+  layout.endLayout();
+
+  auto append = [&](int start, int length, QRgb color) {
+    if (length <= 0)
+      return;
+    for (const QGlyphRun& run : layout.glyphRuns(start, length))
+      prepared.glyphRuns.append(qMakePair(run, color));
+  };
+  int position = 0;
+  for (const QTextLayout::FormatRange& range : formats) {
+    const QBrush foreground = range.format.foreground();
+    append(position, range.start - position, m_textColor);
+    append(range.start, range.length, (foreground.style() != Qt::NoBrush) ? foreground.color().rgba() : m_textColor);
+    position = range.start + range.length;
+  }
+  append(position, text.length() - position, m_textColor);
+}
+
+void MonospaceRenderer::end(QPainter& painter) {
+  if (!m_fragments.isEmpty())
+    painter.drawPixmapFragments(m_fragments.constData(), m_fragments.size(), m_atlas.pixmap());
+  m_fragments.clear();
+}
@@ -0,0 +1,50 @@
+#ifndef MONOSPACERENDERER_H
+#define MONOSPACERENDERER_H
+
+#include <UI/CodeTextEdit/GlyphAtlas.h>
+#include <UI/CodeTextEdit/LineLayoutCache.h>
+#include <QColor>
+#include <QFont>
+#include <QPainter>
+#include <QPointF>
+#include <QTextLayout>
+#include <QVector>
+
+// Paints the editor lines on screen without QTextLayout::draw(). With a fixed-pitch font every
+// character of a line sits at its column times the character width, so a line is just a run of
+// glyphs blitted out of a GlyphAtlas: a whole paint is a single drawPixmapFragments() call. Lines
+// come already wrapped by the Document, tabulation markers (0x07) and newlines are drawn as blanks.
+//
+// Lines the atlas can't draw (complex scripts, characters missing from the font or wider than
+// the others, a font which isn't fixed-pitch, a device pixel ratio other than 1) are drawn from the
+// glyph runs a QTextLayout shaped for them. Either way, what a line is drawn with is kept in a
+// LineLayoutCache
+class MonospaceRenderer {
+public:
+  void setFont(const QFont& font);
+
+  // A paint of the viewport is begin(), drawLine() for every editor line on screen, then end().
+  // Glyphs of the atlas are rasterized at 1x: useAtlas should be false on high-DPI screens
+  void begin(QColor textColor, bool useAtlas);
+  // Draws a line of text with its top left corner at the given position
+  void drawLine(QPainter& painter, const QString& text, const QVector<QTextLayout::FormatRange>& formats,
+                const QPointF& position);
+  void end(QPainter& painter);
+
+  qreal characterWidth() const { return m_atlas.characterWidth(); }
+  LineLayoutCache::Statistics cacheStatistics() const { return m_cache.statistics(); }
+
+private:
+  bool prepareFromAtlas(const QVector<QTextLayout::FormatRange>& formats, LineLayout& prepared);
+  void prepareShaped(const QVector<QTextLayout::FormatRange>& formats, LineLayout& prepared);
+
+  QFont m_font;
+  GlyphAtlas m_atlas;
+  LineLayoutCache m_cache;
+  bool m_fixedPitch = false;
+  bool m_useAtlas = false;
+  QRgb m_textColor = 0;
+  QVector<QPainter::PixmapFragment> m_fragments; // Glyphs of this paint, drawn at end()
+};
+
+#endif // MONOSPACERENDERER_H
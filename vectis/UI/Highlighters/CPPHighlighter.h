@@ -1,42 +0,0 @@
-#ifndef CPPHIGHLIGHTER_H
-#define CPPHIGHLIGHTER_H
-
-#include <QSyntaxHighlighter>
-#include <QTextCharFormat>
-
-QT_BEGIN_NAMESPACE
-class QTextDocument;
-QT_END_NAMESPACE
-
-class CPPHighlighter : public QSyntaxHighlighter
-{
-    Q_OBJECT
-
-public:
-    CPPHighlighter(QTextDocument *parent = 0);
-
-protected:
-    void highlightBlock(const QString &text) Q_DECL_OVERRIDE;
-
-private:
-    struct HighlightingRule
-    {
-        QRegExp pattern;
-        QTextCharFormat format;
-    };
-    QVector<HighlightingRule> highlightingRules;
-
-    QRegExp commentStartExpression;
-    QRegExp commentEndExpression;
-
-    QTextCharFormat normalText;
-    QTextCharFormat keywordFormat;
-    QTextCharFormat statementKeywordFormat; // e.g. 'for'
-    QTextCharFormat classFormat;
-    QTextCharFormat singleLineCommentFormat;
-    QTextCharFormat multiLineCommentFormat;
-    QTextCharFormat quotationFormat;
-    QTextCharFormat functionFormat;
-};
-
-#endif // CPPHIGHLIGHTER_H
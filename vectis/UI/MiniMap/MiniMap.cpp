@@ -0,0 +1,503 @@
+#include <UI/MiniMap/MiniMap.h>
+#include <UI/CodeTextEdit/CodeTextEdit.h>
+#include <UI/Utils.h>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QElapsedTimer>
+#include <QFontMetrics>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace { // Constants reserved for this TU's internal use
+
+  // Lines per tile: a tile is the unit the thumbnail gets rendered again in
+  const int TILE_BLOCKS = 32;
+  // Time the GUI thread is allowed to spend copying lines for the renderer before yielding back to
+  // the event loop
+  const qint64 SNAPSHOT_SLICE_BUDGET_NS = 1000000;
+}
+
+MiniMap::MiniMap(CodeTextEdit *parent) :
+  QWidget(parent),
+  m_parent(parent) {
+  setFixedWidth(WIDTH);
+  setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+  /*this->setStyleSheet("QLabel { \
+                           border-style: outset; \
+                           border-width: 1px; \
+                           border-color: red; \
+                         } \
+  ");*/
+  //setMouseTracking(true);
+  //setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+  //setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+
+  // Used to keep on copying blocks in the next event loop iteration once a slice ran out of time
+  m_snapshotTimer.setInterval(0);
+  m_snapshotTimer.setSingleShot(true);
+  connect(&m_snapshotTimer, &QTimer::timeout, this, [this]() {
+    snapshotDirtyTiles();
+  });
+  connect(&m_frameWatcher, &QFutureWatcher<MiniMapFrame>::finished, this, [this]() {
+    frameRendered();
+  });
+}
+
+MiniMap::~MiniMap() {
+  m_frameWatcher.waitForFinished(); // The worker uses m_renderer
+}
+
+void MiniMap::mousePressEvent(QMouseEvent *ev) {
+  if (m_hovering) {
+    m_dragging = true;
+    m_start_dragging_pos = ev->pos();
+
+    auto line_height = QFontMetrics(m_parent->getMonospaceFont()).height();
+    m_start_dragging_scrollbar_pos = m_parent->getVScrollbarPos() / line_height;
+  } else
+    m_dragging = false;
+}
+
+void MiniMap::mouseReleaseEvent(QMouseEvent *event) {
+  Q_UNUSED(event);
+  m_dragging = false;
+}
+
+void MiniMap::enterEvent(QEvent *event) {
+  Q_UNUSED(event);
+  m_hovering = true;
+  draw_viewport_placeholder();
+}
+
+void MiniMap::leaveEvent(QEvent *event) {
+  Q_UNUSED(event);
+  if (m_hovering || m_dragging) {
+    m_hovering = false;
+    m_dragging = false;
+    draw_viewport_placeholder(); // Restore (i.e. clear placeholder)
+    //m_running_delta += m_last_valid_delta;
+    //qDebug() << "[SAVED RUNNING DELTA]";
+  }
+}
+
+// Only the areas covered by the placeholder before and after get painted again
+void MiniMap::draw_viewport_placeholder() {
+  if (!m_hovering) {
+    update(m_viewport_rect);
+    m_viewport_rect = QRect();
+    return;
+  }
+  int viewport_y = m_parent->getVScrollbarPos();
+  int viewport_height = m_parent->viewport()->height();
+
+  auto dim = m_parent->getDocumentDimensions();
+  // dim.width() : MiniMap::WIDTH = viewport_height : scaled_viewport_height
+  float scaled_viewport_height = ((float)MiniMap::WIDTH * viewport_height) / dim.width();
+  // dim.width() : MiniMap::WIDTH = viewport_y : scaled_viewport_y
+  float scaled_viewport_y = ((float)MiniMap::WIDTH * viewport_y) / dim.width();
+
+  auto offset = -m_document_pixmap_offset;
+
+  float scaled_doc_height = ((float)MiniMap::WIDTH * dim.height()) / dim.width();
+  if (scaled_doc_height < this->height())
+    offset = 0; // Do not move the pixmap if it can safely be drawn into our area
+
+  // Draw the viewport area placeholder
+  QRect rect(0, static_cast<int>(scaled_viewport_y + offset), MiniMap::WIDTH, static_cast<int>(scaled_viewport_height));
+  if (rect != m_viewport_rect) {
+    update(m_viewport_rect);
+    update(rect);
+    m_viewport_rect = rect;
+  }
+}
+
+void MiniMap::mouseMoveEvent(QMouseEvent *ev) {
+  if (!m_dragging)
+    return;
+
+  auto dim = m_parent->getDocumentDimensions();
+  auto viewport_height = m_parent->viewport()->height();
+  auto scaled_viewport_height = ((float)MiniMap::WIDTH * viewport_height) / dim.width();
+
+
+  // Delta from original mouse position
+  float delta = ev->pos().y() - m_start_dragging_pos.y();
+  float percentage = delta / (this->height() - scaled_viewport_height);
+  percentage = clamp(percentage, -1.f, 1.f);
+
+  auto line_height = QFontMetrics(m_parent->getMonospaceFont()).height();
+
+  // Add a scroll-acceleration factor if the document is very small
+  float factor = 1.f;
+  float scaled_doc_height = ((float)MiniMap::WIDTH * dim.height()) / dim.width();
+  if (scaled_doc_height < this->height())
+    factor = this->height() / scaled_doc_height; // Do not move the pixmap if it can safely be drawn into our area
+
+  auto document_delta = ((dim.height() - m_parent->viewport()->height()) / line_height) * percentage * factor;
+  // Scaled delta to minimap height
+  // dim.width() : MiniMap::WIDTH = dim.height() : scaled_delta
+  //auto scaled_delta = (MiniMap::WIDTH * dim.height()) / dim.width();
+  // Additional delta to have the document scrolled entirely in the minimap's height area
+  // delta : viewport_height = document_pos : document_height
+  //auto additional_delta = (delta * dim.height()) / viewport_height;
+  int new_scrollbar_value = m_start_dragging_scrollbar_pos + document_delta;
+  if (!m_parent->verticalScrollBar()->isVisible() ||
+      new_scrollbar_value < m_parent->verticalScrollBar()->minimum() ||
+      new_scrollbar_value > m_parent->verticalScrollBar()->maximum())
+    return;
+
+  //qDebug() << new_scrollbar_value;
+
+  //qDebug() << m_parent->verticalScrollBar()->value();
+
+  //if (new_scrollbar_value < m_parent->verticalScrollBar()->minimum())
+    //m_document_pixmap_offset = 0;
+  //else if (new_scrollbar_value > m_parent->verticalScrollBar()->maximum()) {
+   // float scaled_doc_height = ((float)MiniMap::WIDTH * dim.height()) / dim.width();
+    //m_document_pixmap_offset = scaled_doc_height - this->height();
+  //} else {
+    m_parent->verticalScrollBar()->setValue(new_scrollbar_value);
+
+    updatePixmapOffsetFromScrollbar(percentage);
+    //qDebug() << "Last m_document_pixmap_offset: " << m_document_pixmap_offset << " with scaled_viewport_y = " <<
+    //            scaled_viewport_y << " and m_running_delta = "  << m_running_delta;
+ // }
+
+    //qDebug() << m_document_pixmap_offset;
+
+  draw_document_pixmap(); // Follow the scrollbar
+  draw_viewport_placeholder(); // Apply new placeholder at mouse position
+}
+
+void MiniMap::updatePixmapOffsetFromScrollbar(float percentage) {
+  // Update map and placeholder deltas
+  auto dim = m_parent->getDocumentDimensions();
+  auto viewport_height = m_parent->viewport()->height();
+  auto scaled_viewport_height = ((float)MiniMap::WIDTH * viewport_height) / dim.width();
+  float viewport_y = m_parent->getVScrollbarPos();
+  float scaled_viewport_y = ((float)MiniMap::WIDTH * viewport_y) / dim.width();
+
+  float m_running_delta = (
+                      // The percentage of the scrollbar itself (i.e. position where we were)
+                      (m_start_dragging_scrollbar_pos / m_parent->verticalScrollBar()->maximum())
+                      + percentage // Mouse delta percentage in the total scrollable area
+                     ) * (this->height() - scaled_viewport_height);
+
+//      qDebug() << "((float)m_start_dragging_scrollbar_pos / m_parent->verticalScrollBar()->maximum()): "
+//               << ((float)m_start_dragging_scrollbar_pos / m_parent->verticalScrollBar()->maximum()) << "\n"
+//               << "percentage:" << percentage << "\n"
+//               << "(this->height()- scaled_viewport_height):" << (this->height()- scaled_viewport_height) << "\n";
+
+  //int scaled_document_delta = (MiniMap::WIDTH * document_delta) / dim.width();
+  m_document_pixmap_offset = scaled_viewport_y - m_running_delta;
+
+}
+
+void MiniMap::draw_document_pixmap() { // Draws document pixmap with the specified offset (and no hover rectangle)
+  //qDebug() << "-m_document_pixmap_offset = " << -m_document_pixmap_offset;
+
+  const int top = firstVisibleRow();
+  if (top != m_first_visible_row || m_document_frame_changed) {
+    m_first_visible_row = top;
+    m_document_frame_changed = false;
+    update(); // The whole thumbnail moved (or changed)
+  }
+
+  // Scrolled past what has been rendered so far
+  const int bottom = std::min(top + this->height(), m_document_frame.rows);
+  const int renderedTop = m_document_frame.firstImage * MiniMapFrame::ROWS;
+  const int renderedBottom = renderedTop + m_document_frame.images.size() * MiniMapFrame::ROWS;
+  if (top < bottom && (top < renderedTop || bottom > renderedBottom) && !m_tiles.empty()) {
+    m_regenerateRequested = true;
+    updateTileLines();
+    snapshotDirtyTiles();
+  }
+}
+
+// The thumbnail row shown at the top of the widget
+int MiniMap::firstVisibleRow() const {
+  auto dim = m_parent->getDocumentDimensions();
+  float scaled_doc_height = ((float)MiniMap::WIDTH * dim.height()) / dim.width();
+  if (scaled_doc_height < this->height())
+    return 0; // Do not move the pixmap if it can safely be drawn into our area
+  return static_cast<int>(m_document_pixmap_offset);
+}
+
+void MiniMap::clear_document_pixmap() { // Cleanup
+  m_document_frame = MiniMapFrame();
+  m_viewport_rect = QRect();
+  update();
+}
+
+// Blits the images of the document thumbnail intersecting the area to be painted, then the viewport
+// placeholder over them
+void MiniMap::paintEvent(QPaintEvent *event) {
+  QPainter painter(this);
+  const QRect area = event->rect();
+  for (int i = 0; i < m_document_frame.images.size(); ++i) {
+    QRect image(0, (m_document_frame.firstImage + i) * MiniMapFrame::ROWS - m_first_visible_row,
+                MiniMap::WIDTH, MiniMapFrame::ROWS);
+    QRect visible = image & area;
+    if (!visible.isEmpty())
+      painter.drawImage(visible.topLeft(), m_document_frame.images[i], visible.translated(0, -image.top()));
+  }
+
+  if (m_viewport_rect.intersects(area))
+    painter.fillRect(m_viewport_rect & area, QColor(50, 50, 50, 160));
+}
+
+void MiniMap::setDocument(Document *document) {
+  if (!m_document.isNull())
+    m_document->disconnect(this);
+  m_document = document;
+  m_tiles.clear();
+  m_tileStartsDirty = true;
+  m_snapshots.clear();
+  m_snapshotTimer.stop();
+  m_regenerateRequested = false;
+  ++m_documentGeneration;
+  if (m_document.isNull())
+    return;
+
+  connect(document, &Document::linesChanged, this, [this](int first, int removed, int added) {
+    documentLinesChange(first, removed, added);
+  });
+  connect(document, &Document::linesRestyled, this, [this](int first, int last) {
+    linesRestyled(first, last);
+  });
+  invalidateTiles();
+}
+
+// Every tile has to be rendered and composited again
+void MiniMap::invalidateTiles() {
+  m_tiles.clear();
+  m_tileStartsDirty = true;
+  if (m_document.isNull())
+    return;
+  m_blockCount = m_document->physicalLineCount();
+  for (int first = 0; first < m_blockCount; first += TILE_BLOCKS)
+    m_tiles.push_back(newTile(std::min(TILE_BLOCKS, m_blockCount - first)));
+}
+
+MiniMap::Tile MiniMap::newTile(int blockCount) {
+  Tile tile;
+  tile.id = m_nextTileId++;
+  tile.blockCount = blockCount;
+  return tile;
+}
+
+// The tiles overlapping the edited lines are merged into a single dirty one (split again if too
+// big), the others are left untouched: only their position in the thumbnail might change
+void MiniMap::documentLinesChange(int first, int removed, int added) {
+  if (m_tiles.empty() || removed >= m_blockCount) {
+    invalidateTiles();
+    return;
+  }
+  m_blockCount += added - removed;
+
+  size_t tile = static_cast<size_t>(tileOfBlock(first));
+  int tileStart = m_tileStarts[tile];
+  size_t lastTile = tile;
+  int merged = m_tiles[tile].blockCount;
+  while (tileStart + merged < first + removed && lastTile + 1 < m_tiles.size())
+    merged += m_tiles[++lastTile].blockCount;
+  merged += added - removed;
+
+  m_tiles.erase(m_tiles.begin() + tile + 1, m_tiles.begin() + lastTile + 1);
+  m_tiles[tile] = newTile(std::max(merged, 1));
+  while (m_tiles[tile].blockCount > 2 * TILE_BLOCKS) {
+    Tile rest = newTile(m_tiles[tile].blockCount - TILE_BLOCKS);
+    m_tiles[tile].blockCount = TILE_BLOCKS;
+    m_tiles.insert(m_tiles.begin() + ++tile, rest);
+  }
+  m_tileStartsDirty = true;
+}
+
+void MiniMap::linesRestyled(int first, int last) {
+  if (m_tiles.empty())
+    return;
+  for (int tile = tileOfBlock(first), end = tileOfBlock(last); tile <= end; ++tile)
+    ++m_tiles[tile].version;
+}
+
+// Editor lines of every tile: a tile whose lines got wrapped differently (e.g. in the background,
+// after a load) has to be snapshotted again, and moves the ones after it
+void MiniMap::updateTileLines() {
+  if (m_document.isNull())
+    return;
+  const int blockCount = m_document->physicalLineCount();
+  int first = 0;
+  int firstLine = 0;
+  for (Tile& tile : m_tiles) {
+    first += tile.blockCount;
+    const int end = m_document->firstEditorLineOf(std::min(first, blockCount));
+    if (end - firstLine != tile.lines) {
+      tile.lines = end - firstLine;
+      ++tile.version;
+    }
+    firstLine = end;
+  }
+}
+
+int MiniMap::tileOfBlock(int blockNumber) {
+  if (m_tileStartsDirty) {
+    m_tileStarts.resize(m_tiles.size());
+    int start = 0;
+    for (size_t i = 0; i < m_tiles.size(); ++i) {
+      m_tileStarts[i] = start;
+      start += m_tiles[i].blockCount;
+    }
+    m_tileStartsDirty = false;
+  }
+  auto it = std::upper_bound(m_tileStarts.begin(), m_tileStarts.end(), blockNumber);
+  return std::max(static_cast<int>(it - m_tileStarts.begin()) - 1, 0);
+}
+
+void MiniMap::regenerate() {
+  if (m_document.isNull()) {
+    clear_document_pixmap();
+    return;
+  }
+
+  // A different scale (the thumbnail keeps the document aspect ratio at MiniMap::WIDTH), wrapping
+  // width or colour means rendering everything again
+  SilhouetteGeometry geometry = documentGeometry();
+  QColor textColor = m_parent->palette().color(QPalette::Text);
+  if (geometry != m_geometry || textColor != m_textColor || m_tiles.empty()) {
+    m_geometry = geometry;
+    m_textColor = textColor;
+    invalidateTiles();
+  }
+
+  m_regenerateRequested = true;
+  updateTileLines();
+  snapshotDirtyTiles();
+}
+
+// Copies the lines of the tiles shown in the next frame which the renderer doesn't have (or has an
+// older version of), unless they were copied already, until the time budget for this slice is
+// exhausted. Once they're all there, a new frame is started
+void MiniMap::snapshotDirtyTiles() {
+  if (m_document.isNull() || m_rendering || !m_regenerateRequested)
+    return; // frameRendered() will start over
+
+  QElapsedTimer timer;
+  timer.start();
+
+  const MiniMapFrameRequest frame = frameRequest();
+  int first = 0;
+  int firstLine = 0;
+  for (const Tile& tile : m_tiles) {
+    if (frame.shows(firstLine, tile.lines) && (tile.dirty() || !tile.held)) {
+      auto snapshot = m_snapshots.find(tile.id);
+      if (snapshot == m_snapshots.end() || snapshot->second.version != tile.version) {
+        if (timer.nsecsElapsed() >= SNAPSHOT_SLICE_BUDGET_NS) {
+          m_snapshotTimer.start(); // Out of time: continue after the pending events have been processed
+          return;
+        }
+        TileSnapshot& copy = m_snapshots[tile.id];
+        copy.version = tile.version;
+        copy.blocks.resize(static_cast<size_t>(tile.blockCount));
+        const int end = std::min(first + tile.blockCount, m_document->physicalLineCount());
+        int lineStart = m_document->firstEditorLineOf(first);
+        for (int line = first; line < end; ++line) {
+          MiniMapBlockSnapshot& lineCopy = copy.blocks[static_cast<size_t>(line - first)];
+          const int lineEnd = m_document->firstEditorLineOf(line + 1);
+          lineCopy.lines = lineEnd - lineStart;
+          lineStart = lineEnd;
+          lineCopy.text = m_document->lineText(line);
+          m_document->lineStyles(line, m_styleRuns);
+          lineCopy.formats.clear();
+          for (const Document::StyleRun& run : m_styleRuns) {
+            QTextLayout::FormatRange range;
+            range.start = run.start;
+            range.length = run.length;
+            range.format = m_parent->getStyleFormat(run.style);
+            lineCopy.formats.append(range);
+          }
+        }
+      }
+    }
+    first += tile.blockCount;
+    firstLine += tile.lines;
+  }
+
+  startRendering();
+}
+
+// The character grid of the editor: tabulation markers take a column each, as any other character
+SilhouetteGeometry MiniMap::documentGeometry() const {
+  SilhouetteGeometry geometry;
+  QSizeF dim = m_parent->getDocumentDimensions();
+  geometry.scale = static_cast<float>(MiniMap::WIDTH / dim.width());
+
+  QFontMetricsF metrics(m_parent->getMonospaceFont());
+  geometry.characterWidth = static_cast<float>(metrics.horizontalAdvance(QLatin1Char('A')));
+  geometry.lineHeight = m_parent->getLineHeightPixels(); // As getDocumentDimensions()
+  geometry.margin = CodeTextEdit::MARGIN;
+  geometry.wrapColumns = m_document->wrapColumns();
+  return geometry;
+}
+
+// The frame to render next, without its tiles: what's on screen, and a screen above and below it,
+// rounded to whole images (the renderer paints every tile in them)
+MiniMapFrameRequest MiniMap::frameRequest() const {
+  MiniMapFrameRequest request;
+  request.geometry = m_geometry;
+  request.textColor = m_textColor;
+  const int firstRow = std::max(firstVisibleRow() - this->height(), 0);
+  const int lastRow = firstVisibleRow() + 2 * this->height();
+  request.firstRow = firstRow / MiniMapFrame::ROWS * MiniMapFrame::ROWS;
+  request.lastRow = (lastRow / MiniMapFrame::ROWS + 1) * MiniMapFrame::ROWS - 1;
+  return request;
+}
+
+// Hands the tiles over to the renderer, together with the lines copied for the shown ones it
+// doesn't have
+void MiniMap::startRendering() {
+  MiniMapFrameRequest request = frameRequest();
+  request.tiles.resize(m_tiles.size());
+  int firstLine = 0;
+  for (size_t i = 0; i < m_tiles.size(); ++i) {
+    Tile& tile = m_tiles[i];
+    MiniMapFrameRequest::Tile& requested = request.tiles[i];
+    requested.id = tile.id;
+    requested.lines = tile.lines;
+    requested.shown = request.shows(firstLine, tile.lines);
+    if (tile.dirty() || (requested.shown && !tile.held)) {
+      requested.changed = true;
+      if (requested.shown)
+        requested.blocks = std::move(m_snapshots[tile.id].blocks);
+      tile.sentVersion = tile.version;
+    }
+    tile.held = requested.shown;
+    firstLine += tile.lines;
+  }
+  m_snapshots.clear(); // Including the ones of tiles merged away or scrolled out of view in the meantime
+  m_regenerateRequested = false;
+
+  MiniMapRenderer *renderer = &m_renderer;
+  m_rendering = true;
+  m_renderingGeneration = m_documentGeneration;
+  m_frameWatcher.setFuture(QtConcurrent::run([renderer, request = std::move(request)]() mutable {
+    return renderer->render(std::move(request));
+  }));
+}
+
+// The worker is done with a frame: show it, and start on the next one if a regeneration was
+// requested in the meantime
+void MiniMap::frameRendered() {
+  m_rendering = false;
+  if (m_renderingGeneration == m_documentGeneration && !m_document.isNull()) {
+    m_document_frame = m_frameWatcher.result();
+    m_document_frame_changed = true;
+    draw_document_pixmap();
+    if (m_hovering)
+      draw_viewport_placeholder();
+  }
+  if (m_regenerateRequested)
+    updateTileLines(); // The document might have been edited in the meantime
+  snapshotDirtyTiles();
+}
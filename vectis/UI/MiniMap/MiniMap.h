@@ -0,0 +1,131 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <UI/CodeTextEdit/Document.h>
+#include <UI/MiniMap/MiniMapRenderer.h>
+#include <QPixmap>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <QWidget>
+#include <QFutureWatcher>
+#include <unordered_map>
+#include <vector>
+
+class CodeTextEdit;
+
+// The document overview shown at the right of the code editor.
+//
+// The document is split in tiles, each one covering a few consecutive physical lines (the blocks of
+// the thumbnail). Edits (and lexing results) only mark the tiles of the lines they touch as dirty:
+// regenerate() hands those over to the renderer again. Typing a character costs about a tile of
+// copying, not the whole document.
+//
+// Rendering happens in a worker thread (see MiniMapRenderer): the GUI thread only copies the text
+// and styles of the lines of the tiles shown in the frame which the renderer doesn't have yet (they
+// are dirty, or were scrolled into view), in slices of about a millisecond, and shows the finished
+// frame once the worker hands it back. Until then the previous one stays on screen. A frame only
+// covers the thumbnail rows around the ones on screen, in fixed-size images: scrolling past them
+// asks for a new frame. The other tiles are only known by their count of editor lines.
+//
+// Nothing is composited ahead of time: paintEvent() blits the frame images at the scroll offset,
+// and the viewport placeholder over them. Moving the placeholder only repaints the areas it left
+// and entered
+class MiniMap : public QWidget {
+public:
+  MiniMap(CodeTextEdit *parent = nullptr);
+  ~MiniMap();
+
+  void mousePressEvent(QMouseEvent *ev);
+  void mouseReleaseEvent(QMouseEvent *event);
+  void enterEvent(QEvent *event);
+  void leaveEvent(QEvent *event);
+  void mouseMoveEvent(QMouseEvent *ev);
+  void paintEvent(QPaintEvent *event);
+
+  void draw_viewport_placeholder();
+  void updatePixmapOffsetFromScrollbar(float percentage = 0.f /* additional percentage as supplied by a mouse offset */);
+  void draw_document_pixmap(); // Schedules a repaint if the document pixmap offset changed
+  void clear_document_pixmap(); // Cleanup
+
+  // Starts tracking the edits of a document (nullptr to stop). Everything is rendered again
+  void setDocument(Document *document);
+  // Has the dirty tiles rendered again and the document image recomposited (asynchronously)
+  void regenerate();
+
+  QPixmap& map() {
+    return m_map;
+  }
+
+static constexpr const int WIDTH = 150;
+
+  MiniMapFrame m_document_frame; // Rendered part of the document thumbnail (no hover rectangles or translations)
+  float m_document_pixmap_offset = 0.f; // Y offset for the document pixmap to be shown
+  QPixmap m_old_pixmap_before_hovering;
+  bool m_hovering = false;
+  bool m_dragging = false;
+  QPoint m_start_dragging_pos;
+  float m_start_dragging_scrollbar_pos = 0.f;
+  QPixmap m_map;
+
+  CodeTextEdit *m_parent = nullptr;
+
+private:
+  // The renderer knows tiles by id; a tile is dirty until its latest version has been sent to it
+  struct Tile {
+    quint64 id = 0;
+    int blockCount = 0;
+    int lines = 0; // Editor lines of its blocks
+    int version = 0;
+    int sentVersion = -1;
+    bool held = false; // The renderer has the blocks of the version sent (the tile was shown)
+
+    bool dirty() const { return version != sentVersion; }
+  };
+  // Blocks of a tile to be shown copied while preparing the next frame
+  struct TileSnapshot {
+    int version = 0;
+    std::vector<MiniMapBlockSnapshot> blocks;
+  };
+
+  void documentLinesChange(int first, int removed, int added);
+  void linesRestyled(int first, int last);
+  void invalidateTiles();
+  Tile newTile(int blockCount);
+  int tileOfBlock(int blockNumber);
+  void updateTileLines();
+  SilhouetteGeometry documentGeometry() const;
+  int firstVisibleRow() const;
+  MiniMapFrameRequest frameRequest() const;
+  void snapshotDirtyTiles();
+  void startRendering();
+  void frameRendered();
+
+  QPointer<Document> m_document;
+  std::vector<Tile> m_tiles;
+  std::vector<int> m_tileStarts; // First block of every tile, rebuilt when tiles are split/merged
+  bool m_tileStartsDirty = true;
+  quint64 m_nextTileId = 0;
+  int m_blockCount = 0;
+  SilhouetteGeometry m_geometry;
+  QColor m_textColor;
+
+  bool m_regenerateRequested = false;
+  std::unordered_map<quint64, TileSnapshot> m_snapshots;
+  std::vector<Document::StyleRun> m_styleRuns; // Scratch space for the snapshots
+  QTimer m_snapshotTimer;
+
+  // Shared with the rendering thread
+  MiniMapRenderer m_renderer;
+  QFutureWatcher<MiniMapFrame> m_frameWatcher;
+  bool m_rendering = false;
+  int m_documentGeneration = 0; // Frames rendered for a previous document are dropped
+  int m_renderingGeneration = 0;
+
+  // What is on screen
+  int m_first_visible_row = 0;
+  bool m_document_frame_changed = false;
+  QRect m_viewport_rect; // Covered by the viewport placeholder, empty if not hovering
+};
+
+#endif // MINIMAP_H
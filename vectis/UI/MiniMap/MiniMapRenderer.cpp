@@ -0,0 +1,137 @@
+#include <UI/MiniMap/MiniMapRenderer.h>
+#include <UI/MiniMap/MiniMap.h>
+#include <algorithm>
+#include <cstdlib>
+
+namespace { // Functions reserved for this TU's internal use
+
+  // Images cached at most: a few screens worth of minimap
+  const int CACHED_IMAGES = 16;
+  // Silhouettes are painted slightly translucent, so that they don't look bolder than text would
+  const int SILHOUETTE_ALPHA = 170;
+
+  quint32 silhouetteColor(const QColor& color) {
+    return qPremultiply(qRgba(color.red(), color.green(), color.blue(), color.alpha() * SILHOUETTE_ALPHA / 255));
+  }
+}
+
+MiniMapFrame MiniMapRenderer::render(MiniMapFrameRequest request) {
+  if (request.geometry != m_geometry || request.textColor != m_textColor) { // Nothing can be reused
+    m_geometry = request.geometry;
+    m_textColor = request.textColor;
+    m_tiles.clear();
+    m_tileIndex.clear();
+    m_images.clear();
+  }
+
+  std::vector<Tile> tiles(request.tiles.size());
+  QHash<quint64, int> tileIndex;
+  tileIndex.reserve(static_cast<int>(request.tiles.size()));
+  for (size_t i = 0; i < request.tiles.size(); ++i) {
+    const MiniMapFrameRequest::Tile& requested = request.tiles[i];
+    auto previous = m_tileIndex.constFind(requested.id);
+    if (!requested.changed && previous != m_tileIndex.constEnd())
+      tiles[i] = std::move(m_tiles[*previous]);
+    else
+      updateTile(requested, tiles[i]);
+    if (!requested.shown)
+      std::vector<Block>().swap(tiles[i].blocks); // The tile comes with its blocks again once shown
+    tileIndex.insert(requested.id, static_cast<int>(i));
+  }
+  m_tiles.swap(tiles);
+  m_tileIndex.swap(tileIndex);
+
+  m_firstLines.resize(m_tiles.size() + 1);
+  m_firstLines[0] = 0;
+  for (size_t i = 0; i < m_tiles.size(); ++i)
+    m_firstLines[i + 1] = m_firstLines[i] + m_tiles[i].lines;
+
+  MiniMapFrame frame;
+  frame.rows = silhouetteRow(m_firstLines.back(), m_geometry);
+  const int firstRow = std::max(request.firstRow, 0);
+  const int lastRow = std::min(request.lastRow, frame.rows - 1);
+  frame.firstImage = firstRow / MiniMapFrame::ROWS;
+  if (firstRow <= lastRow) {
+    for (int index = frame.firstImage; index <= lastRow / MiniMapFrame::ROWS; ++index)
+      frame.images.append(image(index));
+  }
+
+  // Keep the cache bounded: drop the images farthest from the ones just rendered
+  const int middle = frame.firstImage + frame.images.size() / 2;
+  while (m_images.size() > CACHED_IMAGES) {
+    auto farthest = m_images.begin();
+    for (auto it = m_images.begin(); it != m_images.end(); ++it) {
+      if (std::abs(it.key() - middle) > std::abs(farthest.key() - middle))
+        farthest = it;
+    }
+    m_images.erase(farthest);
+  }
+  return frame;
+}
+
+// Turns the blocks of a tile which changed into their silhouette, with their formats turned into
+// colours: the text isn't kept
+void MiniMapRenderer::updateTile(const MiniMapFrameRequest::Tile& requested, Tile& tile) {
+  const std::vector<MiniMapBlockSnapshot>& blocks = requested.blocks;
+  tile.revision = m_nextRevision++;
+  tile.blocks.resize(blocks.size());
+  tile.lines = requested.lines;
+  const quint32 textColor = silhouetteColor(m_textColor);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const MiniMapBlockSnapshot& snapshot = blocks[i];
+    Block& block = tile.blocks[i];
+    m_runs.clear();
+    for (const QTextLayout::FormatRange& range : snapshot.formats) {
+      const QBrush foreground = range.format.foreground();
+      if (foreground.style() != Qt::NoBrush)
+        m_runs.push_back(SilhouetteRun{range.start, range.length, silhouetteColor(foreground.color())});
+    }
+    block.silhouette = silhouetteBlock(snapshot.text.constData(), snapshot.text.length(), m_runs.data(),
+                                       static_cast<int>(m_runs.size()), textColor, m_geometry);
+    block.lines = snapshot.lines;
+  }
+}
+
+// The image covering the thumbnail rows [index * ROWS, (index + 1) * ROWS), painted again only if
+// the tiles in it changed or moved since it was cached
+QImage MiniMapRenderer::image(int index) {
+  const int top = index * MiniMapFrame::ROWS;
+  const int bottom = top + MiniMapFrame::ROWS;
+
+  // The first tile ending below the top of the image, and the following ones up to its bottom
+  auto end = std::upper_bound(m_firstLines.begin() + 1, m_firstLines.end(), top, [this](int row, int line) {
+    return row < silhouetteRow(line, m_geometry);
+  });
+  ImageContents contents;
+  std::vector<size_t> painted;
+  for (size_t tile = static_cast<size_t>(end - (m_firstLines.begin() + 1));
+       tile < m_tiles.size() && silhouetteRow(m_firstLines[tile], m_geometry) < bottom; ++tile) {
+    if (m_tiles[tile].lines == 0)
+      continue;
+    contents.push_back(std::make_pair(m_tiles[tile].revision, m_firstLines[tile]));
+    painted.push_back(tile);
+  }
+
+  auto cached = m_images.constFind(index);
+  if (cached != m_images.constEnd() && cached->contents == contents)
+    return cached->image;
+
+  QImage image(MiniMap::WIDTH, MiniMapFrame::ROWS, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  quint32 *bits = reinterpret_cast<quint32*>(image.bits());
+  for (size_t tile : painted) {
+    int line = m_firstLines[tile];
+    for (const Block& block : m_tiles[tile].blocks) {
+      const int blockBottom = silhouetteRow(line + block.lines, m_geometry);
+      if (block.lines > 0 && blockBottom > top && silhouetteRow(line, m_geometry) < bottom) {
+        // Clipped to its rows, should the document have wrapped it in fewer lines
+        paintSilhouette(bits, image.bytesPerLine(), image.width(), std::min(blockBottom - top, image.height()),
+                        top, line, block.silhouette, m_geometry);
+      }
+      line += block.lines;
+    }
+  }
+
+  m_images.insert(index, Image{contents, image});
+  return image;
+}
@@ -0,0 +1,98 @@
+#ifndef MINIMAPRENDERER_H
+#define MINIMAPRENDERER_H
+
+#include <UI/MiniMap/MiniMapSilhouette.h>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QString>
+#include <QTextLayout>
+#include <QVector>
+#include <vector>
+
+// What the minimap needs to know about a block (a physical line), copied from the document on the
+// GUI thread
+struct MiniMapBlockSnapshot {
+  QString text;
+  QVector<QTextLayout::FormatRange> formats;
+  int lines = 1; // Editor lines, 0 if the document didn't wrap it yet
+};
+
+// A frame to render: every tile of blocks of the document, in order, with its editor lines. Only the
+// tiles shown in the requested rows have their blocks painted, and the renderer only keeps the blocks
+// of these: a tile comes with a snapshot of its blocks if it's shown and it changed since the previous
+// frame or wasn't shown in it. The other tiles only tell where the shown ones are
+struct MiniMapFrameRequest {
+  struct Tile {
+    quint64 id = 0;
+    int lines = 0;
+    bool changed = false; // A new version of the tile: its lines, and its blocks if it's shown
+    bool shown = false;
+    std::vector<MiniMapBlockSnapshot> blocks;
+  };
+
+  // Whether the tile of the given lines, starting at firstLine, intersects the requested rows
+  bool shows(int firstLine, int lines) const {
+    return lines > 0 && silhouetteRow(firstLine + lines, geometry) > firstRow &&
+           silhouetteRow(firstLine, geometry) <= lastRow;
+  }
+
+  SilhouetteGeometry geometry; // How the document lays blocks out, and the thumbnail scale
+  QColor textColor; // For the characters without a foreground in their format
+  std::vector<Tile> tiles;
+  int firstRow = 0, lastRow = -1; // The thumbnail rows to be rendered, whole images
+};
+
+// The rendered part of the thumbnail: images of ROWS rows each, the first one starting at row
+// firstImage * ROWS of a thumbnail which is rows rows tall
+struct MiniMapFrame {
+  static constexpr const int ROWS = 256;
+
+  int rows = 0;
+  int firstImage = 0;
+  QVector<QImage> images;
+};
+
+// Renders minimap frames out of the GUI thread, from snapshots only: blocks are painted as their
+// silhouette (see MiniMapSilhouette.h) rather than as text.
+//
+// The thumbnail is never rendered as a whole: it's split in fixed-size images, and only the ones
+// covering the requested rows get rendered, and only the tiles shown in them keep their blocks (as
+// silhouettes), so memory hardly depends on the document length. The most recent images are cached
+// until the tiles they show change or move. Images handed out are never written to again: the GUI thread keeps showing the previous
+// frame until the next one is handed over. A single frame may be rendered at a time
+class MiniMapRenderer {
+public:
+  MiniMapFrame render(MiniMapFrameRequest request);
+
+private:
+  struct Block {
+    SilhouetteBlock silhouette;
+    int lines = 0; // Rows of the thumbnail it's given, whatever the silhouette wraps it in
+  };
+  struct Tile {
+    quint64 revision = 0; // Different every time the tile changes
+    std::vector<Block> blocks; // Empty if not shown
+    int lines = 0;
+  };
+  // The tiles painted in an image, together with their first line
+  typedef std::vector<std::pair<quint64, int>> ImageContents;
+  struct Image {
+    ImageContents contents;
+    QImage image;
+  };
+
+  void updateTile(const MiniMapFrameRequest::Tile& requested, Tile& tile);
+  QImage image(int index);
+
+  std::vector<Tile> m_tiles; // In document order
+  QHash<quint64, int> m_tileIndex; // From the ids of the requested tiles
+  std::vector<int> m_firstLines; // First line of every tile, and the line count at the end
+  quint64 m_nextRevision = 0;
+  QHash<int, Image> m_images;
+  std::vector<SilhouetteRun> m_runs; // Scratch space for updateTile()
+  SilhouetteGeometry m_geometry;
+  QColor m_textColor;
+};
+
+#endif // MINIMAPRENDERER_H
@@ -0,0 +1,136 @@
+#include <UI/MiniMap/MiniMapSilhouette.h>
+#include <algorithm>
+#include <cstring>
+
+namespace { // Functions reserved for this TU's internal use
+
+  // Tabulation markers (see Document) and newlines included
+  bool isBlank(ushort c) {
+    return c == ' ' || c == '\t' || c == 0x00A0 || c == 0x07 || c == '\r' || c == '\n';
+  }
+
+  int spanEnd(const SilhouetteSpan& span) {
+    return span.start + span.length;
+  }
+
+  // End of the line starting at cell start: breaks before the word running past wrapColumns (or in
+  // the middle of it if it's the first one of the line). Trailing blanks hang past the end, as in
+  // QTextLayout. span is the first span which might run past the line, kept from a line to the next
+  int lineEnd(const SilhouetteBlock& block, size_t& span, int start, const SilhouetteGeometry& geometry) {
+    if (geometry.wrapColumns <= 0 || block.length - start <= geometry.wrapColumns)
+      return block.length;
+    const int limit = start + geometry.wrapColumns;
+    const std::vector<SilhouetteSpan>& spans = block.spans;
+    while (span < spans.size() && spanEnd(spans[span]) <= limit)
+      ++span;
+    if (span == spans.size())
+      return block.length; // Only blanks past the limit
+    size_t word = span;
+    while (word > 0 && spanEnd(spans[word - 1]) == spans[word].start)
+      --word;
+    if (spans[word].start > start) {
+      span = word; // The word might be too long for the next line as well
+      return spans[word].start;
+    }
+    return std::max(spans[span].start, limit);
+  }
+
+}
+
+SilhouetteBlock silhouetteBlock(const QChar *text, int length, const SilhouetteRun *runs, int runCount,
+                                quint32 defaultColor, const SilhouetteGeometry& geometry) {
+  SilhouetteBlock block;
+  int run = 0;
+  int column = 0;
+  for (int i = 0; i < length; ++i) {
+    const ushort c = text[i].unicode();
+    if (isBlank(c)) {
+      column = (c == '\t') ? (column / geometry.tabColumns + 1) * geometry.tabColumns : column + 1;
+      continue;
+    }
+    while (run < runCount && runs[run].start + runs[run].length <= i)
+      ++run;
+    const quint32 color = (run < runCount && runs[run].start <= i) ? runs[run].color : defaultColor;
+    if (!block.spans.empty() && spanEnd(block.spans.back()) == column && block.spans.back().color == color)
+      ++block.spans.back().length;
+    else
+      block.spans.push_back(SilhouetteSpan{column, 1, color});
+    ++column;
+  }
+  block.length = column;
+  block.indent = block.spans.empty() ? column : block.spans.front().start;
+  block.spans.shrink_to_fit();
+  return block;
+}
+
+int silhouetteRow(int line, const SilhouetteGeometry& geometry) {
+  // In double precision: millions of lines times the line height don't fit in a float's mantissa
+  return static_cast<int>(line * static_cast<double>(geometry.lineHeight) * geometry.scale + 0.5);
+}
+
+int silhouetteLineCount(const SilhouetteBlock& block, const SilhouetteGeometry& geometry) {
+  if (block.indent == block.length)
+    return 1; // Blank
+  int lines = 1;
+  size_t span = 0;
+  for (int start = lineEnd(block, span, 0, geometry); start < block.length; ++lines)
+    start = lineEnd(block, span, start, geometry);
+  return lines;
+}
+
+int paintSilhouette(quint32 *bits, int bytesPerLine, int width, int height, int originRow, int firstLine,
+                    const SilhouetteBlock& block, const SilhouetteGeometry& geometry) {
+  const float cellWidth = geometry.characterWidth * geometry.scale;
+  const float left = geometry.margin * geometry.scale + 0.5f; // Rounds the cell edges to the closest pixel
+  const std::vector<SilhouetteSpan>& spans = block.spans;
+  size_t wrapSpan = 0;
+  size_t span = 0; // First span not entirely on the previous lines
+  int lines = 0;
+  int start = 0;
+  do {
+    const int end = lineEnd(block, wrapSpan, start, geometry);
+    int rowTop = silhouetteRow(firstLine + lines, geometry) - originRow;
+    int rowBottom = silhouetteRow(firstLine + lines + 1, geometry) - originRow;
+    if (rowBottom - rowTop >= 2)
+      --rowBottom; // Keep a gap between lines when there's room for it
+    rowTop = std::max(rowTop, 0);
+    rowBottom = std::min(rowBottom, height);
+    ++lines;
+    while (span < spans.size() && spanEnd(spans[span]) <= start)
+      ++span;
+    if (rowTop >= rowBottom) {
+      start = end;
+      continue;
+    }
+
+    // Paint the first row of the line a cell at a time (cells are a pixel or two wide)...
+    quint32 *row = reinterpret_cast<quint32*>(reinterpret_cast<uchar*>(bits) + static_cast<size_t>(rowTop) * bytesPerLine);
+    int painted = 0; // Pixels of the row written so far
+    bool full = false;
+    for (size_t i = span; i < spans.size() && spans[i].start < end && !full; ++i) {
+      const quint32 color = spans[i].color;
+      for (int cell = std::max(spans[i].start, start), last = std::min(spanEnd(spans[i]), end); cell < last; ++cell) {
+        const int column = cell - start;
+        const int x = static_cast<int>(left + column * cellWidth);
+        if (x >= width) {
+          full = true;
+          break;
+        }
+        const int next = std::min(std::max(static_cast<int>(left + (column + 1) * cellWidth), x + 1), width);
+        row[x] = color;
+        if (next > x + 1)
+          std::fill(row + x + 1, row + next, color);
+        painted = next;
+      }
+    }
+    // ...and copy it to the other ones
+    uchar *other = reinterpret_cast<uchar*>(row);
+    for (int y = rowTop + 1; y < rowBottom; ++y) {
+      other += bytesPerLine;
+      std::memcpy(other, row, static_cast<size_t>(painted) * sizeof(quint32));
+    }
+
+    start = end;
+  } while (start < block.length);
+  return lines;
+}
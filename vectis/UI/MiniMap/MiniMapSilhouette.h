@@ -0,0 +1,73 @@
+#ifndef MINIMAPSILHOUETTE_H
+#define MINIMAPSILHOUETTE_H
+
+#include <QChar>
+#include <QtGlobal>
+#include <vector>
+
+// The "silhouette" of a block of text as shown in the minimap: every character cell is painted as a
+// solid block of the colour of its format, whitespace is left empty. No glyph is ever rasterized,
+// and blocks are written straight into the scanlines of a 32-bit image.
+//
+// Cells come from a monospace grid: wrapping happens at word boundaries when the text doesn't fit in
+// wrapColumns, as QTextLayout would with a fixed-pitch font. Blocks are turned into their cells once
+// (see SilhouetteBlock): the text itself isn't needed past that
+
+// Characters [start, start + length) are painted with color (premultiplied ARGB)
+struct SilhouetteRun {
+  int start;
+  int length;
+  quint32 color;
+};
+
+struct SilhouetteGeometry {
+  float scale = 1.f; // Image pixels per document pixel
+  // In document pixels
+  float characterWidth = 1.f;
+  float lineHeight = 1.f;
+  float margin = 0.f;
+  int wrapColumns = 0; // 0 if lines are never wrapped
+  int tabColumns = 8;
+};
+
+inline bool operator==(const SilhouetteGeometry& a, const SilhouetteGeometry& b) {
+  return a.scale == b.scale && a.characterWidth == b.characterWidth && a.lineHeight == b.lineHeight &&
+         a.margin == b.margin && a.wrapColumns == b.wrapColumns && a.tabColumns == b.tabColumns;
+}
+
+inline bool operator!=(const SilhouetteGeometry& a, const SilhouetteGeometry& b) {
+  return !(a == b);
+}
+
+// Non-blank cells [start, start + length) of a block, painted with color (premultiplied ARGB)
+struct SilhouetteSpan {
+  int start;
+  int length;
+  quint32 color;
+};
+
+// A block of text as far as its silhouette is concerned: a word is a sequence of adjacent spans, the
+// gaps between them are blanks
+struct SilhouetteBlock {
+  int length = 0; // In cells, trailing blanks included
+  int indent = 0; // Leading blank cells
+  std::vector<SilhouetteSpan> spans; // Sorted, adjacent ones have different colours
+};
+
+// The cells of the text. runs must be sorted and non-overlapping; the characters not covered by any
+// get defaultColor. Tabulations (the document has markers instead) are expanded from the block start
+SilhouetteBlock silhouetteBlock(const QChar *text, int length, const SilhouetteRun *runs, int runCount,
+                                quint32 defaultColor, const SilhouetteGeometry& geometry);
+
+// Number of lines the block takes once wrapped
+int silhouetteLineCount(const SilhouetteBlock& block, const SilhouetteGeometry& geometry);
+
+// First image row of a line (counting the wrapped ones) of the document
+int silhouetteRow(int line, const SilhouetteGeometry& geometry);
+
+// Paints the block, whose first line is the given line of the document, into an image of the given
+// size showing the document rows from originRow on. Returns the number of lines painted
+int paintSilhouette(quint32 *bits, int bytesPerLine, int width, int height, int originRow, int firstLine,
+                    const SilhouetteBlock& block, const SilhouetteGeometry& geometry);
+
+#endif // MINIMAPSILHOUETTE_H
@@ -6,6 +6,7 @@
 #include <QStyleOption>
 #include <QApplication>
 #include <cmath>
+#include <algorithm>
 
 TabsBar::TabsBar( QWidget *parent )
     : m_parent(parent),
@@ -155,6 +156,19 @@ int TabsBar::getSelectedTabId () {
     return -1;
 }
 
+// Sets the progress percentage of a background operation on a tab (-1 means no operation in progress)
+void TabsBar::setTabProgress(int id, int percentage) {
+  auto tabIdMapIterator = m_tabId2tabIndexMap.find(id);
+  if (tabIdMapIterator == m_tabId2tabIndexMap.end() || m_tabIdHoles.count(id) > 0)
+    return; // This tab might have been closed in the meanwhile
+
+  auto& tab = m_tabs[tabIdMapIterator->second];
+  if (tab->m_progress == percentage)
+    return;
+  tab->m_progress = percentage;
+  update();
+}
+
 // Recalculates the opacity mask m_textOpacityMask in case the width has changed
 void TabsBar::recalculateOpacityMask(QRectF newTabRect) {
   if (m_textOpacityMask && newTabRect.width() == m_textOpacityMask->width())
@@ -180,7 +194,7 @@ void TabsBar::recalculateOpacityMask(QRectF newTabRect) {
 // for the tab's text and tab's close X button according to its selection and if the mouse is hovering
 // on the close button for this tab
 TabsBar::TabPaths TabsBar::drawTabInsideRect(QPainter& p, const QRect& tabRect, bool selected, QString text,
-                                             bool mouseHoveringXBtn) {
+                                             bool mouseHoveringXBtn, int progress) {
     // Decide colors for a selected or unselected tab
     QColor topGradientColor, bottomGradientColor;
     if( selected == false ) { // Unselected
@@ -280,6 +294,15 @@ TabsBar::TabPaths TabsBar::drawTabInsideRect(QPainter& p, const QRect& tabRect,
 
       p.drawPixmap(textRect, pixMap, pixMap.rect()); // Finally draw the pixmap with the text drawn + the right alpha mask
                                                      // in the right textRect on the control
+
+      // If there's an operation in progress (e.g. the document is still loading), draw a thin bar
+      // below the text
+      if (progress >= 0) {
+        QRectF barRect(textRect.x(), tabRect.y() + tabRect.height() - 4, textRect.width(), 2);
+        p.fillRect(barRect, QColor(60, 61, 56));
+        barRect.setWidth(textRect.width() * std::min(progress, 100) / 100.0);
+        p.fillRect(barRect, QColor(102, 217, 239)); // Light blue
+      }
     }
 
     // Last element to be drawn is the exit button pixmap (the X close button)
@@ -404,7 +427,7 @@ void TabsBar::paintEvent ( QPaintEvent* ) {
           standardTabRectLambda.setWidth( tabWidth );
 
           TabPaths&& temp = drawTabInsideRect( p, standardTabRectLambda, false, m_tabs[i]->m_title,
-                                               m_mouseHoveringCloseBtnTabIndex == i);
+                                               m_mouseHoveringCloseBtnTabIndex == i, m_tabs[i]->m_progress);
 
           m_tabs[i]->m_region = temp.tabRegion;
           m_tabs[i]->m_closeBtnRegion = temp.closeBtnRegion;
@@ -442,7 +465,8 @@ void TabsBar::paintEvent ( QPaintEvent* ) {
         standardTabRect.setWidth( tabWidth );
 
         TabPaths paths = drawTabInsideRect( p, standardTabRect, true, m_tabs[m_selectedTabIndex]->m_title,
-                                            m_mouseHoveringCloseBtnTabIndex == m_selectedTabIndex);
+                                            m_mouseHoveringCloseBtnTabIndex == m_selectedTabIndex,
+                                            m_tabs[m_selectedTabIndex]->m_progress);
 
         m_tabs[m_selectedTabIndex]->m_region = paths.tabRegion;
         m_tabs[m_selectedTabIndex]->m_closeBtnRegion = paths.closeBtnRegion;
@@ -72,6 +72,8 @@ private:
     QRect m_rect;
     int m_Xoffset = 0;
     int m_Yoffset = 0; // There is also a vertical offset for the entering/exiting tab animation
+
+    int m_progress = -1; // Percentage of a background operation (e.g. loading), -1 if there's none
 };
 
 // This class implements an interpolation towards the tabs equilibrium positions, i.e. the
@@ -107,6 +109,8 @@ public:
     int insertTab(const QString text, bool animation = true);
     void deleteTab(int id, bool animation = true);
     int getSelectedTabId();
+    // Shows a progress bar on a tab, -1 hides it
+    void setTabProgress(int id, int percentage);
 
 private:
 
@@ -116,7 +120,7 @@ private:
     };
 
     TabPaths drawTabInsideRect(QPainter& p, const QRect& tabRect , bool selected , QString text = "",
-                               bool mouseHoveringXBtn = false);
+                               bool mouseHoveringXBtn = false, int progress = -1);
     void drawGrayHorizontalBar( QPainter& p, const QColor innerGrayCol );
 
     friend class SlideToPositionAnimation;
@@ -16,16 +16,55 @@ INCLUDEPATH += $$PWD
 
 SOURCES += main.cpp\
         vmainwindow.cpp \
+        UI/CodeTextEdit/Arena.cpp \
         UI/CodeTextEdit/CodeTextEdit.cpp \
-        UI/Highlighters/CPPHighlighter.cpp \
-        UI/Highlighters/WhiteTextHighlighter.cpp \
+        UI/CodeTextEdit/Document.cpp \
+        UI/CodeTextEdit/DocumentLoader.cpp \
+        UI/CodeTextEdit/EditorLineIndex.cpp \
+        UI/CodeTextEdit/GlyphAtlas.cpp \
+        UI/CodeTextEdit/LineBreaks.cpp \
+        UI/CodeTextEdit/LineLayoutCache.cpp \
+        UI/CodeTextEdit/MonospaceRenderer.cpp \
+        UI/CodeTextEdit/Buffer/MappedFile.cpp \
+        UI/CodeTextEdit/Buffer/FileText.cpp \
+        UI/CodeTextEdit/Buffer/LineIndex.cpp \
+        UI/CodeTextEdit/Buffer/LineScanner.cpp \
+        UI/CodeTextEdit/Buffer/PieceTable.cpp \
+        UI/CodeTextEdit/Buffer/TextEncoding.cpp \
+        UI/CodeTextEdit/Lexers/Lexer.cpp \
+        UI/CodeTextEdit/Lexers/LexerInput.cpp \
+        UI/CodeTextEdit/Lexers/CPPLexer.cpp \
+        UI/MiniMap/MiniMap.cpp \
+        UI/MiniMap/MiniMapRenderer.cpp \
+        UI/MiniMap/MiniMapSilhouette.cpp \
         UI/ScrollBar/ScrollBar.cpp \
         UI/TabsBar/TabsBar.cpp
 
 HEADERS  += vmainwindow.h \
+            UI/CodeTextEdit/Arena.h \
+            UI/CodeTextEdit/ChunkedSequence.h \
             UI/CodeTextEdit/CodeTextEdit.h \
-            UI/Highlighters/CPPHighlighter.h \
-            UI/Highlighters/WhiteTextHighlighter.h \
+            UI/CodeTextEdit/Document.h \
+            UI/CodeTextEdit/DocumentLoader.h \
+            UI/CodeTextEdit/EditorLineIndex.h \
+            UI/CodeTextEdit/GlyphAtlas.h \
+            UI/CodeTextEdit/LineBreaks.h \
+            UI/CodeTextEdit/LineLayoutCache.h \
+            UI/CodeTextEdit/MonospaceRenderer.h \
+            UI/CodeTextEdit/Buffer/MappedFile.h \
+            UI/CodeTextEdit/Buffer/FileText.h \
+            UI/CodeTextEdit/Buffer/LineIndex.h \
+            UI/CodeTextEdit/Buffer/LineScanner.h \
+            UI/CodeTextEdit/Buffer/PieceTable.h \
+            UI/CodeTextEdit/Buffer/TextEncoding.h \
+            UI/CodeTextEdit/Lexers/Lexer.h \
+            UI/CodeTextEdit/Lexers/LexerInput.h \
+            UI/CodeTextEdit/Lexers/NumericLiteral.h \
+            UI/CodeTextEdit/Lexers/CPPKeywords.h \
+            UI/CodeTextEdit/Lexers/CPPLexer.h \
+            UI/MiniMap/MiniMap.h \
+            UI/MiniMap/MiniMapRenderer.h \
+            UI/MiniMap/MiniMapSilhouette.h \
             UI/ScrollBar/ScrollBar.h \
             UI/TabsBar/TabsBar.h \
     UI/Utils.h
@@ -1,6 +1,6 @@
 #include "vmainwindow.h"
 #include "ui_vmainwindow.h"
-#include <UI/Utils.h>
+#include <UI/CodeTextEdit/DocumentLoader.h>
 #include <QMimeData>
 #include <QFileInfo>
 #include <QPainter>
@@ -10,6 +10,8 @@
 #include <QScrollBar>
 #include <memory>
 #include <utility>
+#include <algorithm>
+#include <stdexcept>
 
 #include <QDebug>
 #include <QLabel>
@@ -105,37 +107,45 @@ void VMainWindow::loadDocumentFromFile (QString path, bool animation) {
 
   // Create document, tab and apply proper lexers
 
-  QFile file(path);
-  if (!file.open(QFile::ReadWrite | QFile::Text))
-      throw std::runtime_error("Could not open file");
-
   // Create a new tab and its respective tab id
   int id = m_tabsBar->insertTab(filename, animation);
-  // Store it into the document map and create a new QTextDocument
-  auto it = m_tabDocumentMap.emplace(id, new QTextDocument(m_customCodeEdit));
-  QTextDocument *document = it.first->second;
-
-  // Apply a plain text document layout
-  QPlainTextDocumentLayout *layout = new QPlainTextDocumentLayout(document);
-  document->setDocumentLayout(layout);
-
-  document->setDefaultFont(m_customCodeEdit->getMonospaceFont());
-
-  document->setPlainText( file.readAll() ); // Load the document with the file text
-
-  // Try to detect a suitable syntax highlighting scheme from the file extension
-  QString extension( fileInfo.completeSuffix() );
-  if (!extension.isEmpty()) {
-    auto syntaxHighlighter = getSyntaxHighlighterFromExtension( extension );
-    if (syntaxHighlighter != nullptr) {
-      document->setProperty("syntax_highlighter", extension);
-      syntaxHighlighter->setDocument ( document );
-      syntaxHighlighter->setParent ( document );
-      m_tabDocumentSyntaxHighlighter.emplace ( id, syntaxHighlighter );
+  // Store it into the document map and create a new Document
+  Document *document = new Document();
+  m_tabDocumentMap[id].reset(document);
+
+  // Try to detect a suitable syntax highlighting scheme from the file extension. This is done
+  // before any text is loaded: the lines on screen get lexed as soon as they're shown
+  document->applySyntaxHighlight(getSuggestedSyntaxHighlightFromExtension(fileInfo.completeSuffix()));
+
+  // Stream the file text into the document in the background. Progress is shown on the tab, the
+  // document is shown as soon as its first lines are in (if its tab is still the selected one) and
+  // can be edited while the rest of the file streams in
+  DocumentLoader *loader = new DocumentLoader();
+  connect(loader, &DocumentLoader::progressChanged, m_tabsBar, [this, id](int percentage) {
+    m_tabsBar->setTabProgress(id, percentage);
+  });
+  connect(loader, &DocumentLoader::started, this, [this, id]() {
+    m_tabDocumentShown.insert(id);
+    auto it = m_tabDocumentMap.find(id);
+    if (it == m_tabDocumentMap.end() || m_tabsBar->getSelectedTabId() != id)
+      return;
+    auto itv = m_tabDocumentVScrollPos.find(id);
+    m_customCodeEdit->setDocument(it->second.get(), (itv != m_tabDocumentVScrollPos.end()) ? itv->second : 0);
+  });
+  connect(loader, &DocumentLoader::finished, this, [this, id, path](bool loaded) {
+    m_tabsBar->setTabProgress(id, -1);
+    m_tabDocumentLoader.erase(id);
+    if (!loaded) {
+      QMessageBox::warning(this, "File not found", "Cannot read or access file:\n\n'" + path + "'");
+      tabWasRequestedToCloseSlot(id);
     }
-  }
-  // Finally load the newly created document in the viewport
-  m_customCodeEdit->setDocument( document );
+  });
+  m_tabDocumentLoader[id] = loader;
+  loader->loadInto(document, path);
+
+  // Nothing to show until the first lines are loaded
+  if (m_tabsBar->getSelectedTabId() == id)
+    m_customCodeEdit->unloadDocument();
 }
 
 void VMainWindow::selectedTabChangedSlot (int oldId, int newId) {
@@ -154,8 +164,12 @@ void VMainWindow::selectedTabChangedSlot (int oldId, int newId) {
   if (it != m_tabDocumentVScrollPos.end())
     vScrollbarPos = it->second;
 
-  // Finally load the new requested document
-  m_customCodeEdit->setDocument( m_tabDocumentMap[newId], vScrollbarPos );
+  // Finally load the new requested document (unless its first lines aren't loaded yet)
+  auto itd = m_tabDocumentMap.find(newId);
+  if (m_tabDocumentShown.count(newId) > 0)
+    m_customCodeEdit->setDocument( itd->second.get(), vScrollbarPos );
+  else
+    m_customCodeEdit->unloadDocument();
 
 
 
@@ -175,9 +189,23 @@ void VMainWindow::tabWasRequestedToCloseSlot(int tabId) {
   m_tabsBar->deleteTab(tabId); // Start tabs bar deletion process and new candidate selection process
 
   {
+    // Stop loading the document if it's still in progress
+    auto itl = m_tabDocumentLoader.find(tabId);
+    if (itl != m_tabDocumentLoader.end()) {
+      if (!itl->second.isNull())
+        itl->second->cancel();
+      m_tabDocumentLoader.erase(itl);
+    }
+
     // Delete document and tab id
-    auto it = m_tabDocumentMap.find(tabId);    
-    m_tabDocumentMap.erase(it);
+    auto it = m_tabDocumentMap.find(tabId);
+    if (it != m_tabDocumentMap.end()) {
+      if (m_customCodeEdit->document() == it->second.get())
+        m_customCodeEdit->unloadDocument();
+      m_tabDocumentMap.erase(it);
+    }
+
+    m_tabDocumentShown.erase(tabId);
 
     // Also delete the VScrollBar position history (if any)
     auto itv = m_tabDocumentVScrollPos.find(tabId);
@@ -192,6 +220,12 @@ void VMainWindow::tabWasRequestedToCloseSlot(int tabId) {
 }
 
 VMainWindow::~VMainWindow() {
+  // Documents still being loaded go away with us
+  for (auto& loader : m_tabDocumentLoader) {
+    if (!loader.second.isNull())
+      loader.second->cancel();
+  }
+  m_customCodeEdit->unloadDocument();
   delete ui;
 }
 
@@ -4,9 +4,14 @@
 #include <UI/CodeTextEdit/CodeTextEdit.h>
 #include <UI/ScrollBar/ScrollBar.h>
 #include <UI/TabsBar/TabsBar.h>
-#include <QSyntaxHighlighter>
 #include <QDialog>
 #include <QPixmap>
+#include <QPointer>
+#include <map>
+#include <set>
+#include <memory>
+
+class DocumentLoader;
 
 namespace Ui {
 class VMainWindow;
@@ -49,12 +54,14 @@ private:
     CodeTextEdit *m_customCodeEdit;
     TabsBar      *m_tabsBar;
 
-    // A map associating QTextDocuments to tab ids (which are also document ids)
-    std::map <int, QTextDocument*> m_tabDocumentMap;
+    // A map associating Documents to tab ids (which are also document ids)
+    std::map <int, std::unique_ptr<Document>> m_tabDocumentMap;
     // A map that stores the vertical scrollbar position for each document (to remember it)
     std::map <int /* Document/Tab id */, int> m_tabDocumentVScrollPos;
-    // A map that stores the syntax highlighter that a document might have
-    std::map <int /* Document/Tab id */, QSyntaxHighlighter*> m_tabDocumentSyntaxHighlighter;
+    // A map that stores the loaders of the documents which are still being loaded
+    std::map <int /* Document/Tab id */, QPointer<DocumentLoader>> m_tabDocumentLoader;
+    // The documents which can be shown, i.e. whose first lines are loaded
+    std::set <int /* Document/Tab id */> m_tabDocumentShown;
 
     void dragEnterEvent(QDragEnterEvent *event);
     void dragMoveEvent(QDragMoveEvent *event);